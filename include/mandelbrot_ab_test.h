@@ -0,0 +1,51 @@
+#ifndef MANDELBROT_AB_TEST_H
+#define MANDELBROT_AB_TEST_H
+
+#include <stdio.h>
+
+// Режим A/B сравнения для tester:
+//
+//   tester --ab A B [--rounds N] [--scenes s1,s2] [--cpu N] [--threshold PCT]
+//                   [--baseline FILE] [--save-baseline FILE]
+//   tester --measure KERNEL SCENE [--cpu N]
+//
+// A и B - имена ядер (basic, array, simd, formula-basic, formula-array,
+// formula-simd) или KERNEL@PATH - то же ядро другой сборки tester, которую
+// каждый раунд запускают с --measure. Раунд меряет A, B, B, A подряд на
+// одной сцене, так что линейный дрейф за раунд сокращается, а сравниваются
+// пары из одного раунда. Процесс прибит к одному ядру, время каждого замера
+// делится на медиану калибровочных циклов, прогнанных до, между и после
+// его запусков: так изменения частоты ядра (турбо, нагрев) одинаково
+// растягивают оба и сокращаются.
+//
+// Ускорение B относительно A - среднее геометрическое отношений по раундам
+// с доверительным интервалом по Стьюденту и парным t-тестом. Сохранённые
+// нормированные времена служат базой: если ядро медленнее базы больше чем
+// на порог даже по нижней границе интервала, tester выходит с кодом 1.
+
+const int    AB_DEFAULT_ROUNDS        = 20;
+const int    AB_RUNS_PER_MEASUREMENT  = 3;
+const double AB_DEFAULT_THRESHOLD     = 0.05;
+const double AB_CONFIDENCE            = 0.95;
+const double AB_SIGNIFICANCE          = 0.05;
+const int    AB_CALIBRATION_STEPS     = 1 << 24;
+
+typedef struct SampleSummary
+{
+    int    count;
+    double mean;
+    double stddev;
+    double ci_low;               // AB_CONFIDENCE интервал для среднего
+    double ci_high;
+} SampleSummary;
+
+void   summarizeSamples(const double* samples, int count, SampleSummary* summary);
+
+// двусторонний p для t со степенями свободы dof
+double studentTwoSidedP(double t, int dof);
+double studentCriticalValue(double confidence, int dof);
+
+// разбирает argv и возвращает код выхода процесса
+int    runAbTest(int argc, char* argv[]);
+
+#endif // MANDELBROT_AB_TEST_H
@@ -0,0 +1,52 @@
+#ifndef MANDELBROT_ADAPTIVE_H
+#define MANDELBROT_ADAPTIVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mandelbrot_struct.h"
+
+const int ADAPTIVE_MIN_ITERATIONS        = 64;
+const int ADAPTIVE_MAX_ITERATIONS        = 8192;
+const int ADAPTIVE_BASE_ITERATIONS       = 256;
+const int ADAPTIVE_ITERATIONS_PER_OCTAVE = 64;
+
+// предварительный проход считает сетку PREPASS_GRID x PREPASS_GRID точек
+const int    PREPASS_GRID       = 64;
+const double NEAR_CAP_THRESHOLD = 0.01;
+
+typedef void (*IterationFieldFunction)(MandelbrotData* data);
+
+typedef struct IterationStatistics
+{
+    int    probes;
+    int    escaped;
+    int    probe_max_iterations;
+    int    escape_percentile;
+    double escaped_fraction;
+    double near_cap_fraction;
+} IterationStatistics;
+
+typedef struct AdaptiveFrameStatistics
+{
+    IterationStatistics prepass;
+
+    int      max_iterations;
+    double   prepass_ms;
+    double   frame_ms;
+
+    uint64_t total_iterations;
+    uint64_t interior_pixels;
+    uint64_t wasted_interior_iterations;
+} AdaptiveFrameStatistics;
+
+int  chooseMaxIterations(MandelbrotData* data, IterationStatistics* stats);
+void calculateAdaptiveIterationField(MandelbrotData* data,
+                                     IterationFieldFunction kernel,
+                                     AdaptiveFrameStatistics* stats);
+void collectFieldStatistics(MandelbrotData* data,
+                            bool kernel_skips_interior,
+                            AdaptiveFrameStatistics* stats);
+void printAdaptiveFrameStatistics(FILE* file, const AdaptiveFrameStatistics* stats);
+
+#endif // MANDELBROT_ADAPTIVE_H
@@ -0,0 +1,40 @@
+#ifndef MANDELBROT_ANTIALIAS_H
+#define MANDELBROT_ANTIALIAS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mandelbrot_struct.h"
+
+// сетка ANTIALIAS_GRID x ANTIALIAS_GRID подвыборок на пиксель
+const int    ANTIALIAS_GRID                = 4;
+const double ANTIALIAS_DISTANCE_THRESHOLD  = 1.0;
+const int    ANTIALIAS_ITERATION_THRESHOLD = 2;
+
+typedef enum AntialiasMode
+{
+    ANTIALIAS_BOUNDARY = 0,
+    ANTIALIAS_UNIFORM
+} AntialiasMode;
+
+typedef struct AntialiasStatistics
+{
+    uint64_t supersampled_pixels;
+    uint64_t samples;
+    double   supersampled_fraction;
+    double   ms;
+} AntialiasStatistics;
+
+// Перекрашивает в pixels пиксели, которые в режиме ANTIALIAS_BOUNDARY лежат
+// ближе ANTIALIAS_DISTANCE_THRESHOLD ширин пикселя к множеству (если
+// data->distance_per_pixel посчитан) или у которых число итераций
+// отличается от соседей больше чем на ANTIALIAS_ITERATION_THRESHOLD.
+// ANTIALIAS_UNIFORM перекрашивает все пиксели и нужен для сравнения.
+void antialiasIterationField(int pitch, 
+                             uint32_t* pixels, 
+                             MandelbrotData* data,
+                             AntialiasMode mode,
+                             AntialiasStatistics* stats);
+void printAntialiasStatistics(FILE* file, const AntialiasStatistics* stats);
+
+#endif // MANDELBROT_ANTIALIAS_H
@@ -16,9 +16,21 @@ typedef struct Benchmark
     const char* graphic_title;
     int warmup_runs;
     int measure_runs;
+    FormulaType formula;
 } Benchmark;
 
 void runBenchmark(Benchmark* config, uint64_t* results);
 void saveResults(Benchmark* config, uint64_t* results);
+void runAdaptiveReport(const char* file_path);
+void runAntialiasReport(const char* file_path);
+void runFieldLayoutReport(const char* file_path);
+void runProgressiveReport(const char* file_path);
+void runBuddhabrotReport(const char* file_path);
+void runEngineReport(const char* file_path);
+void runResolutionReport(const char* file_path);
+void runThumbnailReport(const char* file_path);
+void runFrameMemoryReport(const char* file_path);
+void runEqualizeReport(const char* file_path);
+void runOrbitCacheReport(const char* file_path);
 
 #endif // MANDELBROT_BENCHMARK_H
@@ -0,0 +1,97 @@
+#ifndef MANDELBROT_BUDDHABROT_H
+#define MANDELBROT_BUDDHABROT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mandelbrot_thread_pool.h"
+
+// Плотность орбит z -> z^2 + c. Точки c берутся случайно из верхней
+// половины квадрата [-2, 2] x [-2, 2], орбита сопряжённой точки сопряжена,
+// поэтому каждая орбита рисуется ещё и отражённой. Будда-брот рисует
+// орбиты, которые ушли на бесконечность не раньше min_iterations,
+// анти-Будда-брот - орбиты, которые не ушли за max_iterations.
+//
+// Каждый поток считает свою гистограмму, и только в конце они
+// складываются, так что при счёте нет ни атомиков, ни общих строк кэша.
+// Орбиты идут по 4 в AVX2 регистре: дорожка, орбита которой кончилась,
+// сразу получает новую точку. Точки в кардиоиде и круге периода 2 не
+// итерируются: для Будда-брота они отбрасываются, для анти-Будда-брота
+// сразу рисуются.
+//
+// При выборке по значимости сначала грубая сетка точек c оценивает, сколько
+// точек орбиты попадает в вид, и точки берутся из ячеек с этой
+// вероятностью, смешанной с равномерной. Вклад орбиты делится на отношение
+// вероятностей, поэтому картинка в среднем та же, но при увеличении шума
+// при том же числе выборок гораздо меньше.
+
+const int    BUDDHABROT_IMPORTANCE_GRID   = 256;
+const int    BUDDHABROT_IMPORTANCE_PROBES = 4;
+const double BUDDHABROT_UNIFORM_SHARE     = 0.2;
+const double BUDDHABROT_SAMPLE_RADIUS     = 2.0;
+
+const uint64_t BUDDHABROT_DEFAULT_SAMPLES      = 1 << 22;
+const uint64_t BUDDHABROT_DEFAULT_ANTI_SAMPLES = 1 << 20;
+const int      BUDDHABROT_DEFAULT_ITERATIONS      = 512;
+const int      BUDDHABROT_DEFAULT_ANTI_ITERATIONS = 64;
+
+typedef enum BuddhabrotMode
+{
+    BUDDHABROT_ESCAPING = 0,
+    BUDDHABROT_ANTI
+} BuddhabrotMode;
+
+typedef struct BuddhabrotConfig
+{
+    BuddhabrotMode mode;
+    double   center_x;
+    double   center_y;
+    double   view_width;
+    double   view_height;
+    int      min_iterations;
+    int      max_iterations;
+    uint64_t samples;
+    bool     importance_sampling;
+    uint64_t seed;
+} BuddhabrotConfig;
+
+typedef struct Buddhabrot
+{
+    int     width;
+    int     height;
+    int     threads;
+    float*  histogram;            // сумма гистограмм потоков
+    float** thread_histograms;
+    float   max_density;
+
+    double* cell_cdf;             // выборка по значимости, иначе не заполнен
+    int     cells;
+} Buddhabrot;
+
+typedef struct BuddhabrotStatistics
+{
+    uint64_t samples;
+    uint64_t rejected_interior;
+    uint64_t orbits;              // орбиты, попавшие в гистограмму
+    uint64_t orbit_points;
+    int      threads;
+    double   importance_ms;
+    double   ms;
+    double   samples_per_second;
+} BuddhabrotStatistics;
+
+void setDefaultBuddhabrotConfig(BuddhabrotConfig* config, BuddhabrotMode mode);
+
+int  createBuddhabrot(Buddhabrot* buddhabrot, int width, int height, int threads);
+void destroyBuddhabrot(Buddhabrot* buddhabrot);
+
+// threadPoolSize(pool) не должен быть больше buddhabrot->threads
+void renderBuddhabrot(Buddhabrot* buddhabrot,
+                      const BuddhabrotConfig* config,
+                      ThreadPool* pool,
+                      BuddhabrotStatistics* stats);
+void colorizeBuddhabrot(int pitch, uint32_t* pixels, const Buddhabrot* buddhabrot);
+
+void printBuddhabrotStatistics(FILE* file, const BuddhabrotStatistics* stats);
+
+#endif // MANDELBROT_BUDDHABROT_H
@@ -0,0 +1,41 @@
+#ifndef MANDELBROT_COLORIZE_H
+#define MANDELBROT_COLORIZE_H
+
+#include <stdint.h>
+
+#include "mandelbrot_struct.h"
+#include "mandelbrot_thread_pool.h"
+
+void colorizeIterationField(int pitch, uint32_t* pixels, MandelbrotData* data);
+void colorizeIterationRect(int pitch, uint32_t* pixels, MandelbrotData* data, FieldRect rect);
+
+// Раскраска с выравниванием гистограммы: вышедшая точка получает цвет по
+// доле вышедших точек кадра с не большим числом итераций, и палитра
+// растягивается на те значения, которые в кадре действительно есть.
+// Задачи пула считают гистограмму каждая в своих бинах, бины складываются,
+// префиксная сумма превращается в таблицу цвета по числу итераций, и поле
+// раскрашивается по ней сборкой AVX2, как обычной палитрой. Нужно всё
+// поле сразу, поэтому по прямоугольникам так раскрашивать нельзя.
+
+const int COLOR_HISTOGRAM_TASKS_PER_THREAD = 2;
+const int COLOR_HISTOGRAM_COPIES           = 4;
+
+typedef struct ColorHistogram
+{
+    ThreadPool* pool;            // NULL - всё в вызывающем потоке
+    int         tasks;
+    int         capacity;        // бинов у задачи, кратно 8
+    uint32_t*   bins;            // tasks * COLOR_HISTOGRAM_COPIES * capacity
+    uint32_t*   lookup;          // цвет по числу итераций
+} ColorHistogram;
+
+int  createColorHistogram(ColorHistogram* histogram, ThreadPool* pool);
+void destroyColorHistogram(ColorHistogram* histogram);
+
+// бины растут под data->max_iterations сами
+int  colorizeEqualizedIterationField(int pitch,
+                                     uint32_t* pixels,
+                                     MandelbrotData* data,
+                                     ColorHistogram* histogram);
+
+#endif // MANDELBROT_COLORIZE_H
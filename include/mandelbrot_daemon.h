@@ -0,0 +1,104 @@
+#ifndef MANDELBROT_DAEMON_H
+#define MANDELBROT_DAEMON_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+
+#include "mandelbrot_tile_cache.h"
+
+// Демон отдаёт раскрашенные плитки DAEMON_TILE_SIZE x DAEMON_TILE_SIZE из
+// пирамиды уровней: плитка уровня 0 покрывает квадрат DAEMON_WORLD_SIZE с
+// левым верхним углом (DAEMON_WORLD_LEFT, DAEMON_WORLD_TOP), на каждом
+// следующем уровне сторона плитки вдвое меньше, tile_y растёт вниз.
+//
+// Клиент шлёт DaemonRequest, демон отвечает DaemonResponse, за которым
+// для DAEMON_TILE_READY идут DAEMON_TILE_PIXELS пикселей RGBA, а для
+// DAEMON_STATISTICS - структура DaemonStatistics. Ответы на разные запросы
+// приходят в порядке готовности, а не в порядке запросов.
+
+const int      DAEMON_TILE_SIZE    = 256;
+const int      DAEMON_TILE_PIXELS  = DAEMON_TILE_SIZE * DAEMON_TILE_SIZE;
+const double   DAEMON_WORLD_SIZE   = 4.0;
+const double   DAEMON_WORLD_LEFT   = -2.5;
+const double   DAEMON_WORLD_TOP    = 2.0;
+const int      DAEMON_MAX_LEVEL    = 40;
+// плитка целиком внутри множества стоит DAEMON_TILE_PIXELS * max_iterations
+// итераций, предел держит её в пределах долей секунды на поток
+const int      DAEMON_MAX_ITERATIONS = 1 << 13;
+
+const int      DAEMON_MAX_CLIENTS   = 256;
+const int      DEFAULT_CACHE_TILES  = 512;
+const uint32_t DAEMON_MESSAGE_MAGIC = 0x4D44454D; // "MEDM"
+
+// сокеты клиентов неблокирующие: клиент, который за DAEMON_CLIENT_STALL_MS
+// не дослал начатый запрос или не забрал ни байта ответа, отключается,
+// как и клиент, у которого неотправленных ответов больше
+// DAEMON_CLIENT_BACKLOG_TILES плиток
+const int      DAEMON_CLIENT_STALL_MS      = 5000;
+const int      DAEMON_CLIENT_BACKLOG_TILES = 64;
+const int      DAEMON_REQUESTS_PER_POLL    = 64;
+
+typedef enum DaemonMessageType
+{
+    DAEMON_REQUEST_TILE = 1,
+    DAEMON_CANCEL_TILE,
+    DAEMON_REQUEST_STATISTICS,
+    DAEMON_TILE_READY,
+    DAEMON_STATISTICS
+} DaemonMessageType;
+
+// видимые плитки считаются раньше плиток, запрошенных про запас
+typedef enum TilePriority
+{
+    TILE_PRIORITY_VISIBLE = 0,
+    TILE_PRIORITY_PREFETCH,
+    TILE_PRIORITY_COUNT
+} TilePriority;
+
+typedef struct DaemonRequest
+{
+    uint32_t magic;
+    uint32_t type;
+    uint32_t request_id;
+    uint32_t priority;
+    TileKey  key;
+} DaemonRequest;
+
+typedef struct DaemonResponse
+{
+    uint32_t magic;
+    uint32_t type;
+    uint32_t request_id;
+    uint32_t cached;
+    uint64_t render_ns;
+} DaemonResponse;
+
+typedef struct DaemonStatistics
+{
+    uint64_t requests;
+    uint64_t cache_hits;
+    uint64_t coalesced;     // запрос присоединился к уже считаемой плитке
+    uint64_t promoted;      // плитка из запаса стала видимой
+    uint64_t rendered;
+    uint64_t abandoned;     // все ждавшие отменили запрос до начала счёта
+    uint64_t cancelled;
+    uint64_t render_ns;
+    int32_t  cached_tiles;
+    int32_t  queued_tiles;
+} DaemonStatistics;
+
+typedef struct DaemonConfig
+{
+    const char* address;
+    int threads;
+    int cache_tiles;
+} DaemonConfig;
+
+// работает, пока *stop не станет ненулевым (обычно из обработчика сигнала)
+int  runMandelbrotDaemon(const DaemonConfig* config, volatile sig_atomic_t* stop);
+
+void tileViewport(const TileKey* key, double* center_x, double* center_y, double* size);
+void printDaemonStatistics(FILE* file, const DaemonStatistics* stats);
+
+#endif // MANDELBROT_DAEMON_H
@@ -0,0 +1,132 @@
+#ifndef MANDELBROT_DISTRIBUTED_H
+#define MANDELBROT_DISTRIBUTED_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "mandelbrot_struct.h"
+
+// Координатор делит поле на плитки FIELD_TILE_SIZE x FIELD_TILE_SIZE и
+// раздаёт их рабочим процессам через unix- или tcp-сокеты. Адрес задаётся
+// строкой "unix:/path/to/socket" или "tcp:host:port". Сообщения передаются
+// в родном порядке байт, так что координатор и рабочие должны работать на
+// машинах одной архитектуры.
+
+const int      MAX_DISTRIBUTED_WORKERS  = 64;
+const int      DEFAULT_PIPELINE_DEPTH   = 2;
+const int      MAX_PIPELINE_DEPTH       = 8;
+const double   DEFAULT_STRAGGLER_FACTOR = 4.0;
+const double   MIN_STRAGGLER_MS         = 20.0;
+const int      WORKER_ACCEPT_TIMEOUT_MS = 5000;
+const uint32_t TILE_MESSAGE_MAGIC       = 0x4D414E44; // "MAND"
+
+// рабочий не доверяет запросу: поле и число итераций больше этих
+// пределов, как и плитка за краем поля, считаются испорченным запросом
+const int      MAX_DISTRIBUTED_FIELD_SIDE = 1 << 15;
+const int      MAX_DISTRIBUTED_ITERATIONS = 1 << 16;
+
+typedef struct TileRequest
+{
+    uint32_t  magic;
+    uint32_t  frame;
+    int32_t   slot;
+    FieldRect rect;
+
+    int32_t   field_width;
+    int32_t   field_height;
+    int32_t   max_iterations;
+    int32_t   formula;
+
+    double    center_x;
+    double    center_y;
+    double    width;
+    double    height;
+    double    julia_re;
+    double    julia_im;
+} TileRequest;
+
+// за заголовком идут rect.width * rect.height счётчиков int32 построчно
+typedef struct TileResponse
+{
+    uint32_t  magic;
+    uint32_t  frame;
+    int32_t   slot;
+    FieldRect rect;
+    uint64_t  compute_ns;
+} TileResponse;
+
+typedef struct DistributedConfig
+{
+    const char* address;
+    int    local_workers;
+    int    expected_workers;
+    int    pipeline_depth;
+    double straggler_factor;
+
+    // для проверки отказоустойчивости: первый рабочий умирает после
+    // fail_worker_after плиток, второй считает каждую плитку дольше на
+    // slow_worker_delay_ms
+    int    fail_worker_after;
+    int    slow_worker_delay_ms;
+} DistributedConfig;
+
+typedef struct DistributedStatistics
+{
+    double frame_ms;
+    int    tiles;
+    int    workers;
+    int    dead_workers;
+    int    redispatched_tiles;
+    int    duplicated_tiles;
+    int    local_tiles;
+    int    tiles_per_worker[MAX_DISTRIBUTED_WORKERS];
+    double busy_ms_per_worker[MAX_DISTRIBUTED_WORKERS];
+} DistributedStatistics;
+
+// копии отстающих плиток могут досчитываться уже во время следующего
+// кадра, поэтому каждая отправленная плитка помнит свой кадр
+typedef struct DistributedWorker
+{
+    int       fd;
+    bool      alive;
+    int       in_flight;
+    int       slots[MAX_PIPELINE_DEPTH];
+    uint32_t  frames[MAX_PIPELINE_DEPTH];
+    FieldRect rects[MAX_PIPELINE_DEPTH];     // поле кадра могло с тех пор смениться
+    uint64_t  sent_ns[MAX_PIPELINE_DEPTH];
+} DistributedWorker;
+
+typedef struct DistributedCoordinator
+{
+    DistributedConfig config;
+
+    int      listen_fd;
+    char     socket_path[108];
+    uint32_t frame;
+
+    int               number_of_workers;
+    DistributedWorker workers[MAX_DISTRIBUTED_WORKERS];
+
+    int   number_of_local_workers;
+    pid_t local_pids[MAX_DISTRIBUTED_WORKERS];
+
+    // измеренная стоимость плиток прошлого кадра, по ней плитки
+    // раздаются от самых дорогих к самым дешёвым
+    int       number_of_tiles;
+    uint64_t* tile_cost_ns;
+} DistributedCoordinator;
+
+void setDefaultDistributedConfig(DistributedConfig* config, const char* address);
+
+int  startCoordinator(DistributedCoordinator* coordinator, const DistributedConfig* config);
+int  renderDistributed(DistributedCoordinator* coordinator,
+                       MandelbrotData* data,
+                       DistributedStatistics* stats);
+void stopCoordinator(DistributedCoordinator* coordinator);
+
+int  runMandelbrotWorker(const char* address, int fail_after, int delay_ms);
+
+void printDistributedStatistics(FILE* file, const DistributedStatistics* stats);
+
+#endif // MANDELBROT_DISTRIBUTED_H
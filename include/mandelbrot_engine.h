@@ -0,0 +1,156 @@
+#ifndef MANDELBROT_ENGINE_H
+#define MANDELBROT_ENGINE_H
+
+#include <stdint.h>
+
+#include <future>
+#include <memory>
+#include <coroutine>
+#include <mutex>
+#include <condition_variable>
+
+#include "mandelbrot_struct.h"
+#include "mandelbrot_thread_pool.h"
+
+// Интерфейс libmandel для встраивания. Задача описывается видом
+// RenderViewport и ничего не разделяет с другими: у каждой своя копия
+// MandelbrotData и палитры, так что задачи с разными видами можно
+// отправлять из любых потоков одновременно. Все задачи одного движка
+// считаются плитками на одном пуле потоков.
+//
+// Результат приходит через std::future или co_await. Поле и картинка
+// владеют памятью сами и при уничтожении возвращают её в пул буферов
+// движка, так что следующая задача того же размера не выделяет память.
+// Буферы могут пережить движок. Если памяти не хватило, буфер приходит
+// пустым (valid() == false).
+
+const int ENGINE_POOLED_BUFFERS = 16;
+
+typedef struct RenderViewport
+{
+    int         width;            // пиксели, кратно 16
+    int         height;
+    double      center_x;
+    double      center_y;
+    double      view_width;       // высота по пропорциям картинки
+    int         max_iterations;
+    FormulaType formula;
+    double      julia_re;
+    double      julia_im;
+    FieldLayout layout;
+} RenderViewport;
+
+void setDefaultRenderViewport(RenderViewport* viewport, int width, int height);
+
+struct BufferPool;
+
+class FieldBuffer
+{
+public:
+    FieldBuffer();
+    FieldBuffer(FieldBuffer&& other) noexcept;
+    FieldBuffer& operator=(FieldBuffer&& other) noexcept;
+    FieldBuffer(const FieldBuffer&) = delete;
+    FieldBuffer& operator=(const FieldBuffer&) = delete;
+    ~FieldBuffer();
+
+    bool valid() const { return field.data != NULL; }
+
+    IterationField field;
+    RenderViewport viewport;
+
+private:
+    friend struct RenderJob;
+    std::shared_ptr<BufferPool> pool;
+};
+
+class ImageBuffer
+{
+public:
+    ImageBuffer();
+    ImageBuffer(ImageBuffer&& other) noexcept;
+    ImageBuffer& operator=(ImageBuffer&& other) noexcept;
+    ImageBuffer(const ImageBuffer&) = delete;
+    ImageBuffer& operator=(const ImageBuffer&) = delete;
+    ~ImageBuffer();
+
+    bool valid() const { return pixels != NULL; }
+
+    uint32_t*      pixels;        // RGBA32, выровнено на 32
+    int            width;
+    int            height;
+    int            pitch;
+    RenderViewport viewport;
+
+private:
+    friend struct RenderJob;
+    std::shared_ptr<BufferPool> pool;
+    size_t bytes;
+};
+
+struct RenderJob;
+class MandelbrotEngine;
+
+// co_await engine.fieldAwaitable(viewport) продолжает корутину в потоке
+// пула, когда поле готово
+template <typename Buffer>
+class RenderAwaitable
+{
+public:
+    bool   await_ready() const { return false; }
+    void   await_suspend(std::coroutine_handle<> continuation);
+    Buffer await_resume() { return static_cast<Buffer&&>(result); }
+
+private:
+    friend class MandelbrotEngine;
+    friend struct RenderJob;
+
+    RenderAwaitable(MandelbrotEngine* engine, const RenderViewport& viewport, const uint32_t* palette)
+        : engine(engine), viewport(viewport), palette(palette) {}
+
+    MandelbrotEngine* engine;
+    RenderViewport    viewport;
+    const uint32_t*   palette;
+    Buffer            result;
+};
+
+class MandelbrotEngine
+{
+public:
+    // threads <= 0 - по числу ядер
+    explicit MandelbrotEngine(int threads = 0);
+    ~MandelbrotEngine();
+
+    MandelbrotEngine(const MandelbrotEngine&) = delete;
+    MandelbrotEngine& operator=(const MandelbrotEngine&) = delete;
+
+    // palette - MAX_ITERATIONS цветов RGBA32 или NULL для стандартной
+    std::future<FieldBuffer> renderField(const RenderViewport& viewport);
+    std::future<ImageBuffer> renderImage(const RenderViewport& viewport, const uint32_t* palette = NULL);
+
+    RenderAwaitable<FieldBuffer> fieldAwaitable(const RenderViewport& viewport);
+    RenderAwaitable<ImageBuffer> imageAwaitable(const RenderViewport& viewport,
+                                                const uint32_t* palette = NULL);
+
+    int threads() const { return threadPoolSize(pool); }
+
+private:
+    friend struct RenderJob;
+    template <typename Buffer> friend class RenderAwaitable;
+
+    void submit(RenderJob* job);
+    void finish(RenderJob* job);
+
+    ThreadPool*                 pool;
+    std::shared_ptr<BufferPool> buffers;
+    alignas(32) uint32_t        default_palette[512];
+
+    std::mutex                  lock;
+    std::condition_variable     jobs_done;
+    int                         active_jobs;
+};
+
+template <> void RenderAwaitable<FieldBuffer>::await_suspend(std::coroutine_handle<> continuation);
+template <> void RenderAwaitable<ImageBuffer>::await_suspend(std::coroutine_handle<> continuation);
+
+#endif // MANDELBROT_ENGINE_H
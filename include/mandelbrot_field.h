@@ -0,0 +1,185 @@
+#ifndef MANDELBROT_FIELD_H
+#define MANDELBROT_FIELD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <immintrin.h>
+
+// Поле итераций хранится либо построчно, либо плитками FIELD_TILE_SIZE x
+// FIELD_TILE_SIZE, внутри которых пиксели лежат построчно. В раскладке
+// FIELD_LAYOUT_MORTON плитки упорядочены по кривой Мортона, поэтому соседние
+// по номеру плитки соседствуют и на экране.
+//
+// Ядра пишут в поле кусками по 4, 8 или 16 пикселей, начинающимися с
+// кратного их длине x. Такой кусок никогда не пересекает границу плитки,
+// так что в любой раскладке он лежит в памяти подряд.
+
+const int FIELD_TILE_SIZE  = 64;
+const int FIELD_TILE_SHIFT = 6;
+const int FIELD_TILE_AREA  = FIELD_TILE_SIZE * FIELD_TILE_SIZE;
+
+const int FIELD_U16_MAX_ITERATIONS = UINT16_MAX;
+
+typedef enum FieldFormat
+{
+    FIELD_FORMAT_I32 = 0,
+    FIELD_FORMAT_U16
+} FieldFormat;
+
+typedef enum FieldLayout
+{
+    FIELD_LAYOUT_ROWS = 0,
+    FIELD_LAYOUT_TILED,
+    FIELD_LAYOUT_MORTON
+} FieldLayout;
+
+typedef struct FieldRect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+} FieldRect;
+
+typedef struct IterationField
+{
+    void*       data;
+    size_t      bytes;
+
+    int         width;
+    int         height;
+    FieldFormat format;
+    FieldLayout layout;
+
+    int         tiles_x;
+    int         tiles_y;
+    int*        tile_slots;   // номер плитки в памяти по её номеру на экране
+    int*        slot_tiles;   // обратная перестановка
+
+    bool        external_data; // data принадлежит не полю, а, например, файлу
+} IterationField;
+
+int  createIterationField(IterationField* field,
+                          int width,
+                          int height,
+                          FieldFormat format,
+                          FieldLayout layout);
+// поле поверх чужой памяти в iterationFieldBytes байт, выровненной на 32;
+// destroyIterationField её не освобождает
+int  attachIterationField(IterationField* field,
+                          void* data,
+                          int width,
+                          int height,
+                          FieldFormat format,
+                          FieldLayout layout);
+void destroyIterationField(IterationField* field);
+
+size_t iterationFieldBytes(int width, int height, FieldFormat format, FieldLayout layout);
+
+FieldFormat chooseFieldFormat(int max_iterations);
+bool fieldFitsIterations(const IterationField* field, int max_iterations);
+
+FieldRect fieldRect(const IterationField* field);
+int       fieldTileCount(const IterationField* field);
+FieldRect fieldTileRect(const IterationField* field, int slot);
+
+
+static inline size_t fieldIndex(const IterationField* field, int x, int y)
+{
+    if (field->layout == FIELD_LAYOUT_ROWS)
+    {
+        return (size_t)y * field->width + x;
+    }
+
+    const int tile = (y >> FIELD_TILE_SHIFT) * field->tiles_x + (x >> FIELD_TILE_SHIFT);
+    const int inner_x = x & (FIELD_TILE_SIZE - 1);
+    const int inner_y = y & (FIELD_TILE_SIZE - 1);
+
+    return (size_t)field->tile_slots[tile] * FIELD_TILE_AREA
+         + inner_y * FIELD_TILE_SIZE + inner_x;
+}
+
+
+static inline int fieldLoad(const IterationField* field, int x, int y)
+{
+    const size_t index = fieldIndex(field, x, y);
+
+    return (field->format == FIELD_FORMAT_U16)
+         ? ((const uint16_t*)field->data)[index]
+         : ((const int*)field->data)[index];
+}
+
+
+static inline void fieldStore(IterationField* field, int x, int y, int iterations)
+{
+    const size_t index = fieldIndex(field, x, y);
+
+    if (field->format == FIELD_FORMAT_U16)
+    {
+        ((uint16_t*)field->data)[index] = (uint16_t)iterations;
+    }
+    else
+    {
+        ((int*)field->data)[index] = iterations;
+    }
+}
+
+
+static inline void fieldStoreSpan(IterationField* field, int x, int y,
+                                  const int* iterations, int count)
+{
+    const size_t index = fieldIndex(field, x, y);
+
+    if (field->format == FIELD_FORMAT_U16)
+    {
+        uint16_t* span = (uint16_t*)field->data + index;
+        for (int i = 0; i < count; i++)
+        {
+            span[i] = (uint16_t)iterations[i];
+        }
+    }
+    else
+    {
+        memcpy((int*)field->data + index, iterations, count * sizeof(int));
+    }
+}
+
+
+// index кратен 8
+static inline __m256i fieldLoad8At(const IterationField* field, size_t index)
+{
+    if (field->format == FIELD_FORMAT_U16)
+    {
+        __m128i packed = _mm_load_si128((const __m128i*)((const uint16_t*)field->data + index));
+        return _mm256_cvtepu16_epi32(packed);
+    }
+
+    return _mm256_load_si256((const __m256i*)((const int*)field->data + index));
+}
+
+
+// x кратен 8
+static inline __m256i fieldLoad8(const IterationField* field, int x, int y)
+{
+    return fieldLoad8At(field, fieldIndex(field, x, y));
+}
+
+
+// x кратен 4
+static inline void fieldStore4(IterationField* field, int x, int y, __m128i iterations)
+{
+    const size_t index = fieldIndex(field, x, y);
+
+    if (field->format == FIELD_FORMAT_U16)
+    {
+        _mm_storel_epi64((__m128i*)((uint16_t*)field->data + index),
+                         _mm_packus_epi32(iterations, iterations));
+    }
+    else
+    {
+        _mm_store_si128((__m128i*)((int*)field->data + index), iterations);
+    }
+}
+
+#endif // MANDELBROT_FIELD_H
@@ -0,0 +1,125 @@
+#ifndef MANDELBROT_FIELD_FILE_H
+#define MANDELBROT_FIELD_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mandelbrot_struct.h"
+#include "mandelbrot_progressive.h"
+#include "mandelbrot_thread_pool.h"
+
+// Файл поля итераций: заголовок с видом и геометрией поля, биты готовности
+// плиток (по номеру плитки в памяти) и данные поля. Все части начинаются с
+// границы страницы.
+//
+// В несжатом файле данные лежат байт в байт как IterationField.data, так
+// что поле отображается в память и считается прямо в файл: плитка
+// сначала записывается, а потом получает бит готовности. Отображение общее,
+// поэтому после гибели процесса записанное остаётся в кэше страниц, и
+// следующий запуск досчитывает только плитки без бита. Читатели
+// отображают файл и получают поле без копирования.
+//
+// Сжатый файл (FIELD_COMPRESSION_RLE) пишется из готового и хранит каждый
+// блок в FIELD_TILE_AREA счётчиков сериями (длина uint16, значение);
+// перед данными лежит таблица смещений блоков.
+
+const uint64_t FIELD_FILE_MAGIC     = 0x31444C4946444E4DULL; // "MNDFLD1"
+const uint32_t FIELD_FILE_VERSION   = 1;
+const size_t   FIELD_FILE_ALIGNMENT = 4096;
+
+typedef enum FieldCompression
+{
+    FIELD_COMPRESSION_NONE = 0,
+    FIELD_COMPRESSION_RLE
+} FieldCompression;
+
+typedef struct FieldFileHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t compression;
+
+    int32_t  width;
+    int32_t  height;
+    int32_t  format;
+    int32_t  layout;
+    int32_t  max_iterations;
+    int32_t  formula;
+
+    double   center_x;
+    double   center_y;
+    double   view_width;
+    double   view_height;
+    double   julia_re;
+    double   julia_im;
+
+    uint64_t bits_offset;
+    uint64_t data_offset;
+    uint64_t data_bytes;
+    uint64_t blocks_offset;     // только для сжатого: blocks + 1 смещений от data_offset
+    uint64_t blocks;
+} FieldFileHeader;
+
+typedef struct FieldFile
+{
+    int              fd;
+    void*            map;
+    size_t           map_bytes;
+    bool             writable;
+
+    FieldFileHeader* header;
+    uint64_t*        done_bits;
+    int              tiles;
+
+    IterationField   field;     // для несжатого data указывает в отображение
+} FieldFile;
+
+typedef struct FieldFileStatistics
+{
+    int    tiles;
+    int    tiles_resumed;       // были готовы до запуска
+    int    tiles_rendered;
+    double ms;
+} FieldFileStatistics;
+
+// создаёт файл под вид data и поле заданной геометрии (data->field не
+// используется), старый файл перезаписывается
+int  createFieldFile(FieldFile* file,
+                     const char* path,
+                     const MandelbrotData* data,
+                     int width,
+                     int height,
+                     FieldFormat format,
+                     FieldLayout layout);
+int  openFieldFile(FieldFile* file, const char* path, bool writable);
+void closeFieldFile(FieldFile* file);
+
+// тот же вид, число итераций, формула и геометрия поля
+bool fieldFileMatches(const FieldFile* file,
+                      const MandelbrotData* data,
+                      int width,
+                      int height,
+                      FieldFormat format,
+                      FieldLayout layout);
+void loadFieldFileViewport(const FieldFile* file, MandelbrotData* data);
+
+bool fieldTileDone(const FieldFile* file, int slot);
+int  fieldFileTilesDone(const FieldFile* file);
+
+// досчитывает несжатый файл с видом data; tile_limit < 0 - без
+// ограничения числа плиток
+void renderFieldFile(FieldFile* file,
+                     const MandelbrotData* data,
+                     IterationRectFunction rect_func,
+                     ThreadPool* pool,
+                     int tile_limit,
+                     FieldFileStatistics* stats);
+
+int  compressFieldFile(const FieldFile* file, const char* path);
+// поле файла любого вида в field, созданное createIterationField
+int  readFieldFile(const FieldFile* file, IterationField* field);
+
+void printFieldFileStatistics(FILE* file, const FieldFileStatistics* stats);
+
+#endif // MANDELBROT_FIELD_FILE_H
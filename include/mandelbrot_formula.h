@@ -0,0 +1,210 @@
+#ifndef MANDELBROT_FORMULA_H
+#define MANDELBROT_FORMULA_H
+
+#include <immintrin.h>
+
+// Каждая формула описывает один шаг z -> f(z) + c. Ядро само считает
+// x2 = x * x и y2 = y * y для проверки выхода из радиуса и передаёт их в
+// step(), чтобы формула не пересчитывала квадраты. Все методы static inline,
+// поэтому после инстанцирования шаблона ядра от формулы не остаётся вызовов.
+//
+// STARTS_AT_PIXEL = true означает множество Жюлиа: z0 - координата пикселя,
+// а c берётся из параметров (julia_re, julia_im).
+//
+// HAS_INTERIOR_TEST = true означает, что у формулы есть дешёвая проверка
+// принадлежности c множеству (isInterior), и ядро может не итерировать
+// такие точки до max_iterations.
+//
+// HAS_DISTANCE_ESTIMATE = true означает, что derivative() обновляет
+// производную dz/dc (для Жюлиа dz/dz0) по текущему z до шага, и по ней
+// можно оценить расстояние до множества |z| ln|z| / |dz|.
+
+
+struct MandelbrotFormula
+{
+    static const bool STARTS_AT_PIXEL       = false;
+    static const bool HAS_INTERIOR_TEST     = true;
+    static const bool HAS_DISTANCE_ESTIMATE = true;
+
+    // главная кардиоида и круг периода 2
+    static inline bool isInterior(double cx, double cy)
+    {
+        double qx = cx - 0.25;
+        double y2 = cy * cy;
+        double q  = qx * qx + y2;
+
+        return q * (q + qx) <= 0.25 * y2
+            || (cx + 1.0) * (cx + 1.0) + y2 <= 0.0625;
+    }
+
+    static inline __m256d isInterior(__m256d cx, __m256d cy)
+    {
+        __m256d qx = _mm256_sub_pd(cx, _mm256_set1_pd(0.25));
+        __m256d y2 = _mm256_mul_pd(cy, cy);
+        __m256d q  = _mm256_fmadd_pd(qx, qx, y2);
+
+        __m256d cardioid = _mm256_cmp_pd(
+            _mm256_mul_pd(q, _mm256_add_pd(q, qx)),
+            _mm256_mul_pd(_mm256_set1_pd(0.25), y2),
+            _CMP_LE_OQ
+        );
+
+        __m256d bx = _mm256_add_pd(cx, _mm256_set1_pd(1.0));
+        __m256d bulb = _mm256_cmp_pd(
+            _mm256_fmadd_pd(bx, bx, y2),
+            _mm256_set1_pd(0.0625),
+            _CMP_LE_OQ
+        );
+
+        return _mm256_or_pd(cardioid, bulb);
+    }
+
+    static inline void step(double* x, double* y, double x2, double y2,
+                            double cx, double cy)
+    {
+        *y = (*x + *x) * *y + cy;
+        *x = x2 - y2 + cx;
+    }
+
+    static inline void step(__m256d* x, __m256d* y, __m256d x2, __m256d y2,
+                            __m256d cx, __m256d cy)
+    {
+        *y = _mm256_fmadd_pd(_mm256_add_pd(*x, *x), *y, cy);
+        *x = _mm256_add_pd(_mm256_sub_pd(x2, y2), cx);
+    }
+
+    // dz = 2 z dz + 1
+    static inline void derivative(__m256d* dzx, __m256d* dzy, __m256d x, __m256d y)
+    {
+        squareDerivative(dzx, dzy, x, y);
+        *dzx = _mm256_add_pd(*dzx, _mm256_set1_pd(1.0));
+    }
+
+    // dz = 2 z dz
+    static inline void squareDerivative(__m256d* dzx, __m256d* dzy, __m256d x, __m256d y)
+    {
+        __m256d two_x = _mm256_add_pd(x, x);
+        __m256d two_y = _mm256_add_pd(y, y);
+
+        __m256d next_dzx = _mm256_fmsub_pd(two_x, *dzx, _mm256_mul_pd(two_y, *dzy));
+        *dzy = _mm256_fmadd_pd(two_x, *dzy, _mm256_mul_pd(two_y, *dzx));
+        *dzx = next_dzx;
+    }
+};
+
+
+struct JuliaFormula : MandelbrotFormula
+{
+    static const bool STARTS_AT_PIXEL       = true;
+    static const bool HAS_INTERIOR_TEST     = false;
+    static const bool HAS_DISTANCE_ESTIMATE = true;
+
+    static inline void derivative(__m256d* dzx, __m256d* dzy, __m256d x, __m256d y)
+    {
+        squareDerivative(dzx, dzy, x, y);
+    }
+};
+
+
+// z = (|Re z| + i|Im z|)^2 + c
+// формула не голоморфна, поэтому оценки расстояния у неё нет
+struct BurningShipFormula
+{
+    static const bool STARTS_AT_PIXEL       = false;
+    static const bool HAS_INTERIOR_TEST     = false;
+    static const bool HAS_DISTANCE_ESTIMATE = false;
+
+    static inline bool    isInterior(double, double)   { return false; }
+    static inline __m256d isInterior(__m256d, __m256d) { return _mm256_setzero_pd(); }
+    static inline void    derivative(__m256d*, __m256d*, __m256d, __m256d) {}
+
+    static inline void step(double* x, double* y, double x2, double y2,
+                            double cx, double cy)
+    {
+        *y = 2.0 * __builtin_fabs(*x * *y) + cy;
+        *x = x2 - y2 + cx;
+    }
+
+    static inline void step(__m256d* x, __m256d* y, __m256d x2, __m256d y2,
+                            __m256d cx, __m256d cy)
+    {
+        const __m256d sign_bit = _mm256_set1_pd(-0.0);
+        __m256d xy = _mm256_andnot_pd(sign_bit, _mm256_mul_pd(*x, *y));
+
+        *y = _mm256_add_pd(_mm256_add_pd(xy, xy), cy);
+        *x = _mm256_add_pd(_mm256_sub_pd(x2, y2), cx);
+    }
+};
+
+
+// z = z^POWER + c, степень раскрывается в цепочку умножений на этапе компиляции
+template <int POWER>
+struct MultibrotFormula
+{
+    static_assert(POWER >= 2, "multibrot power must be at least 2");
+
+    static const bool STARTS_AT_PIXEL       = false;
+    static const bool HAS_INTERIOR_TEST     = false;
+    static const bool HAS_DISTANCE_ESTIMATE = true;
+
+    static inline bool    isInterior(double, double)   { return false; }
+    static inline __m256d isInterior(__m256d, __m256d) { return _mm256_setzero_pd(); }
+
+    static inline void step(double* x, double* y, double x2, double y2,
+                            double cx, double cy)
+    {
+        double zx = x2 - y2;
+        double zy = (*x + *x) * *y;
+
+        for (int i = 2; i < POWER; i++)
+        {
+            double next_zx = zx * *x - zy * *y;
+            zy = zx * *y + zy * *x;
+            zx = next_zx;
+        }
+
+        *x = zx + cx;
+        *y = zy + cy;
+    }
+
+    static inline void step(__m256d* x, __m256d* y, __m256d x2, __m256d y2,
+                            __m256d cx, __m256d cy)
+    {
+        __m256d zx = _mm256_sub_pd(x2, y2);
+        __m256d zy = _mm256_mul_pd(_mm256_add_pd(*x, *x), *y);
+
+        for (int i = 2; i < POWER; i++)
+        {
+            __m256d next_zx = _mm256_fmsub_pd(zx, *x, _mm256_mul_pd(zy, *y));
+            zy = _mm256_fmadd_pd(zx, *y, _mm256_mul_pd(zy, *x));
+            zx = next_zx;
+        }
+
+        *x = _mm256_add_pd(zx, cx);
+        *y = _mm256_add_pd(zy, cy);
+    }
+
+    // dz = POWER z^(POWER - 1) dz + 1
+    static inline void derivative(__m256d* dzx, __m256d* dzy, __m256d x, __m256d y)
+    {
+        __m256d wx = x;
+        __m256d wy = y;
+
+        for (int i = 2; i < POWER; i++)
+        {
+            __m256d next_wx = _mm256_fmsub_pd(wx, x, _mm256_mul_pd(wy, y));
+            wy = _mm256_fmadd_pd(wx, y, _mm256_mul_pd(wy, x));
+            wx = next_wx;
+        }
+
+        const __m256d power = _mm256_set1_pd(POWER);
+        wx = _mm256_mul_pd(wx, power);
+        wy = _mm256_mul_pd(wy, power);
+
+        __m256d next_dzx = _mm256_fmsub_pd(wx, *dzx, _mm256_mul_pd(wy, *dzy));
+        *dzy = _mm256_fmadd_pd(wx, *dzy, _mm256_mul_pd(wy, *dzx));
+        *dzx = _mm256_add_pd(next_dzx, _mm256_set1_pd(1.0));
+    }
+};
+
+#endif // MANDELBROT_FORMULA_H
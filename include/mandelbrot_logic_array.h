@@ -11,6 +11,7 @@ void calculateMandelbrotArraySeparated(int pitch,
                                        uint32_t* pixels,
                                        MandelbrotData* data);
 void calculateIterationFieldArray(MandelbrotData* data);
+void calculateIterationRectArray(MandelbrotData* data, FieldRect rect);
 
 
 
@@ -10,5 +10,6 @@ void calculateMandelbrotSeparated(int pitch,
                                   uint32_t* pixels,
                                   MandelbrotData* data);
 void calculateIterationField(MandelbrotData* data);
+void calculateIterationRect(MandelbrotData* data, FieldRect rect);
 
 #endif
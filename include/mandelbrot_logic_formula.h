@@ -0,0 +1,47 @@
+#ifndef MANDELBROT_LOGIC_FORMULA_H
+#define MANDELBROT_LOGIC_FORMULA_H
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+
+#include <stdint.h>
+
+#include "mandelbrot_struct.h"
+
+// Ядра для произвольной формулы из data->formula. Для каждой формулы
+// шаблон ядра инстанцируется отдельно, выбор происходит один раз на кадр.
+
+void calculateFormulaSeparated(int pitch,
+                               uint32_t* pixels,
+                               MandelbrotData* data);
+void calculateFormulaArraySeparated(int pitch,
+                                    uint32_t* pixels,
+                                    MandelbrotData* data);
+void calculateFormulaIntrinsicsSeparated(int pitch,
+                                         uint32_t* pixels,
+                                         MandelbrotData* data);
+
+int  calculateFormulaIterationsAtPoint(double x, double y, MandelbrotData* data);
+
+void calculateFormulaIterationField(MandelbrotData* data);
+void calculateFormulaIterationFieldArray(MandelbrotData* data);
+void calculateFormulaIterationFieldIntrinsics(MandelbrotData* data);
+
+void calculateFormulaIterationRect(MandelbrotData* data, FieldRect rect);
+void calculateFormulaIterationRectArray(MandelbrotData* data, FieldRect rect);
+void calculateFormulaIterationRectIntrinsics(MandelbrotData* data, FieldRect rect);
+
+// то же, что calculateFormulaIterationFieldIntrinsics, но дополнительно
+// заполняет data->distance_per_pixel оценкой расстояния до множества
+// (FLT_MAX для внутренних точек и формул без оценки)
+void calculateFormulaIterationFieldDistance(MandelbrotData* data);
+void calculateFormulaIterationRectDistance(MandelbrotData* data, FieldRect rect);
+
+// count должен делиться на 4
+void calculateFormulaIterationsAtPoints(const double* x, 
+                                        const double* y, 
+                                        int count,
+                                        int* iterations,
+                                        MandelbrotData* data);
+
+#endif // MANDELBROT_LOGIC_FORMULA_H
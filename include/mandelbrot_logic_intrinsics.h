@@ -13,5 +13,6 @@ void calculateMandelbrotIntrinsicsSeparated(int pitch,
                                             uint32_t* pixels,
                                             MandelbrotData* data);
 void calculateIterationsFieldIntrinsics(MandelbrotData* data);
+void calculateIterationsRectIntrinsics(MandelbrotData* data, FieldRect rect);
 
 #endif // MANDELBROT_LOGIC_INTRINSICS_H
@@ -0,0 +1,78 @@
+#ifndef MANDELBROT_MEMORY_H
+#define MANDELBROT_MEMORY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Пул буферов кадра: полей итераций, картинок, буферов задач движка.
+// Освобождённый буфер остаётся в пуле и отдаётся следующему запросу того
+// же размера, так что кадры, задачи и повторные запуски тестов не
+// выделяют память заново. Когда свободных буферов больше max_buffers или
+// они занимают больше max_bytes, вытесняются самые старые: после изменения
+// размера окна старые размеры уже не понадобятся.
+//
+// Буферы от FRAME_LARGE_BUFFER_BYTES берутся прямо у ядра через mmap.
+// С huge_pages они выровнены на 2 МБ и помечены MADV_HUGEPAGE, чтобы
+// поле 8K занимало десятки страниц TLB, а не десятки тысяч. С populate
+// страницы сразу заполняются одним вызовом вместо отказа на каждую; общий
+// пул его не включает: рабочий распределённого рендера держит поле во
+// весь кадр и рассчитывает, что память выделится только под его плитки.
+//
+// С first_touch страницы нового буфера никто не трогает до первой записи,
+// и ядро кладёт каждую на узел NUMA потока, который первым её записал.
+// Кадр так расходится по узлам всех потоков, а не ложится целиком на узел
+// потока, выделившего буфер. Закрепления плиток за узлами нет: плитки
+// раздаются потокам по мере освобождения, а буфер из пула хранит
+// размещение первого кадра, так что в следующих кадрах плитку может
+// считать поток другого узла. Плитка 64x64 занимает целые страницы по
+// 4 КБ, а страницу 2 МБ делили бы 128 плиток разных потоков, поэтому
+// first_touch отключает huge pages. По умолчанию first_touch включается
+// на машинах с несколькими узлами NUMA, huge_pages - на остальных.
+
+const size_t FRAME_LARGE_BUFFER_BYTES = 2u << 20;
+const size_t FRAME_HUGE_PAGE_BYTES    = 2u << 20;
+const int    FRAME_POOL_BUFFERS       = 16;
+const size_t FRAME_POOL_BYTES         = 512u << 20;
+
+typedef struct FramePoolConfig
+{
+    int    max_buffers;          // сколько свободных буферов держать
+    size_t max_bytes;            // и сколько памяти они могут занимать
+    bool   huge_pages;
+    bool   first_touch;
+    bool   populate;             // только вместе с huge_pages
+} FramePoolConfig;
+
+typedef struct FramePoolStatistics
+{
+    uint64_t acquired;
+    uint64_t reused;
+    uint64_t mapped;             // новые буферы через mmap
+    uint64_t allocated;          // новые мелкие буферы через aligned_alloc
+    uint64_t evicted;
+    size_t   cached_bytes;
+} FramePoolStatistics;
+
+typedef struct FramePool FramePool;
+
+int  numaNodeCount();
+void setDefaultFramePoolConfig(FramePoolConfig* config);
+
+FramePool* createFramePool(const FramePoolConfig* config);
+void       destroyFramePool(FramePool* pool);
+
+// общий пул библиотеки с настройками по умолчанию, живёт до конца процесса
+FramePool* defaultFramePool();
+
+// буфер выровнен на 32 байта, большие - на страницу; содержимое не задано
+void* acquireFrameBuffer(FramePool* pool, size_t bytes);
+void  releaseFrameBuffer(FramePool* pool, void* buffer, size_t bytes);
+
+// освобождает все свободные буферы пула
+void  trimFramePool(FramePool* pool);
+
+void  getFramePoolStatistics(FramePool* pool, FramePoolStatistics* stats);
+void  printFramePoolStatistics(FILE* file, const FramePoolStatistics* stats);
+
+#endif // MANDELBROT_MEMORY_H
@@ -0,0 +1,88 @@
+#ifndef MANDELBROT_ORBIT_CACHE_H
+#define MANDELBROT_ORBIT_CACHE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mandelbrot_struct.h"
+
+// Кэш опорных орбит для z^2 + c при приближении в одну область.
+//
+// Запись кэша - опорная точка c0, её орбита Z_n и коэффициенты ряда
+// z_n(c0 + d) - Z_n = A_n d + B_n d^2 + C_n d^3. Коэффициенты не зависят
+// от d, поэтому одна запись служит всем кадрам, в которые попадает c0:
+// клик по детали и приближение к ней дают кадры всё меньшего радиуса
+// вокруг той же опорной точки. Для кадра выбирается шаг K - последний,
+// на котором отброшенный член ряда мал относительно линейного и ни одна
+// точка кадра гарантированно не вышла за радиус 2. Каждая точка начинает
+// с z_K по ряду, а не с z = 0, и дальше итерируется как в SIMD ядре.
+//
+// Проверка точности до расчёта кадра: каждая ORBIT_CACHE_PROBE_STEP-я
+// восьмёрка точек каждой ORBIT_CACHE_PROBE_STEP-й строки считается и с
+// пропуском K, и с нуля. До бита совпасть нельзя: у граничных точек другой
+// порядок округлений меняет число итераций, и ядра basic, array и SIMD
+// тоже расходятся между собой на доли процента точек, а на больших
+// приближениях - на единицы процентов. Пока проб расходится больше
+// ORBIT_CACHE_MAX_MISMATCH, K уменьшается вдвое, и запись запоминает
+// уменьшенный предел для следующих кадров.
+
+const int    ORBIT_CACHE_ENTRIES      = 8;
+const int    ORBIT_CACHE_MIN_SKIP     = 8;      // меньше - выгоднее новая опорная точка
+const double ORBIT_CACHE_TOLERANCE    = 1e-3;   // ошибка ряда в долях пикселя
+const int    ORBIT_CACHE_PROBE_STEP   = 8;
+const double ORBIT_CACHE_MAX_MISMATCH = 0.03;   // доля расходящихся проб
+const int    ORBIT_CACHE_MAX_HALVINGS = 3;
+
+typedef struct OrbitStep
+{
+    double z_re;
+    double z_im;
+    double a_re;
+    double a_im;
+    double b_re;
+    double b_im;
+    double c_re;
+    double c_im;
+} OrbitStep;
+
+typedef struct OrbitEntry
+{
+    double     center_x;         // c0
+    double     center_y;
+    int        length;           // шагов орбиты, не больше max_iterations
+    int        max_skip;         // урезается после неудачной проверки
+    OrbitStep* steps;
+    uint64_t   last_used;
+} OrbitEntry;
+
+typedef struct OrbitCache
+{
+    OrbitEntry entries[ORBIT_CACHE_ENTRIES];
+    int        count;
+    uint64_t   clock;
+} OrbitCache;
+
+typedef struct OrbitCacheStatistics
+{
+    bool     reused;             // опорная орбита взята из кэша
+    int      skip;               // K
+    uint64_t pixels;
+    uint64_t iterations;         // выполнено после K
+    uint64_t saved;              // pixels * K
+    int      probes;
+    int      probe_mismatches;   // при принятом K
+    int      rejected_skips;     // сколько раз K уменьшался по пробам
+} OrbitCacheStatistics;
+
+void initOrbitCache(OrbitCache* cache);
+void destroyOrbitCache(OrbitCache* cache);
+
+// только FORMULA_MANDELBROT; результат в data->field
+int  calculateOrbitCachedField(OrbitCache* cache, MandelbrotData* data, OrbitCacheStatistics* stats);
+
+// то же ядро с z = 0, образец для проверки точности
+void calculateDirectIterationField(MandelbrotData* data);
+
+void printOrbitCacheStatistics(FILE* file, const OrbitCacheStatistics* stats);
+
+#endif // MANDELBROT_ORBIT_CACHE_H
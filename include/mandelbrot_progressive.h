@@ -0,0 +1,81 @@
+#ifndef MANDELBROT_PROGRESSIVE_H
+#define MANDELBROT_PROGRESSIVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mandelbrot_struct.h"
+
+// Кадр считается плитками поля от центра экрана к краям, каждая плитка -
+// полосами по PROGRESSIVE_STRIP_ROWS строк. Между полосами проверяется
+// бюджет времени и функция отмены, так что новый ввод прерывает кадр не
+// позже, чем через одну полосу. Недосчитанный кадр продолжается
+// со следующей полосы, если вид не изменился, и начинается заново, если
+// изменился. Пока новый кадр не досчитан, на месте его плиток остаётся
+// прошлый кадр, пересчитанный под новый масштаб и центр.
+
+const int PROGRESSIVE_STRIP_ROWS = 8;
+
+typedef void (*IterationRectFunction)(MandelbrotData* data, FieldRect rect);
+typedef bool (*FrameCancelFunction)(void* context);
+
+typedef struct FrameViewport
+{
+    double      center_x;
+    double      center_y;
+    double      width;
+    double      height;
+    double      julia_re;
+    double      julia_im;
+    int         max_iterations;
+    FormulaType formula;
+} FrameViewport;
+
+typedef struct ProgressiveFrame
+{
+    int       number_of_tiles;
+    int*      order;             // номера плиток от центра к краям
+    int       next_tile;
+    int       next_strip;        // первая непосчитанная строка плитки next_tile
+
+    FrameViewport viewport;      // вид, который сейчас считается
+    bool          started;
+
+    uint32_t* previous;          // прошлое изображение для заполнения
+    int       pitch;
+    int       pixels_width;
+    int       pixels_height;
+
+    int       slices;            // сколько раз кадр прерывался
+    double    frame_ms;
+} ProgressiveFrame;
+
+typedef struct ProgressiveStatistics
+{
+    int    strips_rendered;
+    int    tiles_left;
+    bool   restarted;
+    bool   cancelled;
+    bool   completed;
+    int    slices;
+    double frame_ms;            // полное время кадра, если он досчитан
+} ProgressiveStatistics;
+
+int  createProgressiveFrame(ProgressiveFrame* frame, int pitch, const MandelbrotData* data);
+void destroyProgressiveFrame(ProgressiveFrame* frame);
+
+bool progressiveFrameDone(const ProgressiveFrame* frame, const MandelbrotData* data);
+
+// budget_ms <= 0 - без ограничения по времени, cancel может быть NULL
+void renderProgressiveFrame(ProgressiveFrame* frame,
+                            uint32_t* pixels,
+                            MandelbrotData* data,
+                            IterationRectFunction rect_func,
+                            double budget_ms,
+                            FrameCancelFunction cancel,
+                            void* cancel_context,
+                            ProgressiveStatistics* stats);
+
+void printProgressiveStatistics(FILE* file, const ProgressiveStatistics* stats);
+
+#endif // MANDELBROT_PROGRESSIVE_H
@@ -0,0 +1,72 @@
+#ifndef MANDELBROT_RESOLUTION_H
+#define MANDELBROT_RESOLUTION_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Пока идёт ввод, кадр считается в уменьшенном разрешении, которое
+// выбирается по цене последних кадров так, чтобы уложиться в целевое
+// время кадра; SDL растягивает его на всё окно. Через RESOLUTION_IDLE_MS
+// после последнего ввода считается один кадр в полном разрешении.
+//
+// Цена кадра делится на часть, пропорциональную числу пикселей (расчёт
+// итераций и раскраска), и постоянную (загрузка текстуры, вывод на экран).
+// Обе усредняются по RESOLUTION_HISTORY последним кадрам.
+
+const double RESOLUTION_TARGET_MS  = 33.3;
+const int    RESOLUTION_HISTORY    = 8;
+const int    RESOLUTION_IDLE_MS    = 250;
+const int    RESOLUTION_WIDTH_STEP = 32;    // ширина поля кратна шагу
+const int    RESOLUTION_MIN_WIDTH  = 128;
+
+typedef struct ResolutionController
+{
+    double   target_ms;
+    int      full_width;
+    int      full_height;
+
+    int      width;                           // разрешение следующего кадра
+    int      height;
+
+    double   ms_per_pixel[RESOLUTION_HISTORY];
+    double   overhead_ms[RESOLUTION_HISTORY];
+    int      samples;
+    int      next_sample;
+
+    bool     view_changed;                   // был ввод после прошлого кадра
+    bool     full_frame_shown;
+    uint64_t last_input_ns;
+} ResolutionController;
+
+typedef struct ResolutionStatistics
+{
+    int    motion_frames;
+    int    frames_over_target;
+    int    min_width;
+    double motion_ms;
+    double worst_ms;
+    int    full_frames;
+    double full_ms;             // последний полный кадр после остановки
+} ResolutionStatistics;
+
+void initResolutionController(ResolutionController* controller,
+                              int full_width,
+                              int full_height,
+                              double target_ms);
+
+void noteResolutionInput(ResolutionController* controller, uint64_t now_ns);
+
+// false - считать нечего: вид не менялся и полный кадр уже на экране
+bool chooseFrameResolution(ResolutionController* controller, uint64_t now_ns);
+
+// render_ms - часть кадра, зависящая от числа пикселей, frame_ms - весь кадр
+void recordFrameCost(ResolutionController* controller,
+                     double render_ms,
+                     double frame_ms,
+                     ResolutionStatistics* stats);
+
+void printResolutionStatistics(FILE* file,
+                               const ResolutionController* controller,
+                               const ResolutionStatistics* stats);
+
+#endif // MANDELBROT_RESOLUTION_H
@@ -0,0 +1,19 @@
+#ifndef MANDELBROT_SOCKET_H
+#define MANDELBROT_SOCKET_H
+
+#include <stddef.h>
+
+// Адрес задаётся строкой "unix:/path/to/socket" или "tcp:host:port".
+
+const int SOCKET_LISTEN_BACKLOG = 64;
+
+// socket_path получает путь unix-сокета, чтобы потом удалить файл
+// (пустая строка для tcp), буфер не меньше 108 байт
+int createListener(const char* address, char* socket_path);
+int connectToAddress(const char* address);
+
+// 0 - передано всё, 1 - ошибка или соединение закрыто
+int readFull(int fd, void* buffer, size_t size);
+int writeFull(int fd, const void* buffer, size_t size);
+
+#endif // MANDELBROT_SOCKET_H
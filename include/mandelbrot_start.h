@@ -7,9 +7,12 @@
 const double ZOOM_FACTOR = 1.1;
 const double DEFAULT_ZOOM_FACTOR = 1.0;
 const double MOVE_SPEED  = 0.1;
+const double JULIA_STEP  = 0.005;
+
+const int IDLE_WAIT_MS = 16;
 
 int startMandelbrot(int argc, char* argv[],
                     SDL_Renderer* renderer, 
-                    SDL_Texture*  texture);
+                    SDL_Texture** texture);
 
 #endif // MANDELBROT_START_H
@@ -4,13 +4,32 @@
 #include <stdint.h>
 #include <stdalign.h>
 
+#include "mandelbrot_field.h"
+
+typedef enum FormulaType
+{
+    FORMULA_MANDELBROT = 0,
+    FORMULA_JULIA,
+    FORMULA_BURNING_SHIP,
+    FORMULA_MULTIBROT_3,
+    FORMULA_MULTIBROT_4,
+    FORMULA_MULTIBROT_5,
+    FORMULA_COUNT
+} FormulaType;
+
 typedef struct MandelbrotData
 {
     int   max_iterations;
-    int*  iterations_per_pixel;
+
+    IterationField field;
+    float* distance_per_pixel;
 
     alignas(32) uint32_t colors[512];
 
+    FormulaType formula;
+    double julia_re;
+    double julia_im;
+
     double zoom;
     double center_x;
     double center_y;
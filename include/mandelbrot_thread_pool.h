@@ -0,0 +1,26 @@
+#ifndef MANDELBROT_THREAD_POOL_H
+#define MANDELBROT_THREAD_POOL_H
+
+// Пул потоков, общий для всех многопоточных режимов. Потоки создаются один
+// раз и ждут задач. runParallel раздаёт задачи с номерами 0..count-1 и
+// возвращается, когда все выполнены. Вызывающий поток тоже берёт задачи и
+// считается одним из threads, поэтому пул на 1 поток не создаёт ни одного
+// потока, а runParallel можно вызывать и из задачи пула.
+
+typedef void (*ThreadTask)(void* context, int index);
+
+typedef struct ThreadPool ThreadPool;
+
+ThreadPool* createThreadPool(int threads);
+void        destroyThreadPool(ThreadPool* pool);
+
+int threadPoolSize(const ThreadPool* pool);
+int defaultThreadCount();
+
+void runParallel(ThreadPool* pool, int count, ThreadTask task, void* context);
+
+// задача выполнится в одном из потоков пула, submitTask её не ждёт;
+// в пуле на 1 поток выполняется сразу
+int  submitTask(ThreadPool* pool, ThreadTask task, void* context, int index);
+
+#endif // MANDELBROT_THREAD_POOL_H
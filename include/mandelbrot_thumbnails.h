@@ -0,0 +1,76 @@
+#ifndef MANDELBROT_THUMBNAILS_H
+#define MANDELBROT_THUMBNAILS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "mandelbrot_struct.h"
+#include "mandelbrot_engine.h"
+#include "mandelbrot_thread_pool.h"
+
+// Пакет миниатюр z^2 + c одного размера. Пиксели всех миниатюр идут одной
+// очередью: потоки пула берут из неё куски по THUMBNAIL_CHUNK_PIXELS, а
+// внутри куска каждая из THUMBNAIL_LANES дорожек берёт следующий
+// пиксель, как только досчитала свой. Так короткие и длинные орбиты
+// разных миниатюр делят одни и те же дорожки и ядра.
+//
+// Палитра строится и арена выделяется один раз на пакет; миниатюра i
+// лежит в арене с пикселя i * width * height, строки без зазоров.
+// Результат попиксельно совпадает с calculateMandelbrotIntrinsicsSeparated.
+
+const int THUMBNAIL_CHUNK_PIXELS = 4096;
+const int THUMBNAIL_LANES        = 8;    // две четвёрки AVX2
+
+typedef struct ThumbnailView
+{
+    double left;             // те же величины, что у ядер поля, чтобы
+    double dx;               // координаты пикселей совпадали до бита
+    double dy;
+    double half_height;
+    double center_y;
+    int    max_iterations;
+} ThumbnailView;
+
+typedef struct ThumbnailBatch
+{
+    int            width;
+    int            height;
+    int            count;
+    int            capacity;
+    ThumbnailView* views;
+    uint32_t*      pixels;            // арена на capacity миниатюр, выровнено на 32
+    size_t         bytes;
+
+    alignas(32) uint32_t colors[512];
+} ThumbnailBatch;
+
+typedef struct ThumbnailStatistics
+{
+    int      thumbnails;
+    int      chunks;
+    uint64_t pixels;
+    uint64_t iterations;
+    uint64_t lane_steps;              // шаги векторного цикла по всем дорожкам
+    double   ms;
+} ThumbnailStatistics;
+
+// palette - MAX_ITERATIONS цветов RGBA32 или NULL для стандартной
+int  createThumbnailBatch(ThumbnailBatch* batch,
+                          int width,
+                          int height,
+                          int capacity,
+                          const uint32_t* palette);
+void destroyThumbnailBatch(ThumbnailBatch* batch);
+
+// вид с размером пакета и формулой FORMULA_MANDELBROT, layout не важен
+int  addThumbnail(ThumbnailBatch* batch, const RenderViewport* viewport);
+void clearThumbnailBatch(ThumbnailBatch* batch);
+
+const uint32_t* thumbnailPixels(const ThumbnailBatch* batch, int index);
+
+// pool может быть NULL - всё считает вызывающий поток
+void renderThumbnailBatch(ThumbnailBatch* batch, ThreadPool* pool, ThumbnailStatistics* stats);
+
+void printThumbnailStatistics(FILE* file, const ThumbnailStatistics* stats);
+
+#endif // MANDELBROT_THUMBNAILS_H
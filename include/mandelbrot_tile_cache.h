@@ -0,0 +1,53 @@
+#ifndef MANDELBROT_TILE_CACHE_H
+#define MANDELBROT_TILE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Ограниченный кэш готовых плиток с вытеснением давно не использованных.
+// Вся память под плитки выделяется сразу одним куском, кэш не растёт.
+// Кэш не потокобезопасен, вызывающий сам держит блокировку.
+
+typedef struct TileKey
+{
+    int32_t formula;
+    int32_t max_iterations;
+    int32_t level;
+    int32_t tile_x;
+    int32_t tile_y;
+    int32_t reserved;
+    double  julia_re;
+    double  julia_im;
+} TileKey;
+
+typedef struct TileCache
+{
+    int      capacity;
+    size_t   entry_bytes;
+    uint8_t* arena;
+
+    TileKey* keys;
+    int*     newer;      // список от самой свежей плитки к самой старой
+    int*     older;
+    int*     chain;      // следующая плитка с тем же хешем
+    int*     buckets;
+    int      number_of_buckets;
+
+    int      newest;
+    int      oldest;
+    int      count;
+} TileCache;
+
+int   createTileCache(TileCache* cache, int capacity, size_t entry_bytes);
+void  destroyTileCache(TileCache* cache);
+
+// найденная плитка становится самой свежей
+const void* findCachedTile(TileCache* cache, const TileKey* key);
+
+// возвращает место под плитку, при необходимости вытесняя самую старую
+void* insertCachedTile(TileCache* cache, const TileKey* key);
+
+bool     sameTileKey(const TileKey* a, const TileKey* b);
+uint64_t hashTileKey(const TileKey* key);
+
+#endif // MANDELBROT_TILE_CACHE_H
@@ -1,6 +1,9 @@
 #ifndef MANDELBROT_UTILS_H
 #define MANDELBROT_UTILS_H
 
+#include <stdio.h>
+#include <stdint.h>
+
 #include "screen_constants.h"
 #include "mandelbrot_struct.h"
 
@@ -13,7 +16,26 @@ const double DEFAULT_ZOOM = 1.0;
 const double DEFAULT_CENTER_X = -0.75;
 const double DEFAULT_CENTER_Y = 0.0;
 
+const double DEFAULT_JULIA_RE = -0.8;
+const double DEFAULT_JULIA_IM = 0.156;
+
 int setDefaultMandelbrot(MandelbrotData* data);
+int enableDistanceEstimation(MandelbrotData* data);
+int setMandelbrotField(MandelbrotData* data, 
+                       int width, 
+                       int height,
+                       FieldFormat format, 
+                       FieldLayout layout);
+void freeMandelbrot(MandelbrotData* data);
 void updateDimension(MandelbrotData* data);
+void setMandelbrotFormula(MandelbrotData* data, FormulaType formula);
+void setMandelbrotPalette(MandelbrotData* data);
+
+// общее для отчётов tester: файл отчёта, печать в stdout и в файл сразу,
+// миллисекунды от отметки SDL_GetPerformanceCounter()
+FILE*  openReportFile(const char* file_path);
+void   printReport(FILE* file, const char* format, ...) __attribute__((format(printf, 2, 3)));
+double ticksToMs(uint64_t ticks);
+double elapsedMs(uint64_t start);
 
 #endif // MANDELBROT_UTILS_H
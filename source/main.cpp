@@ -26,7 +26,7 @@ int main(int argc, char* argv[])
             "Mandelbrot Set", 
             SCREEN_WIDTH, 
             SCREEN_HEIGHT, 
-            SDL_WINDOW_OPENGL
+            SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
     );
 
     if (!window) 
@@ -61,7 +61,7 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    int return_code = startMandelbrot(argc, argv, renderer, texture);
+    int return_code = startMandelbrot(argc, argv, renderer, &texture);
     if (return_code)
     {
         fprintf(stderr, "Error while calculating mandelbrot set\n");
@@ -0,0 +1,742 @@
+#include "mandelbrot_ab_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+
+#include "mandelbrot_utils.h"
+#include "mandelbrot_adaptive.h"
+#include "mandelbrot_logic_basic.h"
+#include "mandelbrot_logic_array.h"
+#include "mandelbrot_logic_intrinsics.h"
+#include "mandelbrot_logic_formula.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+const int AB_MAX_SCENES        = 8;
+const int AB_MAX_BASELINE      = 64;
+const int AB_NAME_LENGTH       = 256;
+
+typedef struct AbKernel
+{
+    const char*            name;
+    IterationFieldFunction func;
+} AbKernel;
+
+typedef struct AbScene
+{
+    const char* name;
+    double      center_x;
+    double      center_y;
+    double      zoom;
+    int         max_iterations;
+} AbScene;
+
+static const AbKernel AB_KERNELS[] = {
+    {"basic",         calculateIterationField},
+    {"array",         calculateIterationFieldArray},
+    {"simd",          calculateIterationsFieldIntrinsics},
+    {"formula-basic", calculateFormulaIterationField},
+    {"formula-array", calculateFormulaIterationFieldArray},
+    {"formula-simd",  calculateFormulaIterationFieldIntrinsics},
+};
+
+static const AbScene AB_SCENES[] = {
+    {"default",  DEFAULT_CENTER_X,     DEFAULT_CENTER_Y,     1.0, MAX_ITERATIONS},
+    {"seahorse", -0.743643887037151,   0.131825904205330,    1e3, 1024},
+    {"elephant", 0.28693186889504513,  0.014286693904085048, 1e2, MAX_ITERATIONS},
+};
+
+// сторона сравнения: ядро этой сборки или ядро другой сборки tester
+typedef struct AbSide
+{
+    const char*            spec;         // как задано в командной строке
+    char                   kernel[AB_NAME_LENGTH];
+    const char*            build;        // NULL - эта сборка
+    IterationFieldFunction func;
+} AbSide;
+
+typedef struct AbBaselineEntry
+{
+    char   kernel[AB_NAME_LENGTH];
+    char   scene[AB_NAME_LENGTH];
+    double mean;
+} AbBaselineEntry;
+
+static int    parseSide(AbSide* side, const char* spec);
+static int    findScene(const char* name);
+static int    pinToCpu(int cpu);
+static double nowMs();
+static double calibrationMs();
+static void   prepareScene(MandelbrotData* data, int scene);
+static double measureLocal(IterationFieldFunction func, MandelbrotData* data, double* ms);
+static int    measureSide(const AbSide* side, int scene, MandelbrotData* data, int cpu,
+                          double* normalized, double* ms);
+static int    runMeasureMode(int argc, char* argv[]);
+static int    loadBaseline(const char* path, AbBaselineEntry* entries, int* count);
+static const AbBaselineEntry* findBaseline(const AbBaselineEntry* entries, int count,
+                                           const char* kernel, const char* scene);
+static double incompleteBeta(double a, double b, double x);
+static double betaContinuedFraction(double a, double b, double x);
+static int    compareDoubles(const void* a, const void* b);
+
+
+// public ----------------------------------------------------------------------
+
+
+void summarizeSamples(const double* samples, int count, SampleSummary* summary)
+{
+    assert(samples != NULL);
+    assert(summary != NULL);
+    assert(count > 0);
+
+    memset(summary, 0, sizeof(*summary));
+    summary->count = count;
+
+    for (int i = 0; i < count; i++)
+    {
+        summary->mean += samples[i];
+    }
+    summary->mean /= count;
+
+    if (count < 2)
+    {
+        summary->ci_low  = summary->mean;
+        summary->ci_high = summary->mean;
+        return;
+    }
+
+    double squares = 0;
+    for (int i = 0; i < count; i++)
+    {
+        squares += (samples[i] - summary->mean) * (samples[i] - summary->mean);
+    }
+    summary->stddev = sqrt(squares / (count - 1));
+
+    const double half_width = studentCriticalValue(AB_CONFIDENCE, count - 1) * summary->stddev / sqrt(count);
+    summary->ci_low  = summary->mean - half_width;
+    summary->ci_high = summary->mean + half_width;
+}
+
+
+double studentTwoSidedP(double t, int dof)
+{
+    assert(dof > 0);
+
+    return incompleteBeta(dof / 2.0, 0.5, dof / (dof + t * t));
+}
+
+
+// делением отрезка: p монотонно убывает по |t|
+double studentCriticalValue(double confidence, int dof)
+{
+    assert(confidence > 0 && confidence < 1);
+    assert(dof > 0);
+
+    double low  = 0;
+    double high = 1000;
+    for (int i = 0; i < 100; i++)
+    {
+        const double middle = (low + high) / 2;
+        if (studentTwoSidedP(middle, dof) > 1 - confidence)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return (low + high) / 2;
+}
+
+
+int runAbTest(int argc, char* argv[])
+{
+    assert(argv != NULL);
+
+    if (argc > 1 && !strcmp(argv[1], "--measure"))
+    {
+        return runMeasureMode(argc, argv);
+    }
+
+    AbSide sides[2] = {};
+    int    number_of_sides = 0;
+    int    rounds = AB_DEFAULT_ROUNDS;
+    int    scenes[AB_MAX_SCENES] = {};
+    int    number_of_scenes = 0;
+    int    cpu = sched_getcpu();
+    double threshold = AB_DEFAULT_THRESHOLD;
+    const char* baseline_path = NULL;
+    const char* save_path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--ab") && i + 2 < argc)
+        {
+            if (parseSide(&sides[0], argv[i + 1]) || parseSide(&sides[1], argv[i + 2]))
+            {
+                return 1;
+            }
+            number_of_sides = 2;
+            i += 2;
+        }
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc)
+        {
+            rounds = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--scenes") && i + 1 < argc)
+        {
+            char* list = argv[++i];
+            for (char* name = strtok(list, ","); name && number_of_scenes < AB_MAX_SCENES; name = strtok(NULL, ","))
+            {
+                const int scene = findScene(name);
+                if (scene < 0)
+                {
+                    fprintf(stderr, "Unknown scene %s\n", name);
+                    return 1;
+                }
+                scenes[number_of_scenes++] = scene;
+            }
+        }
+        else if (!strcmp(argv[i], "--cpu") && i + 1 < argc)
+        {
+            cpu = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc)
+        {
+            threshold = atof(argv[++i]) / 100.0;
+        }
+        else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+        {
+            baseline_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--save-baseline") && i + 1 < argc)
+        {
+            save_path = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (number_of_sides != 2 || rounds < 2)
+    {
+        fprintf(stderr, "Usage: tester --ab A B [--rounds N >= 2] [--scenes s1,s2] [--cpu N] "
+                        "[--threshold PCT] [--baseline FILE] [--save-baseline FILE]\n");
+        return 1;
+    }
+    if (number_of_scenes == 0)
+    {
+        number_of_scenes = sizeof(AB_SCENES) / sizeof(AB_SCENES[0]);
+        for (int i = 0; i < number_of_scenes; i++)
+        {
+            scenes[i] = i;
+        }
+    }
+    if (pinToCpu(cpu))
+    {
+        return 1;
+    }
+
+    AbBaselineEntry baseline[AB_MAX_BASELINE] = {};
+    int baseline_count = 0;
+    if (baseline_path && loadBaseline(baseline_path, baseline, &baseline_count))
+    {
+        return 1;
+    }
+
+    FILE* save_file = NULL;
+    if (save_path)
+    {
+        save_file = fopen(save_path, "w");
+        if (!save_file)
+        {
+            fprintf(stderr, "Error while opening file %s\n", save_path);
+            return 1;
+        }
+        fprintf(save_file, "# kernel scene normalized_time ci_low ci_high rounds\n");
+    }
+
+    double* values = (double*)calloc((size_t)rounds * 5, sizeof(double));
+    if (!values)
+    {
+        fprintf(stderr, "Error while allocating memory for testing\n");
+        if (save_file)
+        {
+            fclose(save_file);
+        }
+        return 1;
+    }
+    double* normalized[2] = {values, values + rounds};
+    double* times[2]      = {values + 2 * rounds, values + 3 * rounds};
+    double* log_ratios    = values + 4 * rounds;
+
+    MandelbrotData mandelbrot_data = {};
+    if (setDefaultMandelbrot(&mandelbrot_data))
+    {
+        free(values);
+        if (save_file)
+        {
+            fclose(save_file);
+        }
+        return 1;
+    }
+
+    int regressions = 0;
+    int return_code = 0;
+    printf("A = %s, B = %s, %d rounds of A B B A, pinned to cpu %d\n",
+           sides[0].spec, sides[1].spec, rounds, cpu);
+
+    for (int s = 0; s < number_of_scenes && !return_code; s++)
+    {
+        const int scene = scenes[s];
+        prepareScene(&mandelbrot_data, scene);
+
+        // прогрев кэшей и частоты, результат не учитывается
+        double unused_normalized = 0;
+        double unused_ms = 0;
+        for (int side = 0; side < 2 && !return_code; side++)
+        {
+            return_code = measureSide(&sides[side], scene, &mandelbrot_data, cpu, &unused_normalized, &unused_ms);
+        }
+
+        for (int round = 0; round < rounds && !return_code; round++)
+        {
+            static const int order[] = {0, 1, 1, 0};
+            double sum_normalized[2] = {};
+            double sum_ms[2] = {};
+
+            for (int k = 0; k < 4 && !return_code; k++)
+            {
+                double value = 0;
+                double ms = 0;
+                return_code = measureSide(&sides[order[k]], scene, &mandelbrot_data, cpu, &value, &ms);
+                sum_normalized[order[k]] += value / 2;
+                sum_ms[order[k]]         += ms / 2;
+            }
+
+            for (int side = 0; side < 2; side++)
+            {
+                normalized[side][round] = sum_normalized[side];
+                times[side][round]      = sum_ms[side];
+            }
+            log_ratios[round] = log(sum_normalized[0] / sum_normalized[1]);
+        }
+        if (return_code)
+        {
+            break;
+        }
+
+        printf("scene %s:\n", AB_SCENES[scene].name);
+
+        SampleSummary summaries[2] = {};
+        for (int side = 0; side < 2; side++)
+        {
+            SampleSummary ms_summary = {};
+            summarizeSamples(normalized[side], rounds, &summaries[side]);
+            summarizeSamples(times[side], rounds, &ms_summary);
+
+            printf("  %s %-24s %9.3f ms +- %.3f, %.3f calibration loops [%.3f, %.3f]\n",
+                   side == 0 ? "A" : "B", sides[side].spec, ms_summary.mean, ms_summary.stddev,
+                   summaries[side].mean, summaries[side].ci_low, summaries[side].ci_high);
+
+            if (save_file)
+            {
+                fprintf(save_file, "%s %s %.9f %.9f %.9f %d\n", sides[side].spec, AB_SCENES[scene].name,
+                        summaries[side].mean, summaries[side].ci_low, summaries[side].ci_high, rounds);
+            }
+
+            const AbBaselineEntry* entry = findBaseline(baseline, baseline_count,
+                                                        sides[side].spec, AB_SCENES[scene].name);
+            if (entry)
+            {
+                // регрессия только если медленнее порога даже по нижней границе
+                const bool regression = summaries[side].ci_low / entry->mean > 1 + threshold;
+                printf("    vs baseline: %.3fx time [%.3f, %.3f]%s\n",
+                       summaries[side].mean / entry->mean,
+                       summaries[side].ci_low / entry->mean, summaries[side].ci_high / entry->mean,
+                       regression ? ", REGRESSION" : "");
+                regressions += regression;
+            }
+        }
+
+        SampleSummary ratio = {};
+        summarizeSamples(log_ratios, rounds, &ratio);
+        const double t = (ratio.stddev > 0) ? ratio.mean / (ratio.stddev / sqrt(rounds)) : INFINITY;
+        const double p = isinf(t) ? 0 : studentTwoSidedP(t, rounds - 1);
+
+        printf("  speedup of B over A: %.4fx, %.0f%% CI [%.4f, %.4f], t = %.2f, p = %.2g: %s\n",
+               exp(ratio.mean), AB_CONFIDENCE * 100, exp(ratio.ci_low), exp(ratio.ci_high), t, p,
+               p < AB_SIGNIFICANCE ? "significant" : "not significant");
+    }
+
+    if (!return_code && baseline_path)
+    {
+        printf("%d regressions above %.1f%% against %s\n", regressions, threshold * 100, baseline_path);
+        return_code = (regressions > 0);
+    }
+
+    if (save_file)
+    {
+        fclose(save_file);
+    }
+    free(values);
+    freeMandelbrot(&mandelbrot_data);
+
+    return return_code;
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static int parseSide(AbSide* side, const char* spec)
+{
+    assert(side != NULL);
+    assert(spec != NULL);
+
+    memset(side, 0, sizeof(*side));
+    side->spec = spec;
+
+    const char* at = strchr(spec, '@');
+    const size_t length = at ? (size_t)(at - spec) : strlen(spec);
+    if (length >= (size_t)AB_NAME_LENGTH)
+    {
+        fprintf(stderr, "Kernel name is too long: %s\n", spec);
+        return 1;
+    }
+    memcpy(side->kernel, spec, length);
+    side->kernel[length] = '\0';
+
+    if (at)
+    {
+        side->build = at + 1;
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(AB_KERNELS) / sizeof(AB_KERNELS[0]); i++)
+    {
+        if (!strcmp(AB_KERNELS[i].name, side->kernel))
+        {
+            side->func = AB_KERNELS[i].func;
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "Unknown kernel %s\n", side->kernel);
+    return 1;
+}
+
+
+static int findScene(const char* name)
+{
+    assert(name != NULL);
+
+    for (size_t i = 0; i < sizeof(AB_SCENES) / sizeof(AB_SCENES[0]); i++)
+    {
+        if (!strcmp(AB_SCENES[i].name, name))
+        {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+
+static int pinToCpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (sched_setaffinity(0, sizeof(set), &set))
+    {
+        fprintf(stderr, "Could not pin to cpu %d\n", cpu);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static double nowMs()
+{
+    struct timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+
+// цепочка зависимых умножений: её время меняется вместе с частотой ядра
+static double calibrationMs()
+{
+    uint64_t x = 1;
+
+    const double start = nowMs();
+    for (int i = 0; i < AB_CALIBRATION_STEPS; i++)
+    {
+        x = x * 6364136223846793005ull + 1;
+        __asm__ volatile("" : "+r"(x));
+    }
+
+    return nowMs() - start;
+}
+
+
+static void prepareScene(MandelbrotData* data, int scene)
+{
+    assert(data != NULL);
+
+    const AbScene* parameters = &AB_SCENES[scene];
+
+    setMandelbrotFormula(data, FORMULA_MANDELBROT);
+    data->center_x       = parameters->center_x;
+    data->center_y       = parameters->center_y;
+    data->zoom           = parameters->zoom;
+    data->max_iterations = parameters->max_iterations;
+    updateDimension(data);
+}
+
+
+// медиана из AB_RUNS_PER_MEASUREMENT запусков в калибровочных циклах;
+// калибровка стоит до, между и после запусков, и берётся её медиана:
+// по одному замеру шум калибровки больше шума самого ядра
+static double measureLocal(IterationFieldFunction func, MandelbrotData* data, double* ms)
+{
+    assert(func != NULL);
+    assert(data != NULL);
+    assert(ms   != NULL);
+
+    double runs[AB_RUNS_PER_MEASUREMENT] = {};
+    double calibrations[AB_RUNS_PER_MEASUREMENT + 1] = {};
+
+    for (int i = 0; i < AB_RUNS_PER_MEASUREMENT; i++)
+    {
+        calibrations[i] = calibrationMs();
+
+        const double start = nowMs();
+        func(data);
+        runs[i] = nowMs() - start;
+    }
+    calibrations[AB_RUNS_PER_MEASUREMENT] = calibrationMs();
+
+    qsort(runs, AB_RUNS_PER_MEASUREMENT, sizeof(double), compareDoubles);
+    qsort(calibrations, AB_RUNS_PER_MEASUREMENT + 1, sizeof(double), compareDoubles);
+    *ms = runs[AB_RUNS_PER_MEASUREMENT / 2];
+
+    const double calibration = (calibrations[AB_RUNS_PER_MEASUREMENT / 2]
+                              + calibrations[(AB_RUNS_PER_MEASUREMENT + 1) / 2]) / 2;
+
+    return *ms / calibration;
+}
+
+
+static int measureSide(const AbSide* side, int scene, MandelbrotData* data, int cpu,
+                       double* normalized, double* ms)
+{
+    assert(side       != NULL);
+    assert(data       != NULL);
+    assert(normalized != NULL);
+    assert(ms         != NULL);
+
+    if (!side->build)
+    {
+        *normalized = measureLocal(side->func, data, ms);
+        return 0;
+    }
+
+    char command[3 * AB_NAME_LENGTH] = {};
+    snprintf(command, sizeof(command), "'%s' --measure '%s' '%s' --cpu %d",
+             side->build, side->kernel, AB_SCENES[scene].name, cpu);
+
+    FILE* child = popen(command, "r");
+    if (!child)
+    {
+        fprintf(stderr, "Could not run %s\n", command);
+        return 1;
+    }
+
+    const bool parsed = (fscanf(child, "%lf %lf", normalized, ms) == 2);
+    if (pclose(child) != 0 || !parsed)
+    {
+        fprintf(stderr, "Measurement failed: %s\n", command);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// одно измерение для сравнения сборок: "нормированное_время мс"
+static int runMeasureMode(int argc, char* argv[])
+{
+    assert(argv != NULL);
+
+    if (argc < 4)
+    {
+        fprintf(stderr, "Usage: tester --measure KERNEL SCENE [--cpu N]\n");
+        return 1;
+    }
+
+    AbSide side = {};
+    const int scene = findScene(argv[3]);
+    if (parseSide(&side, argv[2]) || side.build || scene < 0)
+    {
+        fprintf(stderr, "Unknown kernel or scene: %s %s\n", argv[2], argv[3]);
+        return 1;
+    }
+    if (argc > 5 && !strcmp(argv[4], "--cpu") && pinToCpu(atoi(argv[5])))
+    {
+        return 1;
+    }
+
+    MandelbrotData mandelbrot_data = {};
+    if (setDefaultMandelbrot(&mandelbrot_data))
+    {
+        return 1;
+    }
+    prepareScene(&mandelbrot_data, scene);
+
+    // свежий процесс: первый запуск только прогревает
+    side.func(&mandelbrot_data);
+
+    double ms = 0;
+    const double normalized = measureLocal(side.func, &mandelbrot_data, &ms);
+    printf("%.9f %.6f\n", normalized, ms);
+
+    freeMandelbrot(&mandelbrot_data);
+
+    return 0;
+}
+
+
+static int loadBaseline(const char* path, AbBaselineEntry* entries, int* count)
+{
+    assert(path    != NULL);
+    assert(entries != NULL);
+    assert(count   != NULL);
+
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Error while opening file %s\n", path);
+        return 1;
+    }
+
+    char line[1024] = {};
+    *count = 0;
+    while (fgets(line, sizeof(line), file) && *count < AB_MAX_BASELINE)
+    {
+        if (line[0] == '#')
+        {
+            continue;
+        }
+
+        AbBaselineEntry* entry = &entries[*count];
+        if (sscanf(line, "%255s %255s %lf", entry->kernel, entry->scene, &entry->mean) == 3 && entry->mean > 0)
+        {
+            (*count)++;
+        }
+    }
+    fclose(file);
+
+    return 0;
+}
+
+
+static const AbBaselineEntry* findBaseline(const AbBaselineEntry* entries, int count,
+                                           const char* kernel, const char* scene)
+{
+    assert(entries != NULL);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!strcmp(entries[i].kernel, kernel) && !strcmp(entries[i].scene, scene))
+        {
+            return &entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+// регуляризованная неполная бета-функция I_x(a, b)
+static double incompleteBeta(double a, double b, double x)
+{
+    if (x <= 0)
+    {
+        return 0;
+    }
+    if (x >= 1)
+    {
+        return 1;
+    }
+
+    const double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1 - x));
+
+    if (x < (a + 1) / (a + b + 2))
+    {
+        return front * betaContinuedFraction(a, b, x) / a;
+    }
+
+    return 1 - front * betaContinuedFraction(b, a, 1 - x) / b;
+}
+
+
+// цепная дробь для неполной бета-функции, метод Лентца
+static double betaContinuedFraction(double a, double b, double x)
+{
+    const double tiny = 1e-300;
+
+    double c = 1;
+    double d = 1 - (a + b) * x / (a + 1);
+    d = 1 / (fabs(d) < tiny ? tiny : d);
+    double result = d;
+
+    for (int m = 1; m <= 300; m++)
+    {
+        const double even = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+        d = 1 + even * d;
+        c = 1 + even / c;
+        d = 1 / (fabs(d) < tiny ? tiny : d);
+        c = (fabs(c) < tiny) ? tiny : c;
+        result *= d * c;
+
+        const double odd = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+        d = 1 + odd * d;
+        c = 1 + odd / c;
+        d = 1 / (fabs(d) < tiny ? tiny : d);
+        c = (fabs(c) < tiny) ? tiny : c;
+        const double delta = d * c;
+        result *= delta;
+
+        if (fabs(delta - 1) < 1e-12)
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+
+static int compareDoubles(const void* a, const void* b)
+{
+    const double lhs = *(const double*)a;
+    const double rhs = *(const double*)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
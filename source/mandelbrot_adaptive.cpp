@@ -0,0 +1,220 @@
+#include "mandelbrot_adaptive.h"
+
+#include <SDL3/SDL.h>
+
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#include "mandelbrot_utils.h"
+#include "mandelbrot_formula.h"
+#include "mandelbrot_logic_formula.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+static int compareInts(const void* a, const void* b);
+
+
+// public ----------------------------------------------------------------------
+
+
+int chooseMaxIterations(MandelbrotData* data, IterationStatistics* stats)
+{
+    assert(data  != NULL);
+    assert(stats != NULL);
+
+    // чем глубже зум, тем больше итераций нужно точкам у границы, поэтому
+    // потолок пробного прохода растёт с числом удвоений зума
+    const double octaves = log2(fmax(data->zoom, 1.0));
+    const int zoom_iterations = ADAPTIVE_BASE_ITERATIONS 
+                              + (int)(ADAPTIVE_ITERATIONS_PER_OCTAVE * octaves);
+
+    int probe_max_iterations = 4 * zoom_iterations;
+    if (probe_max_iterations > ADAPTIVE_MAX_ITERATIONS)
+    {
+        probe_max_iterations = ADAPTIVE_MAX_ITERATIONS;
+    }
+
+    int escape_counts[PREPASS_GRID * PREPASS_GRID];
+
+    const double dx = data->width / PREPASS_GRID;
+    const double dy = data->height / PREPASS_GRID;
+    const double offset_x = data->center_x - data->width / 2;
+    const double offset_y = data->center_y - data->height / 2;
+
+    const int saved_max_iterations = data->max_iterations;
+    data->max_iterations = probe_max_iterations;
+
+    int escaped = 0;
+    int near_cap = 0;
+    for (int y = 0; y < PREPASS_GRID; y++)
+    {
+        const double py = (PREPASS_GRID - y - 0.5) * dy + offset_y;
+
+        for (int x = 0; x < PREPASS_GRID; x++)
+        {
+            const double px = (x + 0.5) * dx + offset_x;
+            int iterations = calculateFormulaIterationsAtPoint(px, py, data);
+
+            if (iterations < probe_max_iterations)
+            {
+                escape_counts[escaped++] = iterations;
+                near_cap += (iterations >= probe_max_iterations * 3 / 4);
+            }
+        }
+    }
+
+    data->max_iterations = saved_max_iterations;
+
+    stats->probes = PREPASS_GRID * PREPASS_GRID;
+    stats->escaped = escaped;
+    stats->probe_max_iterations = probe_max_iterations;
+    stats->escaped_fraction = (double)escaped / stats->probes;
+    stats->near_cap_fraction = escaped ? (double)near_cap / escaped : 0.0;
+    stats->escape_percentile = 0;
+
+    // ни одна проба не вышла - на экране только внутренность множества,
+    // тратить на неё итерации бессмысленно
+    if (!escaped)
+    {
+        return ADAPTIVE_MIN_ITERATIONS;
+    }
+
+    qsort(escape_counts, escaped, sizeof(int), compareInts);
+    stats->escape_percentile = escape_counts[(escaped - 1) * 99 / 100];
+
+    // полуторный запас на пиксели между пробами
+    int max_iterations = stats->escape_percentile + stats->escape_percentile / 2;
+
+    // заметная доля проб вышла у самого потолка - значит часть границы
+    // его не достигла, и снижать потолок нельзя
+    if (stats->near_cap_fraction > NEAR_CAP_THRESHOLD && max_iterations < probe_max_iterations)
+    {
+        max_iterations = probe_max_iterations;
+    }
+
+    if (max_iterations < ADAPTIVE_MIN_ITERATIONS)
+    {
+        max_iterations = ADAPTIVE_MIN_ITERATIONS;
+    }
+    if (max_iterations > ADAPTIVE_MAX_ITERATIONS)
+    {
+        max_iterations = ADAPTIVE_MAX_ITERATIONS;
+    }
+
+    return max_iterations;
+}
+
+
+void calculateAdaptiveIterationField(MandelbrotData* data,
+                                     IterationFieldFunction kernel,
+                                     AdaptiveFrameStatistics* stats)
+{
+    assert(data   != NULL);
+    assert(kernel != NULL);
+    assert(stats  != NULL);
+
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    data->max_iterations = chooseMaxIterations(data, &stats->prepass);
+    stats->max_iterations = data->max_iterations;
+
+    uint64_t prepass_end = SDL_GetPerformanceCounter();
+
+    kernel(data);
+
+    stats->prepass_ms = ticksToMs(prepass_end - start);
+    stats->frame_ms   = elapsedMs(start);
+}
+
+
+void collectFieldStatistics(MandelbrotData* data,
+                            bool kernel_skips_interior,
+                            AdaptiveFrameStatistics* stats)
+{
+    assert(data  != NULL);
+    assert(stats != NULL);
+
+    const IterationField* field = &data->field;
+    const int max_iterations = data->max_iterations;
+
+    const double dx = data->width / field->width;
+    const double dy = data->height / field->height;
+    const double offset_x = data->center_x - data->width / 2;
+    const double offset_y = data->center_y - data->height / 2;
+
+    const bool has_interior_test = kernel_skips_interior 
+                                && data->formula == FORMULA_MANDELBROT;
+
+    uint64_t total_iterations = 0;
+    uint64_t interior_pixels = 0;
+    uint64_t wasted_interior_iterations = 0;
+
+    for (int y = 0; y < field->height; y++)
+    {
+        const double py = (field->height - y) * dy + offset_y;
+
+        for (int x = 0; x < field->width; x++)
+        {
+            const int iterations = fieldLoad(field, x, y);
+            if (iterations < max_iterations)
+            {
+                total_iterations += iterations;
+                continue;
+            }
+
+            interior_pixels++;
+
+            // точки, отсеянные проверкой кардиоиды, не итерировались вовсе;
+            // векторные ядра отсеивают их группами, так что на границе
+            // кардиоиды это оценка снизу
+            const double px = x * dx + offset_x;
+            if (has_interior_test && MandelbrotFormula::isInterior(px, py))
+            {
+                continue;
+            }
+
+            total_iterations += iterations;
+            wasted_interior_iterations += iterations;
+        }
+    }
+
+    stats->max_iterations = max_iterations;
+    stats->total_iterations = total_iterations;
+    stats->interior_pixels = interior_pixels;
+    stats->wasted_interior_iterations = wasted_interior_iterations;
+}
+
+
+void printAdaptiveFrameStatistics(FILE* file, const AdaptiveFrameStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    fprintf(file, 
+            "frame %.2f ms (prepass %.2f ms), max_iterations %d, "
+            "escaped %.1f%%, iterations %lu, interior pixels %lu, "
+            "wasted interior iterations %lu\n",
+            stats->frame_ms,
+            stats->prepass_ms,
+            stats->max_iterations,
+            stats->prepass.escaped_fraction * 100.0,
+            stats->total_iterations,
+            stats->interior_pixels,
+            stats->wasted_interior_iterations);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static int compareInts(const void* a, const void* b)
+{
+    int lhs = *(const int*)a;
+    int rhs = *(const int*)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
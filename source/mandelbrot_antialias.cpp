@@ -0,0 +1,199 @@
+#include "mandelbrot_antialias.h"
+
+#include <SDL3/SDL.h>
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "mandelbrot_utils.h"
+#include "mandelbrot_logic_formula.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+const int SAMPLES_PER_PIXEL = ANTIALIAS_GRID * ANTIALIAS_GRID;
+const int BATCH_PIXELS      = 64;
+
+static bool isBoundaryPixel(MandelbrotData* data, int x, int y, float distance_threshold);
+static inline bool iterationsDiffer(int a, int b);
+static void supersampleBatch(int pitch,
+                             uint32_t* pixels, 
+                             MandelbrotData* data,
+                             const int* batch, 
+                             int batch_size);
+
+
+// public ----------------------------------------------------------------------
+
+
+void antialiasIterationField(int pitch, 
+                             uint32_t* pixels, 
+                             MandelbrotData* data,
+                             AntialiasMode mode,
+                             AntialiasStatistics* stats)
+{
+    assert(pixels != NULL);
+    assert(data   != NULL);
+    assert(stats  != NULL);
+
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    const IterationField* field = &data->field;
+    const float distance_threshold = (float)(ANTIALIAS_DISTANCE_THRESHOLD * data->width / field->width);
+
+    int batch[BATCH_PIXELS] = {};
+    int batch_size = 0;
+    uint64_t supersampled_pixels = 0;
+
+    for (int y = 0; y < field->height; y++)
+    {
+        for (int x = 0; x < field->width; x++)
+        {
+            if (mode == ANTIALIAS_BOUNDARY && !isBoundaryPixel(data, x, y, distance_threshold))
+            {
+                continue;
+            }
+
+            batch[batch_size++] = y * field->width + x;
+            supersampled_pixels++;
+
+            if (batch_size == BATCH_PIXELS)
+            {
+                supersampleBatch(pitch, pixels, data, batch, batch_size);
+                batch_size = 0;
+            }
+        }
+    }
+
+    if (batch_size)
+    {
+        supersampleBatch(pitch, pixels, data, batch, batch_size);
+    }
+
+    stats->supersampled_pixels = supersampled_pixels;
+    stats->samples = supersampled_pixels * SAMPLES_PER_PIXEL;
+    stats->supersampled_fraction = (double)supersampled_pixels / ((double)field->width * field->height);
+    stats->ms = elapsedMs(start);
+}
+
+
+void printAntialiasStatistics(FILE* file, const AntialiasStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    fprintf(file, 
+            "antialiasing %.2f ms, supersampled pixels %lu (%.2f%%), samples %lu\n",
+            stats->ms,
+            stats->supersampled_pixels,
+            stats->supersampled_fraction * 100.0,
+            stats->samples);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static inline bool iterationsDiffer(int a, int b)
+{
+    return abs(a - b) > ANTIALIAS_ITERATION_THRESHOLD;
+}
+
+
+static bool isBoundaryPixel(MandelbrotData* data, int x, int y, float distance_threshold)
+{
+    assert(data != NULL);
+
+    const IterationField* field = &data->field;
+    const size_t index = (size_t)y * field->width + x;
+
+    if (data->distance_per_pixel && data->distance_per_pixel[index] < distance_threshold)
+    {
+        return true;
+    }
+
+    const int iterations = fieldLoad(field, x, y);
+
+    return (x > 0                 && iterationsDiffer(iterations, fieldLoad(field, x - 1, y)))
+        || (x < field->width - 1  && iterationsDiffer(iterations, fieldLoad(field, x + 1, y)))
+        || (y > 0                 && iterationsDiffer(iterations, fieldLoad(field, x, y - 1)))
+        || (y < field->height - 1 && iterationsDiffer(iterations, fieldLoad(field, x, y + 1)));
+}
+
+
+static void supersampleBatch(int pitch,
+                             uint32_t* pixels, 
+                             MandelbrotData* data,
+                             const int* batch, 
+                             int batch_size)
+{
+    assert(pixels != NULL);
+    assert(data   != NULL);
+    assert(batch  != NULL);
+
+    alignas(32) double sample_x[BATCH_PIXELS * SAMPLES_PER_PIXEL] = {};
+    alignas(32) double sample_y[BATCH_PIXELS * SAMPLES_PER_PIXEL] = {};
+    alignas(32) int    sample_iterations[BATCH_PIXELS * SAMPLES_PER_PIXEL] = {};
+
+    const int field_width  = data->field.width;
+    const int field_height = data->field.height;
+
+    const double dx = data->width / field_width;
+    const double dy = data->height / field_height;
+    const double offset_x = data->center_x - data->width / 2;
+    const double offset_y = data->center_y - data->height / 2;
+
+    // подвыборки расположены вокруг точки, которую посчитало основное ядро
+    for (int i = 0; i < batch_size; i++)
+    {
+        const int x = batch[i] % field_width;
+        const int y = batch[i] / field_width;
+
+        for (int sy = 0; sy < ANTIALIAS_GRID; sy++)
+        {
+            for (int sx = 0; sx < ANTIALIAS_GRID; sx++)
+            {
+                const double shift_x = (sx + 0.5) / ANTIALIAS_GRID - 0.5;
+                const double shift_y = (sy + 0.5) / ANTIALIAS_GRID - 0.5;
+                const int sample = i * SAMPLES_PER_PIXEL + sy * ANTIALIAS_GRID + sx;
+
+                sample_x[sample] = (x + shift_x) * dx + offset_x;
+                sample_y[sample] = (field_height - y - shift_y) * dy + offset_y;
+            }
+        }
+    }
+
+    calculateFormulaIterationsAtPoints(sample_x, sample_y, 
+                                       batch_size * SAMPLES_PER_PIXEL, 
+                                       sample_iterations, data);
+
+    const int pitch_u32 = pitch / sizeof(uint32_t);
+
+    for (int i = 0; i < batch_size; i++)
+    {
+        uint32_t channels[4] = {};
+
+        for (int s = 0; s < SAMPLES_PER_PIXEL; s++)
+        {
+            int iterations = sample_iterations[i * SAMPLES_PER_PIXEL + s];
+            int index = (iterations >= data->max_iterations) ? 0 : iterations % MAX_ITERATIONS;
+            uint32_t color = data->colors[index];
+
+            for (int c = 0; c < 4; c++)
+            {
+                channels[c] += (color >> (8 * c)) & 0xFF;
+            }
+        }
+
+        uint32_t color = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            color |= (channels[c] / SAMPLES_PER_PIXEL) << (8 * c);
+        }
+
+        const int x = batch[i] % field_width;
+        const int y = batch[i] / field_width;
+        pixels[y * pitch_u32 + x] = color;
+    }
+}
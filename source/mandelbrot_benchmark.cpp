@@ -2,24 +2,49 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <x86intrin.h>
 #include <time.h>
 #include <sys/resource.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #include "mandelbrot_utils.h"
 #include "mandelbrot_logic_basic.h"
 #include "mandelbrot_logic_intrinsics.h"
 #include "mandelbrot_logic_array.h"
+#include "mandelbrot_logic_formula.h"
+#include "mandelbrot_adaptive.h"
+#include "mandelbrot_antialias.h"
+#include "mandelbrot_colorize.h"
+#include "mandelbrot_progressive.h"
+#include "mandelbrot_resolution.h"
+#include "mandelbrot_buddhabrot.h"
+#include "mandelbrot_thumbnails.h"
+#include "mandelbrot_memory.h"
+#include "mandelbrot_orbit_cache.h"
+#include "mandelbrot_thread_pool.h"
+#include "mandelbrot_engine.h"
+#include "mandelbrot_start.h"
+#include "mandelbrot_ab_test.h"
 
+#include <atomic>
 
-int main()
+
+int main(int argc, char* argv[])
 {
     int which = PRIO_PROCESS;
     id_t pid = getpid();
     int priority = -20;
     setpriority(which, pid, priority);
 
+    if (argc > 1)
+    {
+        return runAbTest(argc, argv);
+    }
+
     Benchmark tests[] = {
         (Benchmark){
             .mandelbrot_func = calculateIterationField,
@@ -27,7 +52,8 @@ int main()
             .file_path = "only_iterations_basic_version_O3.txt",
             .graphic_title = "Версия без оптимизаий -O3",
             .warmup_runs = 10000,
-            .measure_runs = 2000
+            .measure_runs = 2000,
+            .formula = FORMULA_MANDELBROT
         },
         (Benchmark){
             .mandelbrot_func = calculateIterationsFieldIntrinsics,
@@ -35,7 +61,8 @@ int main()
             .file_path = "results/only_iterations_simd_version_O3.txt",
             .graphic_title = "Версия с SIMD инструкциями -O3",
             .warmup_runs = 200,
-            .measure_runs = 10000
+            .measure_runs = 10000,
+            .formula = FORMULA_MANDELBROT
         },
         (Benchmark){
             .mandelbrot_func = calculateIterationFieldArray,
@@ -43,8 +70,54 @@ int main()
             .file_path = "results/only_iterations_array_version_O3.txt",
             .graphic_title = "Версия работающая на массивах -O3",
             .warmup_runs = 200,
-            .measure_runs = 10000
-        } 
+            .measure_runs = 10000,
+            .formula = FORMULA_MANDELBROT
+        },
+        (Benchmark){
+            .mandelbrot_func = calculateFormulaIterationFieldIntrinsics,
+            .name = "only iterations formula engine simd version -O3",
+            .file_path = "results/only_iterations_formula_simd_version_O3.txt",
+            .graphic_title = "Шаблонная формула z^2 + c с SIMD -O3",
+            .warmup_runs = 200,
+            .measure_runs = 10000,
+            .formula = FORMULA_MANDELBROT
+        },
+        (Benchmark){
+            .mandelbrot_func = calculateFormulaIterationFieldArray,
+            .name = "only iterations formula engine array version -O3",
+            .file_path = "results/only_iterations_formula_array_version_O3.txt",
+            .graphic_title = "Шаблонная формула z^2 + c на массивах -O3",
+            .warmup_runs = 200,
+            .measure_runs = 10000,
+            .formula = FORMULA_MANDELBROT
+        },
+        (Benchmark){
+            .mandelbrot_func = calculateFormulaIterationFieldIntrinsics,
+            .name = "only iterations julia simd version -O3",
+            .file_path = "results/only_iterations_julia_simd_version_O3.txt",
+            .graphic_title = "Множество Жюлиа с SIMD -O3",
+            .warmup_runs = 200,
+            .measure_runs = 10000,
+            .formula = FORMULA_JULIA
+        },
+        (Benchmark){
+            .mandelbrot_func = calculateFormulaIterationFieldIntrinsics,
+            .name = "only iterations burning ship simd version -O3",
+            .file_path = "results/only_iterations_burning_ship_simd_version_O3.txt",
+            .graphic_title = "Burning Ship с SIMD -O3",
+            .warmup_runs = 200,
+            .measure_runs = 10000,
+            .formula = FORMULA_BURNING_SHIP
+        },
+        (Benchmark){
+            .mandelbrot_func = calculateFormulaIterationFieldIntrinsics,
+            .name = "only iterations multibrot z^3 simd version -O3",
+            .file_path = "results/only_iterations_multibrot3_simd_version_O3.txt",
+            .graphic_title = "Мультиброт z^3 + c с SIMD -O3",
+            .warmup_runs = 200,
+            .measure_runs = 10000,
+            .formula = FORMULA_MULTIBROT_3
+        }
     };
 
     const int number_of_tests = sizeof(tests) / sizeof(Benchmark);
@@ -66,18 +139,32 @@ int main()
 
         free(results);
     }
+
+    runAdaptiveReport("results/adaptive_iterations.txt");
+    runAntialiasReport("results/antialias.txt");
+    runFieldLayoutReport("results/field_layout.txt");
+    runProgressiveReport("results/progressive.txt");
+    runBuddhabrotReport("results/buddhabrot.txt");
+    runEngineReport("results/engine.txt");
+    runResolutionReport("results/dynamic_resolution.txt");
+    runThumbnailReport("results/thumbnails.txt");
+    runFrameMemoryReport("results/frame_memory.txt");
+    runEqualizeReport("results/equalized_colors.txt");
+    runOrbitCacheReport("results/orbit_cache.txt");
 }
 
 void runBenchmark(Benchmark* config, uint64_t* results)
 {
     MandelbrotData mandelbrot_data = {};
     setDefaultMandelbrot(&mandelbrot_data);
+    setMandelbrotFormula(&mandelbrot_data, config->formula);
 
     uint32_t* pixels = NULL;
     pixels = (uint32_t*)aligned_alloc(32, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
     if (!pixels)
     {
         fprintf(stderr, "Error while allocating memory for testing\n");
+        freeMandelbrot(&mandelbrot_data);
         return;
     }
 
@@ -103,15 +190,57 @@ void runBenchmark(Benchmark* config, uint64_t* results)
     }
 
     free(pixels);
+    freeMandelbrot(&mandelbrot_data);
 }
 
 
+static double measureMs(void (*func)(int pitch, uint32_t* pixels, MandelbrotData* data),
+                        int pitch, uint32_t* pixels, MandelbrotData* data);
+static void calculateFieldByTiles(int pitch, uint32_t* pixels, MandelbrotData* data);
+static void calculateWholeField(int pitch, uint32_t* pixels, MandelbrotData* data);
+static bool measureTileGap(void* context);
+static double coveredPixels(const Buddhabrot* buddhabrot);
+static void   setEngineViewport(RenderViewport* viewport, int job);
+static bool   sameAsDirectRender(const FieldBuffer* buffer);
+static void   setThumbnailViewport(RenderViewport* viewport, uint64_t* random);
+static void   setThumbnailView(MandelbrotData* data, const RenderViewport* viewport);
+static int    openTlbMissCounter();
+static long   minorPageFaults();
+static long   anonHugePagesKb();
+static double equalizedColorizeMs(int pitch, uint32_t* pixels, MandelbrotData* data,
+                                  ColorHistogram* histogram);
+static void   colorizeEqualizedSerially(int pitch, uint32_t* pixels, MandelbrotData* data);
+
+// корутина без результата, которую никто не ждёт: для проверки co_await
+typedef struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask        get_return_object() { return {}; }
+        std::suspend_never  initial_suspend()   { return {}; }
+        std::suspend_never  final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { abort(); }
+    };
+} DetachedTask;
+
+static DetachedTask awaitEngineImage(MandelbrotEngine* engine,
+                                     RenderViewport viewport,
+                                     std::atomic<int>* valid_pixels);
+
+typedef struct TileGapContext
+{
+    uint64_t last;
+    uint64_t max_gap;
+    int      burst_left;    // сколько ещё раз прервать кадр новым видом
+} TileGapContext;
+
+
 void saveResults(Benchmark* config, uint64_t* results)
 {
-    FILE* file = fopen(config->file_path, "w");
+    FILE* file = openReportFile(config->file_path);
     if (!file)
     {
-        fprintf(stderr, "Error while opening file");
         return;
     }
 
@@ -123,3 +252,1278 @@ void saveResults(Benchmark* config, uint64_t* results)
     }
 }
 
+
+
+void runAdaptiveReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    // погружение в "долину морских коньков"
+    const double zooms[] = {1.0, 1e2, 1e4, 1e6, 1e8};
+    const int number_of_zooms = sizeof(zooms) / sizeof(double);
+
+    MandelbrotData mandelbrot_data = {};
+    setDefaultMandelbrot(&mandelbrot_data);
+
+    for (int i = 0; i < number_of_zooms; i++)
+    {
+        mandelbrot_data.zoom = zooms[i];
+        mandelbrot_data.center_x = (i == 0) ? DEFAULT_CENTER_X : -0.743643887037151;
+        mandelbrot_data.center_y = (i == 0) ? DEFAULT_CENTER_Y :  0.131825904205330;
+        updateDimension(&mandelbrot_data);
+
+        AdaptiveFrameStatistics fixed = {};
+        mandelbrot_data.max_iterations = MAX_ITERATIONS;
+
+        uint64_t start = SDL_GetPerformanceCounter();
+        calculateIterationsFieldIntrinsics(&mandelbrot_data);
+
+        fixed.frame_ms = elapsedMs(start);
+        collectFieldStatistics(&mandelbrot_data, false, &fixed);
+
+        AdaptiveFrameStatistics adaptive = {};
+        calculateAdaptiveIterationField(&mandelbrot_data, 
+                                        calculateFormulaIterationFieldIntrinsics, 
+                                        &adaptive);
+        collectFieldStatistics(&mandelbrot_data, true, &adaptive);
+
+        printReport(file, "zoom %g\n  fixed:    ", zooms[i]);
+        printAdaptiveFrameStatistics(stdout, &fixed);
+        printAdaptiveFrameStatistics(file,   &fixed);
+        printReport(file, "  adaptive: ");
+        printAdaptiveFrameStatistics(stdout, &adaptive);
+        printAdaptiveFrameStatistics(file,   &adaptive);
+    }
+
+    freeMandelbrot(&mandelbrot_data);
+    fclose(file);
+}
+
+
+void runAntialiasReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    MandelbrotData mandelbrot_data = {};
+    setDefaultMandelbrot(&mandelbrot_data);
+    if (enableDistanceEstimation(&mandelbrot_data))
+    {
+        fclose(file);
+        return;
+    }
+
+    uint32_t* pixels = (uint32_t*)aligned_alloc(32, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    if (!pixels)
+    {
+        fprintf(stderr, "Error while allocating memory for testing\n");
+        fclose(file);
+        return;
+    }
+    const int pitch = SCREEN_WIDTH * sizeof(uint32_t);
+
+    const FormulaType formulas[] = {FORMULA_MANDELBROT, FORMULA_JULIA, FORMULA_BURNING_SHIP};
+    const int number_of_formulas = sizeof(formulas) / sizeof(FormulaType);
+
+    for (int i = 0; i < number_of_formulas; i++)
+    {
+        setMandelbrotFormula(&mandelbrot_data, formulas[i]);
+
+        uint64_t start = SDL_GetPerformanceCounter();
+        calculateFormulaIterationFieldDistance(&mandelbrot_data);
+        colorizeIterationField(pitch, pixels, &mandelbrot_data);
+        double frame_ms = elapsedMs(start);
+
+        AntialiasStatistics boundary = {};
+        antialiasIterationField(pitch, pixels, &mandelbrot_data, ANTIALIAS_BOUNDARY, &boundary);
+
+        AntialiasStatistics uniform = {};
+        antialiasIterationField(pitch, pixels, &mandelbrot_data, ANTIALIAS_UNIFORM, &uniform);
+
+        printReport(file, "formula %d, frame with distance %.2f ms\n  boundary: ", 
+                    formulas[i], frame_ms);
+        printAntialiasStatistics(stdout, &boundary);
+        printAntialiasStatistics(file,   &boundary);
+        printReport(file, "  uniform:  ");
+        printAntialiasStatistics(stdout, &uniform);
+        printAntialiasStatistics(file,   &uniform);
+    }
+
+    free(pixels);
+    freeMandelbrot(&mandelbrot_data);
+    fclose(file);
+}
+
+
+void runFieldLayoutReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const int sizes[][2] = {{1024, 1024}, {3840, 2160}, {7680, 4320}};
+    const int number_of_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    const struct 
+    {
+        FieldFormat format;
+        FieldLayout layout;
+        const char* name;
+    } layouts[] = {
+        {FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS,   "i32 rows  "},
+        {FIELD_FORMAT_U16, FIELD_LAYOUT_ROWS,   "u16 rows  "},
+        {FIELD_FORMAT_U16, FIELD_LAYOUT_TILED,  "u16 tiled "},
+        {FIELD_FORMAT_U16, FIELD_LAYOUT_MORTON, "u16 morton"},
+    };
+    const int number_of_layouts = sizeof(layouts) / sizeof(layouts[0]);
+
+    MandelbrotData mandelbrot_data = {};
+    setDefaultMandelbrot(&mandelbrot_data);
+
+    for (int i = 0; i < number_of_sizes; i++)
+    {
+        const int width  = sizes[i][0];
+        const int height = sizes[i][1];
+        const int pitch  = width * sizeof(uint32_t);
+
+        uint32_t* pixels = (uint32_t*)aligned_alloc(32, (size_t)pitch * height);
+        if (!pixels)
+        {
+            fprintf(stderr, "Error while allocating memory for testing\n");
+            break;
+        }
+
+        for (int j = 0; j < number_of_layouts; j++)
+        {
+            if (setMandelbrotField(&mandelbrot_data, width, height, 
+                                   layouts[j].format, layouts[j].layout))
+            {
+                break;
+            }
+
+            double field_ms    = measureMs(calculateWholeField,   pitch, pixels, &mandelbrot_data);
+            double tiles_ms    = measureMs(calculateFieldByTiles, pitch, pixels, &mandelbrot_data);
+            double colorize_ms = measureMs(colorizeIterationField, pitch, pixels, &mandelbrot_data);
+
+            // поле пишется ядром и читается раскраской
+            const double field_mb   = mandelbrot_data.field.bytes / (1024.0 * 1024.0);
+            const double traffic_mb = 2.0 * field_mb;
+            const double pixels_mb  = (double)pitch * height / (1024.0 * 1024.0);
+
+            printReport(file, 
+                        "%dx%d %s: field %.2f MB, field traffic %.2f MB/frame, "
+                        "kernel %.2f ms, kernel by tiles %.2f ms, "
+                        "colorize %.2f ms (%.2f GB/s)\n",
+                        width, height, layouts[j].name, field_mb, traffic_mb,
+                        field_ms, tiles_ms, colorize_ms,
+                        (field_mb + pixels_mb) / 1024.0 / (colorize_ms / 1000.0));
+        }
+
+        free(pixels);
+    }
+
+    freeMandelbrot(&mandelbrot_data);
+    fclose(file);
+}
+
+
+void runProgressiveReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const double zooms[] = {1.0, 1e4, 1e8};
+    const int    iterations[] = {MAX_ITERATIONS, 2048, 8192};
+    const int number_of_zooms = sizeof(zooms) / sizeof(double);
+
+    const double budget_ms = 16.0;
+    const int    burst = 5;
+
+    MandelbrotData mandelbrot_data = {};
+    setDefaultMandelbrot(&mandelbrot_data);
+
+    const int pitch = SCREEN_WIDTH * sizeof(uint32_t);
+    uint32_t* pixels = (uint32_t*)aligned_alloc(32, (size_t)pitch * SCREEN_HEIGHT);
+
+    ProgressiveFrame frame = {};
+    if (!pixels || createProgressiveFrame(&frame, pitch, &mandelbrot_data))
+    {
+        fprintf(stderr, "Error while allocating memory for testing\n");
+        free(pixels);
+        freeMandelbrot(&mandelbrot_data);
+        fclose(file);
+        return;
+    }
+
+    for (int i = 0; i < number_of_zooms; i++)
+    {
+        mandelbrot_data.zoom = zooms[i];
+        mandelbrot_data.center_x = (i == 0) ? DEFAULT_CENTER_X : -0.743643887037151;
+        mandelbrot_data.center_y = (i == 0) ? DEFAULT_CENTER_Y :  0.131825904205330;
+        mandelbrot_data.max_iterations = iterations[i];
+        updateDimension(&mandelbrot_data);
+
+        // полный кадр без прерываний
+        uint64_t start = SDL_GetPerformanceCounter();
+        calculateFormulaIterationFieldIntrinsics(&mandelbrot_data);
+        colorizeIterationField(pitch, pixels, &mandelbrot_data);
+        double full_ms = elapsedMs(start);
+
+        // тот же кадр срезами по бюджету, самый долгий промежуток между
+        // проверками отмены - худшая задержка реакции на ввод
+        TileGapContext gaps = {};
+        ProgressiveStatistics stats = {};
+        mandelbrot_data.zoom *= 1.0001;
+        updateDimension(&mandelbrot_data);
+
+        gaps.last = SDL_GetPerformanceCounter();
+        do
+        {
+            renderProgressiveFrame(&frame, pixels, &mandelbrot_data, 
+                                   calculateFormulaIterationRectIntrinsics,
+                                   budget_ms, measureTileGap, &gaps, &stats);
+        } while (!stats.completed);
+
+        // серия из burst нажатий "+": без отмены считается каждый кадр
+        // целиком, с отменой - только по одной плитке от ненужных кадров
+        start = SDL_GetPerformanceCounter();
+        for (int press = 0; press < burst; press++)
+        {
+            mandelbrot_data.zoom *= ZOOM_FACTOR;
+            updateDimension(&mandelbrot_data);
+            calculateFormulaIterationFieldIntrinsics(&mandelbrot_data);
+            colorizeIterationField(pitch, pixels, &mandelbrot_data);
+        }
+        double burst_full_ms = elapsedMs(start);
+
+        mandelbrot_data.zoom /= pow(ZOOM_FACTOR, burst);
+        updateDimension(&mandelbrot_data);
+
+        TileGapContext burst_gaps = {};
+        ProgressiveStatistics burst_stats = {};
+        start = SDL_GetPerformanceCounter();
+        for (int press = 0; press < burst; press++)
+        {
+            mandelbrot_data.zoom *= ZOOM_FACTOR;
+            updateDimension(&mandelbrot_data);
+
+            burst_gaps.burst_left = (press + 1 < burst) ? 1 : 0;
+            burst_gaps.last = SDL_GetPerformanceCounter();
+            do
+            {
+                renderProgressiveFrame(&frame, pixels, &mandelbrot_data,
+                                       calculateFormulaIterationRectIntrinsics,
+                                       0, measureTileGap, &burst_gaps, &burst_stats);
+            } while (!burst_stats.completed && !burst_stats.cancelled);
+        }
+        double burst_cancel_ms = elapsedMs(start);
+
+        printReport(file,
+                    "zoom %g, %d iterations: full frame %.2f ms, by tiles %.2f ms in %d slices "
+                    "of %.0f ms, worst gap between cancel checks %.2f ms; %d zoom presses: "
+                    "%.2f ms without cancelling, %.2f ms with\n",
+                    zooms[i], iterations[i], full_ms, stats.frame_ms, stats.slices, budget_ms,
+                    ticksToMs(gaps.max_gap), burst, burst_full_ms, burst_cancel_ms);
+    }
+
+    destroyProgressiveFrame(&frame);
+    free(pixels);
+    freeMandelbrot(&mandelbrot_data);
+    fclose(file);
+}
+
+
+// панорамирование стрелкой по кадру на каждый ввод: в полном разрешении
+// и с регулятором, который подбирает разрешение под целевое время кадра
+void runResolutionReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const double zooms[] = {1.0, 1e4, 1e6};
+    const int    iterations[] = {MAX_ITERATIONS, 2048, 2048};
+    const int number_of_zooms = sizeof(zooms) / sizeof(double);
+
+    const int    frames    = 30;
+    const double target_ms = RESOLUTION_TARGET_MS;
+
+    MandelbrotData mandelbrot_data = {};
+    setDefaultMandelbrot(&mandelbrot_data);
+
+    const int pitch = SCREEN_WIDTH * sizeof(uint32_t);
+    uint32_t* pixels = (uint32_t*)aligned_alloc(32, (size_t)pitch * SCREEN_HEIGHT);
+    if (!pixels)
+    {
+        fprintf(stderr, "Error while allocating memory for testing\n");
+        freeMandelbrot(&mandelbrot_data);
+        fclose(file);
+        return;
+    }
+
+    for (int i = 0; i < number_of_zooms; i++)
+    {
+        setMandelbrotField(&mandelbrot_data, SCREEN_WIDTH, SCREEN_HEIGHT,
+                           FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS);
+        mandelbrot_data.zoom = zooms[i];
+        mandelbrot_data.center_x = (i == 0) ? DEFAULT_CENTER_X : -0.743643887037151;
+        mandelbrot_data.center_y = (i == 0) ? DEFAULT_CENTER_Y :  0.131825904205330;
+        mandelbrot_data.max_iterations = iterations[i];
+        updateDimension(&mandelbrot_data);
+
+        const double start_x = mandelbrot_data.center_x;
+
+        double full_ms = 0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            mandelbrot_data.center_x += mandelbrot_data.width * MOVE_SPEED;
+            full_ms += measureMs(calculateMandelbrotIntrinsicsSeparated, pitch, pixels, &mandelbrot_data);
+        }
+        mandelbrot_data.center_x = start_x;
+
+        // первый кадр до ввода - полный, он же первая оценка цены пикселя
+        ResolutionController controller = {};
+        ResolutionStatistics stats = {};
+        initResolutionController(&controller, SCREEN_WIDTH, SCREEN_HEIGHT, target_ms);
+
+        for (int frame = -1; frame <= frames; frame++)
+        {
+            uint64_t now = SDL_GetTicksNS();
+            if (frame >= 0 && frame < frames)
+            {
+                mandelbrot_data.center_x += mandelbrot_data.width * MOVE_SPEED;
+                noteResolutionInput(&controller, now);
+            }
+            else if (frame == frames)
+            {
+                now += (uint64_t)RESOLUTION_IDLE_MS * 1000000;
+            }
+
+            if (!chooseFrameResolution(&controller, now))
+            {
+                continue;
+            }
+            if (controller.width != mandelbrot_data.field.width)
+            {
+                setMandelbrotField(&mandelbrot_data, controller.width, controller.height,
+                                   FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS);
+            }
+
+            double frame_ms = measureMs(calculateMandelbrotIntrinsicsSeparated,
+                                        pitch, pixels, &mandelbrot_data);
+            recordFrameCost(&controller, frame_ms, frame_ms, &stats);
+            if (frame < 0)
+            {
+                stats = {};
+            }
+        }
+
+        printReport(file, "zoom %g, %d iterations, %d panning frames: full resolution %.2f ms "
+                          "mean; ", zooms[i], iterations[i], frames, full_ms / frames);
+        printResolutionStatistics(stdout, &controller, &stats);
+        printResolutionStatistics(file,   &controller, &stats);
+    }
+
+    free(pixels);
+    freeMandelbrot(&mandelbrot_data);
+    fclose(file);
+}
+
+
+// галерея из одинаковых миниатюр: по одной на вызов
+// calculateMandelbrotIntrinsicsSeparated с подготовкой MandelbrotData на
+// каждую, с одной подготовленной MandelbrotData и одним пакетом
+void runThumbnailReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const int thumbnails = 1024;
+    const int size = 128;
+    const int pitch = size * sizeof(uint32_t);
+
+    ThumbnailBatch batch = {};
+    uint32_t* pixels = (uint32_t*)aligned_alloc(32, (size_t)pitch * size);
+    RenderViewport* viewports = (RenderViewport*)calloc(thumbnails, sizeof(RenderViewport));
+    if (!pixels || !viewports || createThumbnailBatch(&batch, size, size, thumbnails, NULL))
+    {
+        fprintf(stderr, "Error while allocating memory for testing\n");
+        free(pixels);
+        free(viewports);
+        fclose(file);
+        return;
+    }
+
+    uint64_t random = 0x2545F4914F6CDD1Dull;
+    for (int i = 0; i < thumbnails; i++)
+    {
+        setThumbnailViewport(&viewports[i], &random);
+        addThumbnail(&batch, &viewports[i]);
+    }
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < thumbnails; i++)
+    {
+        MandelbrotData mandelbrot_data = {};
+        setDefaultMandelbrot(&mandelbrot_data);
+        setMandelbrotField(&mandelbrot_data, size, size, FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS);
+        setThumbnailView(&mandelbrot_data, &viewports[i]);
+        calculateMandelbrotIntrinsicsSeparated(pitch, pixels, &mandelbrot_data);
+        freeMandelbrot(&mandelbrot_data);
+    }
+    double setup_ms = elapsedMs(start);
+
+    MandelbrotData mandelbrot_data = {};
+    setDefaultMandelbrot(&mandelbrot_data);
+    setMandelbrotField(&mandelbrot_data, size, size, FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS);
+
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < thumbnails; i++)
+    {
+        setThumbnailView(&mandelbrot_data, &viewports[i]);
+        calculateMandelbrotIntrinsicsSeparated(pitch, pixels, &mandelbrot_data);
+    }
+    double loop_ms = elapsedMs(start);
+
+    printReport(file, "%d thumbnails %dx%d: calculateMandelbrotIntrinsicsSeparated with setup "
+                      "per thumbnail %.0f thumbnails/s, with shared setup %.0f thumbnails/s\n",
+                thumbnails, size, size, thumbnails * 1000.0 / setup_ms, thumbnails * 1000.0 / loop_ms);
+
+    const int max_threads = defaultThreadCount();
+    for (int threads = 1; ; threads *= 2)
+    {
+        if (threads > max_threads)
+        {
+            threads = max_threads;
+        }
+
+        ThreadPool* pool = createThreadPool(threads);
+        ThumbnailStatistics stats = {};
+        renderThumbnailBatch(&batch, pool, &stats);
+        destroyThreadPool(pool);
+
+        printReport(file, "batch, %d threads: ", threads);
+        printThumbnailStatistics(stdout, &stats);
+        printThumbnailStatistics(file,   &stats);
+
+        if (threads == max_threads)
+        {
+            break;
+        }
+    }
+
+    int mismatched = 0;
+    for (int i = 0; i < thumbnails; i++)
+    {
+        setThumbnailView(&mandelbrot_data, &viewports[i]);
+        calculateMandelbrotIntrinsicsSeparated(pitch, pixels, &mandelbrot_data);
+        mismatched += (memcmp(pixels, thumbnailPixels(&batch, i), (size_t)pitch * size) != 0);
+    }
+    printReport(file, "%d of %d thumbnails differ from calculateMandelbrotIntrinsicsSeparated\n",
+                mismatched, thumbnails);
+
+    freeMandelbrot(&mandelbrot_data);
+    destroyThumbnailBatch(&batch);
+    free(viewports);
+    free(pixels);
+    fclose(file);
+}
+
+
+// кадр 8K: поле и картинка через aligned_alloc на каждый кадр, как раньше
+// у setDefaultMandelbrot, и через пул кадров со страницами 4 КБ и 2 МБ;
+// итераций мало, чтобы проходы по памяти не прятались за арифметикой
+void runFrameMemoryReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const int width  = 7680;
+    const int height = 4320;
+    const int frames = 4;
+
+    const int    pitch        = width * sizeof(uint32_t);
+    const size_t pixels_bytes = (size_t)pitch * height;
+    const size_t field_bytes  = iterationFieldBytes(width, height, FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS);
+
+    MandelbrotData mandelbrot_data = {};
+    setMandelbrotPalette(&mandelbrot_data);
+    mandelbrot_data.zoom           = DEFAULT_ZOOM;
+    mandelbrot_data.center_x       = DEFAULT_CENTER_X;
+    mandelbrot_data.center_y       = DEFAULT_CENTER_Y;
+    mandelbrot_data.formula        = FORMULA_MANDELBROT;
+    mandelbrot_data.max_iterations = ADAPTIVE_MIN_ITERATIONS;
+    mandelbrot_data.width          = DEFAULT_WIDTH / DEFAULT_ZOOM;
+    mandelbrot_data.height         = mandelbrot_data.width * height / width;
+
+    const char* names[] = {"aligned_alloc per frame", "frame pool, 4 KB pages", "frame pool, huge pages"};
+    const int number_of_modes = sizeof(names) / sizeof(names[0]);
+
+    const int tlb_counter = openTlbMissCounter();
+
+    for (int mode = 0; mode < number_of_modes; mode++)
+    {
+        FramePoolConfig config = {};
+        setDefaultFramePoolConfig(&config);
+        config.huge_pages  = (mode == 2);
+        config.first_touch = false;
+        config.populate    = (mode == 2);
+        FramePool* pool = (mode > 0) ? createFramePool(&config) : NULL;
+
+        long huge_kb = 0;
+        const long faults_before = minorPageFaults();
+        if (tlb_counter >= 0)
+        {
+            ioctl(tlb_counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(tlb_counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        const uint64_t start = SDL_GetPerformanceCounter();
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            void* field_data = pool ? acquireFrameBuffer(pool, field_bytes) : aligned_alloc(32, field_bytes);
+            uint32_t* pixels = (uint32_t*)(pool ? acquireFrameBuffer(pool, pixels_bytes)
+                                                : aligned_alloc(32, pixels_bytes));
+            if (!field_data || !pixels || attachIterationField(&mandelbrot_data.field, field_data, width, height,
+                                                               FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS))
+            {
+                fprintf(stderr, "Error while allocating memory for testing\n");
+                break;
+            }
+
+            calculateFormulaIterationFieldIntrinsics(&mandelbrot_data);
+            colorizeIterationField(pitch, pixels, &mandelbrot_data);
+            if (frame == 0)
+            {
+                huge_kb = anonHugePagesKb();
+            }
+
+            destroyIterationField(&mandelbrot_data.field);
+            if (pool)
+            {
+                releaseFrameBuffer(pool, field_data, field_bytes);
+                releaseFrameBuffer(pool, pixels, pixels_bytes);
+            }
+            else
+            {
+                free(field_data);
+                free(pixels);
+            }
+        }
+
+        const double ms = elapsedMs(start);
+        const long faults = minorPageFaults() - faults_before;
+        long long tlb_misses = -1;
+        if (tlb_counter >= 0)
+        {
+            ioctl(tlb_counter, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(tlb_counter, &tlb_misses, sizeof(tlb_misses)) != sizeof(tlb_misses))
+            {
+                tlb_misses = -1;
+            }
+        }
+
+        printReport(file, "%dx%d, %d frames, %s: %.1f ms per frame, %ld page faults, ",
+                    width, height, frames, names[mode], ms / frames, faults);
+        if (tlb_misses >= 0)
+        {
+            printReport(file, "%lld dTLB load misses, ", tlb_misses);
+        }
+        else
+        {
+            printReport(file, "dTLB load misses unavailable, ");
+        }
+        printReport(file, "%.0f MB in huge pages\n", huge_kb / 1024.0);
+
+        destroyFramePool(pool);
+    }
+
+    if (tlb_counter >= 0)
+    {
+        close(tlb_counter);
+    }
+    fclose(file);
+}
+
+
+// число потоков удваивается до числа ядер, каждый поток берёт равную
+// долю выборок; ускорение считается относительно одного потока
+// выравнивание гистограммы против обычной палитры на кадре 4K; простой
+// последовательный вариант служит образцом и точкой отсчёта по скорости
+void runEqualizeReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const int width  = 3840;
+    const int height = 2160;
+    const int pitch  = width * sizeof(uint32_t);
+
+    const struct
+    {
+        FieldFormat format;
+        FieldLayout layout;
+        double      zoom;
+        int         max_iterations;
+        const char* name;
+    } cases[] = {
+        {FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS,  1.0,   MAX_ITERATIONS, "i32 rows,  zoom 1,   512 it "},
+        {FIELD_FORMAT_U16, FIELD_LAYOUT_TILED, 1.0,   MAX_ITERATIONS, "u16 tiled, zoom 1,   512 it "},
+        {FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS,  100.0, 4096,           "i32 rows,  zoom 100, 4096 it"},
+    };
+    const int number_of_cases = sizeof(cases) / sizeof(cases[0]);
+
+    uint32_t* pixels    = (uint32_t*)aligned_alloc(32, (size_t)pitch * height);
+    uint32_t* reference = (uint32_t*)aligned_alloc(32, (size_t)pitch * height);
+    ThreadPool* pool = createThreadPool(defaultThreadCount());
+    ColorHistogram histogram = {};
+    if (!pixels || !reference || createColorHistogram(&histogram, pool))
+    {
+        fprintf(stderr, "Error while allocating memory for testing\n");
+        free(pixels);
+        free(reference);
+        destroyThreadPool(pool);
+        fclose(file);
+        return;
+    }
+
+    MandelbrotData mandelbrot_data = {};
+    setDefaultMandelbrot(&mandelbrot_data);
+
+    for (int i = 0; i < number_of_cases; i++)
+    {
+        if (setMandelbrotField(&mandelbrot_data, width, height, cases[i].format, cases[i].layout))
+        {
+            break;
+        }
+        mandelbrot_data.center_x       = -0.743643887037151;
+        mandelbrot_data.center_y       = 0.131825904205330;
+        mandelbrot_data.zoom           = cases[i].zoom;
+        mandelbrot_data.max_iterations = cases[i].max_iterations;
+        updateDimension(&mandelbrot_data);
+
+        const double field_ms    = measureMs(calculateWholeField, pitch, pixels, &mandelbrot_data);
+        const double palette_ms  = measureMs(colorizeIterationField, pitch, pixels, &mandelbrot_data);
+        const double serial_ms   = measureMs(colorizeEqualizedSerially, pitch, reference, &mandelbrot_data);
+        const double equalize_ms = equalizedColorizeMs(pitch, pixels, &mandelbrot_data, &histogram);
+
+        long mismatches = 0;
+        for (size_t j = 0; j < (size_t)width * height; j++)
+        {
+            mismatches += (pixels[j] != reference[j]);
+        }
+
+        const double palette_frame_ms = field_ms + palette_ms;
+        printReport(file,
+                    "%dx%d %s: field %.2f ms, palette %.2f ms, equalized %.2f ms "
+                    "(serial %.2f ms), frame +%.1f%%, %ld mismatches, %d threads\n",
+                    width, height, cases[i].name, field_ms, palette_ms, equalize_ms, serial_ms,
+                    100.0 * (equalize_ms - palette_ms) / palette_frame_ms, mismatches,
+                    threadPoolSize(pool));
+    }
+
+    destroyColorHistogram(&histogram);
+    destroyThreadPool(pool);
+    freeMandelbrot(&mandelbrot_data);
+    free(pixels);
+    free(reference);
+    fclose(file);
+}
+
+
+// сеансы приближения к детали, как в окне: каждый кадр - клик рядом с
+// ней, переносящий центр, и несколько нажатий "=" по ZOOM_FACTOR. Каждый
+// кадр сверяется с полным пересчётом с z = 0; для сравнения там же
+// считается, на сколько точек расходятся ядра array и SIMD
+void runOrbitCacheReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const struct
+    {
+        double      x;
+        double      y;
+        const char* name;
+    } targets[] = {
+        {-0.743643887037151,  0.131825904205330,    "seahorse valley"},
+        {0.28693186889504513, 0.014286693904085048, "elephant valley"},
+    };
+    const int number_of_targets = sizeof(targets) / sizeof(targets[0]);
+
+    const int    size           = 512;
+    const int    max_iterations = 2048;
+    const int    frames         = 32;
+    const int    presses        = 8;       // нажатий "=" на кадр
+    const double click_miss     = 0.05;    // клик мимо цели на долю ширины кадра
+
+    MandelbrotData mandelbrot_data = {};
+    setDefaultMandelbrot(&mandelbrot_data);
+    if (setMandelbrotField(&mandelbrot_data, size, size, FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS))
+    {
+        freeMandelbrot(&mandelbrot_data);
+        fclose(file);
+        return;
+    }
+
+    const size_t field_bytes = mandelbrot_data.field.bytes;
+    int* cached_field = (int*)aligned_alloc(32, (field_bytes + 31) / 32 * 32);
+    int* direct_field = (int*)aligned_alloc(32, (field_bytes + 31) / 32 * 32);
+    if (!cached_field || !direct_field)
+    {
+        fprintf(stderr, "Error while allocating memory for testing\n");
+        free(cached_field);
+        free(direct_field);
+        freeMandelbrot(&mandelbrot_data);
+        fclose(file);
+        return;
+    }
+
+    const int* field = (const int*)mandelbrot_data.field.data;
+    const size_t pixels = (size_t)size * size;
+
+    for (int t = 0; t < number_of_targets; t++)
+    {
+        OrbitCache cache = {};
+        initOrbitCache(&cache);
+
+        mandelbrot_data.center_x       = DEFAULT_CENTER_X;
+        mandelbrot_data.center_y       = DEFAULT_CENTER_Y;
+        mandelbrot_data.zoom           = DEFAULT_ZOOM;
+        mandelbrot_data.max_iterations = max_iterations;
+        updateDimension(&mandelbrot_data);
+
+        uint64_t saved = 0;
+        uint64_t total = 0;
+        long     mismatches = 0;
+        long     kernel_mismatches = 0;
+        int      reused_frames = 0;
+        int      rejected_skips = 0;
+        double   cached_ms = 0;
+        double   direct_ms = 0;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            const double miss = (frame % 2) ? click_miss : -click_miss;
+            mandelbrot_data.center_x = targets[t].x + miss * mandelbrot_data.width;
+            mandelbrot_data.center_y = targets[t].y - miss * mandelbrot_data.height;
+            for (int press = 0; press < presses; press++)
+            {
+                mandelbrot_data.zoom *= ZOOM_FACTOR;
+            }
+            updateDimension(&mandelbrot_data);
+
+            OrbitCacheStatistics stats = {};
+            uint64_t start = SDL_GetPerformanceCounter();
+            calculateOrbitCachedField(&cache, &mandelbrot_data, &stats);
+            uint64_t middle = SDL_GetPerformanceCounter();
+            memcpy(cached_field, field, field_bytes);
+            calculateIterationsFieldIntrinsics(&mandelbrot_data);
+            uint64_t end = SDL_GetPerformanceCounter();
+            memcpy(direct_field, field, field_bytes);
+            calculateIterationFieldArray(&mandelbrot_data);
+
+            long frame_mismatches = 0;
+            long frame_kernel_mismatches = 0;
+            for (size_t i = 0; i < pixels; i++)
+            {
+                frame_mismatches        += (cached_field[i] != direct_field[i]);
+                frame_kernel_mismatches += (field[i] != direct_field[i]);
+            }
+
+            cached_ms         += ticksToMs(middle - start);
+            direct_ms         += ticksToMs(end - middle);
+            saved             += stats.saved;
+            total             += stats.saved + stats.iterations;
+            mismatches        += frame_mismatches;
+            kernel_mismatches += frame_kernel_mismatches;
+            reused_frames     += stats.reused;
+            rejected_skips    += stats.rejected_skips;
+
+            fprintf(file, "%s frame %2d zoom %9.3g: %s reference, skip %4d (halved %d), %5.1f%% saved, "
+                          "%4d of %d probes off, %5.2f%% pixels differ from full recompute "
+                          "(array kernel %5.2f%%)\n",
+                    targets[t].name, frame, mandelbrot_data.zoom, stats.reused ? "cached" : "new   ",
+                    stats.skip, stats.rejected_skips, 100.0 * stats.saved / (stats.saved + stats.iterations),
+                    stats.probe_mismatches, stats.probes,
+                    100.0 * frame_mismatches / pixels, 100.0 * frame_kernel_mismatches / pixels);
+        }
+
+        printReport(file,
+                    "%s, %dx%d, %d frames to zoom %.2g, %d it: %d frames reused a cached orbit, "
+                    "skip halved %d times by the probe check, "
+                    "%.2fM of %.2fM iterations saved per frame (%.1f%%), %.1f ms vs %.1f ms per frame, "
+                    "%.2f%% pixels differ from full recompute, array kernel differs from SIMD in %.2f%%\n",
+                    targets[t].name, size, size, frames, mandelbrot_data.zoom, max_iterations,
+                    reused_frames, rejected_skips, saved / 1e6 / frames, total / 1e6 / frames, 100.0 * saved / total,
+                    cached_ms / frames, direct_ms / frames,
+                    100.0 * mismatches / ((double)pixels * frames),
+                    100.0 * kernel_mismatches / ((double)pixels * frames));
+
+        destroyOrbitCache(&cache);
+    }
+
+    free(cached_field);
+    free(direct_field);
+    freeMandelbrot(&mandelbrot_data);
+    fclose(file);
+}
+
+
+void runBuddhabrotReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const int size        = 512;
+    const int max_threads = defaultThreadCount();
+
+    Buddhabrot buddhabrot = {};
+    if (createBuddhabrot(&buddhabrot, size, size, max_threads))
+    {
+        fclose(file);
+        return;
+    }
+
+    const BuddhabrotMode modes[] = {BUDDHABROT_ESCAPING, BUDDHABROT_ANTI};
+    for (int i = 0; i < 2; i++)
+    {
+        BuddhabrotConfig config = {};
+        setDefaultBuddhabrotConfig(&config, modes[i]);
+
+        double single_thread = 0;
+        for (int threads = 1; ; threads = (threads * 2 < max_threads) ? threads * 2 : max_threads)
+        {
+            ThreadPool* pool = createThreadPool(threads);
+
+            BuddhabrotStatistics stats = {};
+            renderBuddhabrot(&buddhabrot, &config, pool, &stats);
+            destroyThreadPool(pool);
+
+            if (threads == 1)
+            {
+                single_thread = stats.samples_per_second;
+            }
+
+            printReport(file, "%s, %d threads: speedup %.2fx\n  ",
+                        modes[i] == BUDDHABROT_ANTI ? "anti-buddhabrot" : "buddhabrot",
+                        threads, single_thread > 0 ? stats.samples_per_second / single_thread : 0);
+            printBuddhabrotStatistics(stdout, &stats);
+            printBuddhabrotStatistics(file,   &stats);
+
+            if (threads == max_threads)
+            {
+                break;
+            }
+        }
+    }
+
+    // увеличенный вид у края множества: большая часть орбит мимо него
+    ThreadPool* pool = createThreadPool(max_threads);
+    for (int importance = 0; importance < 2; importance++)
+    {
+        BuddhabrotConfig config = {};
+        setDefaultBuddhabrotConfig(&config, BUDDHABROT_ESCAPING);
+        config.center_x    = -0.1;
+        config.center_y    = 0.85;
+        config.view_width  = 0.2;
+        config.view_height = 0.2;
+        config.importance_sampling = importance;
+
+        BuddhabrotStatistics stats = {};
+        renderBuddhabrot(&buddhabrot, &config, pool, &stats);
+
+        printReport(file, "zoomed view, importance sampling %s: %.1f%% pixels hit\n  ",
+                    importance ? "on" : "off", coveredPixels(&buddhabrot));
+        printBuddhabrotStatistics(stdout, &stats);
+        printBuddhabrotStatistics(file,   &stats);
+    }
+    destroyThreadPool(pool);
+
+    destroyBuddhabrot(&buddhabrot);
+    fclose(file);
+}
+
+
+// одни и те же задачи сначала по одной, потом все сразу; каждое поле
+// сравнивается с обычным расчётом через MandelbrotData
+void runEngineReport(const char* file_path)
+{
+    FILE* file = openReportFile(file_path);
+    if (!file)
+    {
+        return;
+    }
+
+    const int jobs = 16;
+
+    MandelbrotEngine engine;
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < jobs; i++)
+    {
+        RenderViewport viewport = {};
+        setEngineViewport(&viewport, i);
+
+        FieldBuffer buffer = engine.renderField(viewport).get();
+    }
+    double sequential_ms = elapsedMs(start);
+
+    std::future<FieldBuffer>* results = new std::future<FieldBuffer>[jobs];
+
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < jobs; i++)
+    {
+        RenderViewport viewport = {};
+        setEngineViewport(&viewport, i);
+
+        results[i] = engine.renderField(viewport);
+    }
+
+    int matching = 0;
+    FieldBuffer* buffers = new FieldBuffer[jobs];
+    for (int i = 0; i < jobs; i++)
+    {
+        buffers[i] = results[i].get();
+    }
+    double concurrent_ms = elapsedMs(start);
+
+    for (int i = 0; i < jobs; i++)
+    {
+        matching += sameAsDirectRender(&buffers[i]);
+    }
+    delete[] buffers;
+    delete[] results;
+
+    RenderViewport image_viewport = {};
+    setEngineViewport(&image_viewport, 0);
+
+    std::atomic<int> valid_pixels(-1);
+    awaitEngineImage(&engine, image_viewport, &valid_pixels);
+    while (valid_pixels.load() < 0)
+    {
+        SDL_Delay(1);
+    }
+
+    printReport(file,
+                "engine with %d threads, %d jobs of %dx%d:\n"
+                "  one by one %.2f ms (%.1f jobs/s), all at once %.2f ms (%.1f jobs/s)\n"
+                "  %d of %d fields match the direct render, co_await image %s\n",
+                engine.threads(), jobs, image_viewport.width, image_viewport.height,
+                sequential_ms, jobs * 1000.0 / sequential_ms,
+                concurrent_ms, jobs * 1000.0 / concurrent_ms,
+                matching, jobs, valid_pixels.load() ? "ok" : "failed");
+
+    fclose(file);
+}
+
+
+static double measureMs(void (*func)(int pitch, uint32_t* pixels, MandelbrotData* data),
+                        int pitch, uint32_t* pixels, MandelbrotData* data)
+{
+    const int runs = 3;
+    double best = 0.0;
+
+    for (int i = 0; i < runs; i++)
+    {
+        uint64_t start = SDL_GetPerformanceCounter();
+        func(pitch, pixels, data);
+
+        double ms = elapsedMs(start);
+        if (i == 0 || ms < best)
+        {
+            best = ms;
+        }
+    }
+
+    return best;
+}
+
+
+static void calculateWholeField(int, uint32_t*, MandelbrotData* data)
+{
+    calculateFormulaIterationFieldIntrinsics(data);
+}
+
+
+// плитки обходятся в порядке хранения, так что запись идёт подряд по памяти
+static void calculateFieldByTiles(int, uint32_t*, MandelbrotData* data)
+{
+    const int tiles = fieldTileCount(&data->field);
+    for (int slot = 0; slot < tiles; slot++)
+    {
+        calculateFormulaIterationRectIntrinsics(data, fieldTileRect(&data->field, slot));
+    }
+}
+
+
+// вызывается между плитками; отменяет кадр, пока не исчерпан burst_left
+static bool measureTileGap(void* context)
+{
+    TileGapContext* gaps = (TileGapContext*)context;
+
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (now - gaps->last > gaps->max_gap)
+    {
+        gaps->max_gap = now - gaps->last;
+    }
+    gaps->last = now;
+
+    if (gaps->burst_left > 0)
+    {
+        gaps->burst_left--;
+        return true;
+    }
+
+    return false;
+}
+
+
+static double equalizedColorizeMs(int pitch, uint32_t* pixels, MandelbrotData* data,
+                                  ColorHistogram* histogram)
+{
+    const int runs = 3;
+    double best = 0.0;
+
+    for (int i = 0; i < runs; i++)
+    {
+        uint64_t start = SDL_GetPerformanceCounter();
+        colorizeEqualizedIterationField(pitch, pixels, data, histogram);
+
+        double ms = elapsedMs(start);
+        if (i == 0 || ms < best)
+        {
+            best = ms;
+        }
+    }
+
+    return best;
+}
+
+
+// по точке за раз: гистограмма, префиксная сумма, таблица цветов
+static void colorizeEqualizedSerially(int pitch, uint32_t* pixels, MandelbrotData* data)
+{
+    const IterationField* field = &data->field;
+    const int max_iterations = data->max_iterations;
+    const int pitch_u32 = pitch / sizeof(uint32_t);
+
+    uint64_t* counts = (uint64_t*)calloc(max_iterations + 1, sizeof(uint64_t));
+    uint32_t* lookup = (uint32_t*)calloc(max_iterations + 1, sizeof(uint32_t));
+    if (!counts || !lookup)
+    {
+        free(counts);
+        free(lookup);
+        return;
+    }
+
+    for (int y = 0; y < field->height; y++)
+    {
+        for (int x = 0; x < field->width; x++)
+        {
+            const int iterations = fieldLoad(field, x, y);
+            counts[iterations < max_iterations ? iterations : max_iterations]++;
+        }
+    }
+
+    uint64_t escaped = 0;
+    for (int i = 0; i < max_iterations; i++)
+    {
+        escaped += counts[i];
+    }
+
+    uint64_t cumulative = 0;
+    for (int i = 0; i < max_iterations; i++)
+    {
+        cumulative += counts[i];
+        lookup[i] = data->colors[escaped ? cumulative * (MAX_ITERATIONS - 1) / escaped : 0];
+    }
+    lookup[max_iterations] = data->colors[0];
+
+    for (int y = 0; y < field->height; y++)
+    {
+        for (int x = 0; x < field->width; x++)
+        {
+            const int iterations = fieldLoad(field, x, y);
+            pixels[y * pitch_u32 + x] = lookup[iterations < max_iterations ? iterations : max_iterations];
+        }
+    }
+
+    free(counts);
+    free(lookup);
+}
+
+
+static double coveredPixels(const Buddhabrot* buddhabrot)
+{
+    const size_t pixels = (size_t)buddhabrot->width * buddhabrot->height;
+
+    size_t covered = 0;
+    for (size_t i = 0; i < pixels; i++)
+    {
+        covered += (buddhabrot->histogram[i] > 0);
+    }
+
+    return 100.0 * covered / pixels;
+}
+
+
+// задачи приближаются к точке на границе, так что их цена растёт
+static void setEngineViewport(RenderViewport* viewport, int job)
+{
+    setDefaultRenderViewport(viewport, 1024, 768);
+
+    viewport->center_x   = -0.7453;
+    viewport->center_y   = 0.1127;
+    viewport->view_width = DEFAULT_WIDTH / pow(1.8, job);
+}
+
+
+// случайная точка у границы множества под случайным увеличением до 1e3
+static void setThumbnailViewport(RenderViewport* viewport, uint64_t* random)
+{
+    static const double anchors[][2] = {
+        {-0.743643887037151,  0.131825904205330},
+        {-0.1011,             0.9563},
+        {-1.25066,            0.02012},
+        { 0.3245046418497685, 0.04855101129280834},
+        {-0.75,               0.0},
+    };
+    const int number_of_anchors = sizeof(anchors) / sizeof(anchors[0]);
+
+    *random = *random * 6364136223846793005ull + 1442695040888963407ull;
+    const int anchor = (int)((*random >> 33) % number_of_anchors);
+    const double zoom = pow(10.0, (double)((*random >> 13) % 1000) / 1000 * 3);
+
+    setDefaultRenderViewport(viewport, 128, 128);
+    viewport->center_x   = anchors[anchor][0];
+    viewport->center_y   = anchors[anchor][1];
+    viewport->view_width = DEFAULT_WIDTH / zoom;
+    viewport->layout     = FIELD_LAYOUT_ROWS;
+}
+
+
+static void setThumbnailView(MandelbrotData* data, const RenderViewport* viewport)
+{
+    data->center_x       = viewport->center_x;
+    data->center_y       = viewport->center_y;
+    data->width          = viewport->view_width;
+    data->height         = viewport->view_width * viewport->height / viewport->width;
+    data->zoom           = DEFAULT_WIDTH / viewport->view_width;
+    data->max_iterations = viewport->max_iterations;
+}
+
+
+// -1, если счётчики процессора недоступны, например, в виртуальной машине
+static int openTlbMissCounter()
+{
+    struct perf_event_attr attributes = {};
+    attributes.size           = sizeof(attributes);
+    attributes.type           = PERF_TYPE_HW_CACHE;
+    attributes.config         = PERF_COUNT_HW_CACHE_DTLB
+                              | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                              | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attributes.disabled       = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv     = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+
+static long minorPageFaults()
+{
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_minflt;
+}
+
+
+static long anonHugePagesKb()
+{
+    FILE* smaps = fopen("/proc/self/smaps_rollup", "r");
+    if (!smaps)
+    {
+        return 0;
+    }
+
+    char line[256] = {};
+    long kb = 0;
+    while (fgets(line, sizeof(line), smaps))
+    {
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+        {
+            break;
+        }
+    }
+    fclose(smaps);
+
+    return kb;
+}
+
+
+static bool sameAsDirectRender(const FieldBuffer* buffer)
+{
+    const IterationField* field = &buffer->field;
+
+    MandelbrotData data = {};
+    if (setDefaultMandelbrot(&data)
+     || setMandelbrotField(&data, field->width, field->height, field->format, field->layout))
+    {
+        return false;
+    }
+
+    data.center_x       = buffer->viewport.center_x;
+    data.center_y       = buffer->viewport.center_y;
+    data.width          = buffer->viewport.view_width;
+    data.height         = buffer->viewport.view_width * field->height / field->width;
+    data.max_iterations = buffer->viewport.max_iterations;
+
+    calculateFormulaIterationFieldIntrinsics(&data);
+
+    bool same = !memcmp(data.field.data, field->data, field->bytes);
+    freeMandelbrot(&data);
+
+    return same;
+}
+
+
+static DetachedTask awaitEngineImage(MandelbrotEngine* engine,
+                                     RenderViewport viewport,
+                                     std::atomic<int>* valid_pixels)
+{
+    ImageBuffer image = co_await engine->imageAwaitable(viewport);
+
+    int valid = image.valid() && image.width == viewport.width;
+    valid_pixels->store(valid);
+}
@@ -0,0 +1,750 @@
+#include "mandelbrot_buddhabrot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <immintrin.h>
+
+#include <SDL3/SDL.h>
+
+#include "mandelbrot_formula.h"
+#include "mandelbrot_utils.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+const int BUDDHABROT_LANES       = 4;
+const int BUDDHABROT_MERGE_ROWS  = 16;
+
+typedef struct BuddhabrotView
+{
+    double left;
+    double top;
+    double pixels_per_unit_x;
+    double pixels_per_unit_y;
+    int    width;
+    int    height;
+} BuddhabrotView;
+
+// счётчики потока, каждый на своей строке кэша
+typedef struct alignas(64) SamplerCounters
+{
+    uint64_t samples;
+    uint64_t rejected_interior;
+    uint64_t orbits;
+    uint64_t orbit_points;
+} SamplerCounters;
+
+// до 4 орбит, которые ждут отрисовки
+typedef struct OrbitBatch
+{
+    alignas(32) double cx[BUDDHABROT_LANES];
+    alignas(32) double cy[BUDDHABROT_LANES];
+    alignas(32) double length[BUDDHABROT_LANES];
+    alignas(32) double weight[BUDDHABROT_LANES];
+    int count;
+} OrbitBatch;
+
+typedef struct SamplerContext
+{
+    Buddhabrot*             buddhabrot;
+    const BuddhabrotConfig* config;
+    BuddhabrotView          view;
+    int                     tasks;
+    SamplerCounters*        counters;
+} SamplerContext;
+
+typedef struct SamplerState
+{
+    SamplerContext*  context;
+    float*           histogram;
+    SamplerCounters* counters;
+    OrbitBatch       batch;
+    uint64_t         random;
+    uint64_t         samples_left;
+} SamplerState;
+
+static BuddhabrotView makeView(const Buddhabrot* buddhabrot, const BuddhabrotConfig* config);
+
+static void runSamplerTask(void* context, int index);
+static void runImportanceTask(void* context, int index);
+static void runMergeTask(void* context, int index);
+
+static bool nextSample(SamplerState* state, double* cx, double* cy, double* weight);
+static void queueOrbit(SamplerState* state, double cx, double cy, int length, double weight);
+static void plotOrbits(SamplerState* state);
+static int  countViewHits(const SamplerContext* context, double cx, double cy);
+
+static uint64_t nextRandom(uint64_t* state);
+static double   nextUniform(uint64_t* state);
+
+
+// public ----------------------------------------------------------------------
+
+
+void setDefaultBuddhabrotConfig(BuddhabrotConfig* config, BuddhabrotMode mode)
+{
+    assert(config != NULL);
+
+    memset(config, 0, sizeof(*config));
+
+    config->mode           = mode;
+    config->center_x       = -0.5;
+    config->center_y       = 0.0;
+    config->view_width     = 3.0;
+    config->view_height    = 3.0;
+    config->min_iterations = 0;
+    config->max_iterations = (mode == BUDDHABROT_ANTI) ? BUDDHABROT_DEFAULT_ANTI_ITERATIONS
+                                                       : BUDDHABROT_DEFAULT_ITERATIONS;
+    config->samples        = (mode == BUDDHABROT_ANTI) ? BUDDHABROT_DEFAULT_ANTI_SAMPLES
+                                                       : BUDDHABROT_DEFAULT_SAMPLES;
+    config->seed           = 1;
+}
+
+
+int createBuddhabrot(Buddhabrot* buddhabrot, int width, int height, int threads)
+{
+    assert(buddhabrot != NULL);
+    assert(width  > 0);
+    assert(height > 0);
+
+    memset(buddhabrot, 0, sizeof(*buddhabrot));
+
+    buddhabrot->width   = width;
+    buddhabrot->height  = height;
+    buddhabrot->threads = threads > 0 ? threads : 1;
+    buddhabrot->cells   = BUDDHABROT_IMPORTANCE_GRID * BUDDHABROT_IMPORTANCE_GRID / 2;
+
+    const size_t pixels = (size_t)width * height;
+
+    buddhabrot->histogram         = (float*)calloc(pixels, sizeof(float));
+    buddhabrot->thread_histograms = (float**)calloc(buddhabrot->threads, sizeof(float*));
+    buddhabrot->cell_cdf          = (double*)calloc(buddhabrot->cells, sizeof(double));
+
+    bool allocated = buddhabrot->histogram && buddhabrot->thread_histograms && buddhabrot->cell_cdf;
+    for (int i = 0; allocated && i < buddhabrot->threads; i++)
+    {
+        // заполняет сам поток, так что страницы окажутся рядом с ним
+        buddhabrot->thread_histograms[i] = (float*)malloc(pixels * sizeof(float));
+        allocated = buddhabrot->thread_histograms[i] != NULL;
+    }
+
+    if (!allocated)
+    {
+        fprintf(stderr, "Error while allocating memory for buddhabrot\n");
+        destroyBuddhabrot(buddhabrot);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+void destroyBuddhabrot(Buddhabrot* buddhabrot)
+{
+    assert(buddhabrot != NULL);
+
+    if (buddhabrot->thread_histograms)
+    {
+        for (int i = 0; i < buddhabrot->threads; i++)
+        {
+            free(buddhabrot->thread_histograms[i]);
+        }
+    }
+
+    free(buddhabrot->thread_histograms);
+    free(buddhabrot->histogram);
+    free(buddhabrot->cell_cdf);
+
+    memset(buddhabrot, 0, sizeof(*buddhabrot));
+}
+
+
+void renderBuddhabrot(Buddhabrot* buddhabrot,
+                      const BuddhabrotConfig* config,
+                      ThreadPool* pool,
+                      BuddhabrotStatistics* stats)
+{
+    assert(buddhabrot != NULL);
+    assert(config     != NULL);
+    assert(stats      != NULL);
+    assert(threadPoolSize(pool) <= buddhabrot->threads);
+
+    memset(stats, 0, sizeof(*stats));
+
+    const uint64_t start = SDL_GetPerformanceCounter();
+
+    SamplerContext context = {};
+    context.buddhabrot = buddhabrot;
+    context.config     = config;
+    context.view       = makeView(buddhabrot, config);
+    context.tasks      = threadPoolSize(pool);
+    context.counters   = (SamplerCounters*)aligned_alloc(64, sizeof(SamplerCounters) * context.tasks);
+    assert(context.counters != NULL);
+
+    if (config->importance_sampling)
+    {
+        runParallel(pool, BUDDHABROT_IMPORTANCE_GRID / 2, runImportanceTask, &context);
+
+        double total = 0;
+        for (int cell = 0; cell < buddhabrot->cells; cell++)
+        {
+            total += buddhabrot->cell_cdf[cell];
+        }
+
+        // смесь с равномерной выборкой, чтобы ни одна ячейка не получила
+        // нулевую вероятность и картинка осталась несмещённой
+        const double share = (total > 0) ? BUDDHABROT_UNIFORM_SHARE : 1.0;
+        double sum = 0;
+        for (int cell = 0; cell < buddhabrot->cells; cell++)
+        {
+            double hits = (total > 0) ? buddhabrot->cell_cdf[cell] / total : 0;
+            sum += (1.0 - share) * hits + share / buddhabrot->cells;
+            buddhabrot->cell_cdf[cell] = sum;
+        }
+        buddhabrot->cell_cdf[buddhabrot->cells - 1] = 1.0;
+
+        stats->importance_ms = elapsedMs(start);
+    }
+
+    runParallel(pool, context.tasks, runSamplerTask, &context);
+
+    const int blocks = (buddhabrot->height + BUDDHABROT_MERGE_ROWS - 1) / BUDDHABROT_MERGE_ROWS;
+    runParallel(pool, blocks, runMergeTask, &context);
+
+    const size_t pixels = (size_t)buddhabrot->width * buddhabrot->height;
+    buddhabrot->max_density = 0;
+    for (size_t i = 0; i < pixels; i++)
+    {
+        if (buddhabrot->histogram[i] > buddhabrot->max_density)
+        {
+            buddhabrot->max_density = buddhabrot->histogram[i];
+        }
+    }
+
+    for (int i = 0; i < context.tasks; i++)
+    {
+        stats->samples           += context.counters[i].samples;
+        stats->rejected_interior += context.counters[i].rejected_interior;
+        stats->orbits            += context.counters[i].orbits;
+        stats->orbit_points      += context.counters[i].orbit_points;
+    }
+    free(context.counters);
+
+    stats->threads = context.tasks;
+    stats->ms      = elapsedMs(start);
+    stats->samples_per_second = (stats->ms > 0) ? stats->samples * 1000.0 / stats->ms : 0;
+}
+
+
+// корень сжимает яркие пиксели у множества, иначе видно только их
+void colorizeBuddhabrot(int pitch, uint32_t* pixels, const Buddhabrot* buddhabrot)
+{
+    assert(pixels     != NULL);
+    assert(buddhabrot != NULL);
+
+    const int   pitch_u32 = pitch / sizeof(uint32_t);
+    const float scale     = (buddhabrot->max_density > 0) ? 1.0f / buddhabrot->max_density : 0;
+
+    for (int y = 0; y < buddhabrot->height; y++)
+    {
+        const float* row = buddhabrot->histogram + (size_t)y * buddhabrot->width;
+        uint32_t* pixel_row = pixels + (size_t)y * pitch_u32;
+
+        for (int x = 0; x < buddhabrot->width; x++)
+        {
+            uint32_t value = (uint32_t)(sqrtf(row[x] * scale) * 255.0f);
+            pixel_row[x] = 0xFF000000 | value * 0x010101;
+        }
+    }
+}
+
+
+void printBuddhabrotStatistics(FILE* file, const BuddhabrotStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    fprintf(file,
+            "buddhabrot %.2f ms (importance %.2f ms), %d threads, %.3f Msamples/s, "
+            "samples %lu, interior %lu (%.1f%%), orbits %lu, orbit points %lu\n",
+            stats->ms,
+            stats->importance_ms,
+            stats->threads,
+            stats->samples_per_second / 1e6,
+            stats->samples,
+            stats->rejected_interior,
+            stats->samples ? 100.0 * stats->rejected_interior / stats->samples : 0,
+            stats->orbits,
+            stats->orbit_points);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static BuddhabrotView makeView(const Buddhabrot* buddhabrot, const BuddhabrotConfig* config)
+{
+    assert(buddhabrot != NULL);
+    assert(config     != NULL);
+
+    BuddhabrotView view = {};
+    view.left              = config->center_x - config->view_width / 2;
+    view.top               = config->center_y + config->view_height / 2;
+    view.pixels_per_unit_x = buddhabrot->width  / config->view_width;
+    view.pixels_per_unit_y = buddhabrot->height / config->view_height;
+    view.width             = buddhabrot->width;
+    view.height            = buddhabrot->height;
+
+    return view;
+}
+
+
+static void runSamplerTask(void* context, int index)
+{
+    assert(context != NULL);
+
+    SamplerContext* sampler = (SamplerContext*)context;
+    const BuddhabrotConfig* config = sampler->config;
+    const bool anti = (config->mode == BUDDHABROT_ANTI);
+
+    SamplerState state = {};
+    state.context   = sampler;
+    state.histogram = sampler->buddhabrot->thread_histograms[index];
+    state.counters  = &sampler->counters[index];
+    state.random    = (config->seed + 1) * 0x9E3779B97F4A7C15ull ^ (uint64_t)(index + 1) * 0xBF58476D1CE4E5B9ull;
+    state.random   += (state.random == 0);
+    state.samples_left = config->samples / sampler->tasks
+                       + ((uint64_t)index < config->samples % sampler->tasks);
+
+    memset(state.counters, 0, sizeof(*state.counters));
+    memset(state.histogram, 0, sizeof(float) * sampler->view.width * sampler->view.height);
+
+    alignas(32) double lane_cx[BUDDHABROT_LANES]     = {};
+    alignas(32) double lane_cy[BUDDHABROT_LANES]     = {};
+    alignas(32) double lane_x[BUDDHABROT_LANES]      = {};
+    alignas(32) double lane_y[BUDDHABROT_LANES]      = {};
+    alignas(32) double lane_n[BUDDHABROT_LANES]      = {};
+    alignas(32) double lane_weight[BUDDHABROT_LANES] = {};
+    alignas(32) double lane_active[BUDDHABROT_LANES] = {};
+
+    const __m256d radius2  = _mm256_set1_pd(4.0);
+    const __m256d max_iter = _mm256_set1_pd(config->max_iterations);
+    const __m256d one      = _mm256_set1_pd(1.0);
+
+    int active = 0;
+    for (int lane = 0; lane < BUDDHABROT_LANES; lane++)
+    {
+        if (nextSample(&state, &lane_cx[lane], &lane_cy[lane], &lane_weight[lane]))
+        {
+            lane_active[lane] = 1;
+            active++;
+        }
+    }
+
+    while (active > 0)
+    {
+        __m256d cx = _mm256_load_pd(lane_cx);
+        __m256d cy = _mm256_load_pd(lane_cy);
+        __m256d x  = _mm256_load_pd(lane_x);
+        __m256d y  = _mm256_load_pd(lane_y);
+        __m256d n  = _mm256_load_pd(lane_n);
+        __m256d is_active = _mm256_cmp_pd(_mm256_load_pd(lane_active), one, _CMP_EQ_OQ);
+
+        // пустые дорожки стоят в c = 0 и никогда не заканчиваются
+        int finished = 0;
+        while (true)
+        {
+            __m256d x2 = _mm256_mul_pd(x, x);
+            __m256d y2 = _mm256_mul_pd(y, y);
+
+            __m256d escaped = _mm256_cmp_pd(_mm256_add_pd(x2, y2), radius2, _CMP_GT_OQ);
+            __m256d done    = _mm256_and_pd(is_active,
+                                            _mm256_or_pd(escaped, _mm256_cmp_pd(n, max_iter, _CMP_GE_OQ)));
+
+            finished = _mm256_movemask_pd(done);
+            if (finished)
+            {
+                break;
+            }
+
+            MandelbrotFormula::step(&x, &y, x2, y2, cx, cy);
+            n = _mm256_add_pd(n, one);
+        }
+
+        _mm256_store_pd(lane_x, x);
+        _mm256_store_pd(lane_y, y);
+        _mm256_store_pd(lane_n, n);
+
+        for (int lane = 0; lane < BUDDHABROT_LANES; lane++)
+        {
+            if (!(finished & (1 << lane)))
+            {
+                continue;
+            }
+
+            const int  length  = (int)lane_n[lane];
+            const bool escaped = lane_x[lane] * lane_x[lane] + lane_y[lane] * lane_y[lane] > 4.0;
+
+            if (escaped && !anti && length >= config->min_iterations)
+            {
+                queueOrbit(&state, lane_cx[lane], lane_cy[lane], length, lane_weight[lane]);
+            }
+            else if (!escaped && anti)
+            {
+                queueOrbit(&state, lane_cx[lane], lane_cy[lane], length, lane_weight[lane]);
+            }
+
+            lane_x[lane] = 0;
+            lane_y[lane] = 0;
+            lane_n[lane] = 0;
+            if (!nextSample(&state, &lane_cx[lane], &lane_cy[lane], &lane_weight[lane]))
+            {
+                lane_cx[lane]     = 0;
+                lane_cy[lane]     = 0;
+                lane_active[lane] = 0;
+                active--;
+            }
+        }
+    }
+
+    plotOrbits(&state);
+}
+
+
+// ячейки строки row сетки выборки: сколько точек пробных орбит попало в вид
+static void runImportanceTask(void* context, int row)
+{
+    assert(context != NULL);
+
+    SamplerContext* sampler = (SamplerContext*)context;
+    double* scores = sampler->buddhabrot->cell_cdf + (size_t)row * BUDDHABROT_IMPORTANCE_GRID;
+
+    const double cell_size = 2 * BUDDHABROT_SAMPLE_RADIUS / BUDDHABROT_IMPORTANCE_GRID;
+    uint64_t random = (sampler->config->seed + 1) * 0xD1B54A32D192ED03ull ^ (uint64_t)(row + 1);
+    random += (random == 0);
+
+    for (int column = 0; column < BUDDHABROT_IMPORTANCE_GRID; column++)
+    {
+        int hits = 0;
+        for (int probe = 0; probe < BUDDHABROT_IMPORTANCE_PROBES; probe++)
+        {
+            double cx = -BUDDHABROT_SAMPLE_RADIUS + (column + nextUniform(&random)) * cell_size;
+            double cy = (row + nextUniform(&random)) * cell_size;
+
+            hits += countViewHits(sampler, cx, cy);
+        }
+        scores[column] = hits;
+    }
+}
+
+
+static void runMergeTask(void* context, int block)
+{
+    assert(context != NULL);
+
+    SamplerContext* sampler = (SamplerContext*)context;
+    Buddhabrot* buddhabrot  = sampler->buddhabrot;
+
+    const int y_begin = block * BUDDHABROT_MERGE_ROWS;
+    int y_end = y_begin + BUDDHABROT_MERGE_ROWS;
+    if (y_end > buddhabrot->height)
+    {
+        y_end = buddhabrot->height;
+    }
+
+    const size_t begin = (size_t)y_begin * buddhabrot->width;
+    const size_t end   = (size_t)y_end   * buddhabrot->width;
+
+    memcpy(buddhabrot->histogram + begin, buddhabrot->thread_histograms[0] + begin,
+           (end - begin) * sizeof(float));
+
+    for (int thread = 1; thread < sampler->tasks; thread++)
+    {
+        const float* source = buddhabrot->thread_histograms[thread];
+        for (size_t i = begin; i < end; i++)
+        {
+            buddhabrot->histogram[i] += source[i];
+        }
+    }
+}
+
+
+// false, когда выборки потока кончились; точки внутри кардиоиды и круга
+// отбрасываются, а для анти-Будда-брота сразу рисуются
+static bool nextSample(SamplerState* state, double* cx, double* cy, double* weight)
+{
+    assert(state  != NULL);
+    assert(cx     != NULL);
+    assert(cy     != NULL);
+    assert(weight != NULL);
+
+    const Buddhabrot*       buddhabrot = state->context->buddhabrot;
+    const BuddhabrotConfig* config     = state->context->config;
+
+    const double cell_size = 2 * BUDDHABROT_SAMPLE_RADIUS / BUDDHABROT_IMPORTANCE_GRID;
+
+    while (state->samples_left > 0)
+    {
+        state->samples_left--;
+        state->counters->samples++;
+
+        if (config->importance_sampling)
+        {
+            double target = nextUniform(&state->random);
+
+            int low  = 0;
+            int high = buddhabrot->cells - 1;
+            while (low < high)
+            {
+                int middle = (low + high) / 2;
+                if (buddhabrot->cell_cdf[middle] > target)
+                {
+                    high = middle;
+                }
+                else
+                {
+                    low = middle + 1;
+                }
+            }
+
+            double probability = buddhabrot->cell_cdf[low] - (low > 0 ? buddhabrot->cell_cdf[low - 1] : 0);
+
+            *cx = -BUDDHABROT_SAMPLE_RADIUS
+                + (low % BUDDHABROT_IMPORTANCE_GRID + nextUniform(&state->random)) * cell_size;
+            *cy = (low / BUDDHABROT_IMPORTANCE_GRID + nextUniform(&state->random)) * cell_size;
+            *weight = 1.0 / (buddhabrot->cells * probability);
+        }
+        else
+        {
+            *cx = BUDDHABROT_SAMPLE_RADIUS * (2 * nextUniform(&state->random) - 1);
+            *cy = BUDDHABROT_SAMPLE_RADIUS * nextUniform(&state->random);
+            *weight = 1.0;
+        }
+
+        if (MandelbrotFormula::isInterior(*cx, *cy))
+        {
+            state->counters->rejected_interior++;
+            if (config->mode == BUDDHABROT_ANTI)
+            {
+                queueOrbit(state, *cx, *cy, config->max_iterations, *weight);
+            }
+            continue;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+
+static void queueOrbit(SamplerState* state, double cx, double cy, int length, double weight)
+{
+    assert(state != NULL);
+
+    OrbitBatch* batch = &state->batch;
+
+    batch->cx[batch->count]     = cx;
+    batch->cy[batch->count]     = cy;
+    batch->length[batch->count] = length;
+    batch->weight[batch->count] = weight;
+    batch->count++;
+
+    state->counters->orbits++;
+    state->counters->orbit_points += length;
+
+    if (batch->count == BUDDHABROT_LANES)
+    {
+        plotOrbits(state);
+    }
+}
+
+
+// орбиты пачки повторяются заново в AVX2, номера пикселей считаются
+// в регистре, а прибавляются в гистограмму по одному
+static void plotOrbits(SamplerState* state)
+{
+    assert(state != NULL);
+
+    OrbitBatch* batch = &state->batch;
+    if (batch->count == 0)
+    {
+        return;
+    }
+
+    for (int lane = batch->count; lane < BUDDHABROT_LANES; lane++)
+    {
+        batch->cx[lane]     = 0;
+        batch->cy[lane]     = 0;
+        batch->length[lane] = 0;
+        batch->weight[lane] = 0;
+    }
+
+    const BuddhabrotView* view = &state->context->view;
+    float* histogram = state->histogram;
+
+    double max_length = 0;
+    for (int lane = 0; lane < batch->count; lane++)
+    {
+        if (batch->length[lane] > max_length)
+        {
+            max_length = batch->length[lane];
+        }
+    }
+
+    const __m256d cx      = _mm256_load_pd(batch->cx);
+    const __m256d cy      = _mm256_load_pd(batch->cy);
+    const __m256d length  = _mm256_load_pd(batch->length);
+    const __m256d left    = _mm256_set1_pd(view->left);
+    const __m256d top     = _mm256_set1_pd(view->top);
+    const __m256d scale_x = _mm256_set1_pd(view->pixels_per_unit_x);
+    const __m256d scale_y = _mm256_set1_pd(view->pixels_per_unit_y);
+    const __m256d width   = _mm256_set1_pd(view->width);
+    const __m256d height  = _mm256_set1_pd(view->height);
+    const __m256d zero    = _mm256_setzero_pd();
+    const __m256d one     = _mm256_set1_pd(1.0);
+
+    alignas(16) int32_t indices[BUDDHABROT_LANES];
+    alignas(16) int32_t mirrored[BUDDHABROT_LANES];
+
+    __m256d x = zero;
+    __m256d y = zero;
+    __m256d n = zero;
+    for (int step = 0; step < (int)max_length; step++)
+    {
+        MandelbrotFormula::step(&x, &y, _mm256_mul_pd(x, x), _mm256_mul_pd(y, y), cx, cy);
+
+        __m256d alive = _mm256_cmp_pd(n, length, _CMP_LT_OQ);
+        n = _mm256_add_pd(n, one);
+
+        __m256d px = _mm256_mul_pd(_mm256_sub_pd(x, left), scale_x);
+        __m256d py = _mm256_mul_pd(_mm256_sub_pd(top, y), scale_y);
+        __m256d my = _mm256_mul_pd(_mm256_add_pd(top, y), scale_y);
+
+        __m256d in_x = _mm256_and_pd(_mm256_cmp_pd(px, zero, _CMP_GE_OQ),
+                                     _mm256_cmp_pd(px, width, _CMP_LT_OQ));
+        in_x = _mm256_and_pd(in_x, alive);
+
+        __m256d in_y = _mm256_and_pd(_mm256_cmp_pd(py, zero, _CMP_GE_OQ),
+                                     _mm256_cmp_pd(py, height, _CMP_LT_OQ));
+        __m256d in_m = _mm256_and_pd(_mm256_cmp_pd(my, zero, _CMP_GE_OQ),
+                                     _mm256_cmp_pd(my, height, _CMP_LT_OQ));
+
+        int mask        = _mm256_movemask_pd(_mm256_and_pd(in_x, in_y));
+        int mirror_mask = _mm256_movemask_pd(_mm256_and_pd(in_x, in_m));
+        if (!(mask | mirror_mask))
+        {
+            continue;
+        }
+
+        __m256d column = _mm256_floor_pd(px);
+        _mm_store_si128((__m128i*)indices,
+                        _mm256_cvttpd_epi32(_mm256_fmadd_pd(_mm256_floor_pd(py), width, column)));
+        _mm_store_si128((__m128i*)mirrored,
+                        _mm256_cvttpd_epi32(_mm256_fmadd_pd(_mm256_floor_pd(my), width, column)));
+
+        for (int lane = 0; lane < BUDDHABROT_LANES; lane++)
+        {
+            if (mask & (1 << lane))
+            {
+                histogram[indices[lane]] += (float)batch->weight[lane];
+            }
+            if (mirror_mask & (1 << lane))
+            {
+                histogram[mirrored[lane]] += (float)batch->weight[lane];
+            }
+        }
+    }
+
+    batch->count = 0;
+}
+
+
+// то же, что делает один поток для одной точки, но без гистограммы:
+// сколько точек орбиты c попадёт в вид вместе с отражением
+static int countViewHits(const SamplerContext* context, double cx, double cy)
+{
+    assert(context != NULL);
+
+    const BuddhabrotConfig* config = context->config;
+    const BuddhabrotView*   view   = &context->view;
+
+    const bool interior = MandelbrotFormula::isInterior(cx, cy);
+    if (interior && config->mode == BUDDHABROT_ESCAPING)
+    {
+        return 0;
+    }
+
+    int length = config->max_iterations;
+    bool escaped = false;
+    if (!interior)
+    {
+        double x = 0;
+        double y = 0;
+        int n = 0;
+        for (; n < config->max_iterations; n++)
+        {
+            double x2 = x * x;
+            double y2 = y * y;
+            if (x2 + y2 > 4.0)
+            {
+                escaped = true;
+                break;
+            }
+            MandelbrotFormula::step(&x, &y, x2, y2, cx, cy);
+        }
+        length = n;
+    }
+
+    if (escaped == (config->mode == BUDDHABROT_ANTI)
+     || (escaped && length < config->min_iterations))
+    {
+        return 0;
+    }
+
+    int hits = 0;
+    double x = 0;
+    double y = 0;
+    for (int n = 0; n < length; n++)
+    {
+        MandelbrotFormula::step(&x, &y, x * x, y * y, cx, cy);
+
+        double px = (x - view->left) * view->pixels_per_unit_x;
+        if (px < 0 || px >= view->width)
+        {
+            continue;
+        }
+
+        double py = (view->top - y) * view->pixels_per_unit_y;
+        double my = (view->top + y) * view->pixels_per_unit_y;
+        hits += (py >= 0 && py < view->height) + (my >= 0 && my < view->height);
+    }
+
+    return hits;
+}
+
+
+// xorshift64*
+static uint64_t nextRandom(uint64_t* state)
+{
+    assert(state != NULL);
+
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+
+// [0, 1) из старших 53 бит
+static double nextUniform(uint64_t* state)
+{
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,333 @@
+#include "mandelbrot_colorize.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include <assert.h>
+
+#include "mandelbrot_utils.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+typedef struct EqualizeContext
+{
+    int             pitch;
+    uint32_t*       pixels;
+    MandelbrotData* data;
+    ColorHistogram* histogram;
+    int             units;
+} EqualizeContext;
+
+static int       fieldUnitCount(const IterationField* field);
+static FieldRect fieldUnitRect(const IterationField* field, int unit);
+static void      countIterationsTask(void* context, int index);
+static void      mapColorsTask(void* context, int index);
+static int       reserveColorHistogram(ColorHistogram* histogram, int bins);
+static void      buildColorLookup(ColorHistogram* histogram, const MandelbrotData* data);
+
+
+// public ----------------------------------------------------------------------
+
+
+void colorizeIterationField(int pitch, uint32_t* pixels, MandelbrotData* data)
+{
+    assert(data   != NULL);
+    assert(pixels != NULL);
+
+    const IterationField* field = &data->field;
+
+    if (field->layout == FIELD_LAYOUT_ROWS)
+    {
+        colorizeIterationRect(pitch, pixels, data, fieldRect(field));
+        return;
+    }
+
+    // плиточное поле читаем в порядке хранения
+    const int tiles = fieldTileCount(field);
+    for (int slot = 0; slot < tiles; slot++)
+    {
+        colorizeIterationRect(pitch, pixels, data, fieldTileRect(field, slot));
+    }
+}
+
+
+void colorizeIterationRect(int pitch, uint32_t* pixels, MandelbrotData* data, FieldRect rect)
+{
+    assert(data   != NULL);
+    assert(pixels != NULL);
+    assert((uintptr_t)pixels % 32 == 0 && "pixels must be 32-byte aligned");
+    assert((uintptr_t)data->colors % 32 == 0 && "color palette must be 32-byte aligned");
+    assert((uintptr_t)data->field.data % 32 == 0 && "iterations field must be 32-byte aligned");
+    assert(rect.x % 8 == 0 && rect.width % 8 == 0);
+
+    int pitch_u32 = pitch / sizeof(uint32_t);
+    const IterationField* field = &data->field;
+    const __m256i max_iterations = _mm256_set1_epi32(data->max_iterations);
+
+    for (int y = rect.y; y < rect.y + rect.height; y++)
+    {
+        // строка прямоугольника не пересекает границу плитки и лежит подряд
+        const size_t row_index = fieldIndex(field, rect.x, y);
+
+        for (int x = 0; x < rect.width; x += 8)
+        {
+            __m256i iterations = fieldLoad8At(field, row_index + x);
+
+            // точки, не вышедшие за max_iterations, всегда красим нулевым цветом
+            __m256i interior = _mm256_cmpeq_epi32(iterations, max_iterations);
+            __m256i indices = _mm256_andnot_si256(
+                interior,
+                _mm256_and_si256(iterations, _mm256_set1_epi32(MAX_ITERATIONS - 1))
+            );
+            __m256i colors = _mm256_i32gather_epi32(
+                (const int*)data->colors,
+                indices,
+                sizeof(uint32_t)
+            );
+
+            _mm256_store_si256(
+                (__m256i*)(pixels + y * pitch_u32 + rect.x + x),
+                colors
+            );
+        }
+    }
+}
+
+
+int createColorHistogram(ColorHistogram* histogram, ThreadPool* pool)
+{
+    assert(histogram != NULL);
+
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->pool  = pool;
+    histogram->tasks = threadPoolSize(pool) * COLOR_HISTOGRAM_TASKS_PER_THREAD;
+
+    return reserveColorHistogram(histogram, MAX_ITERATIONS + 1);
+}
+
+
+void destroyColorHistogram(ColorHistogram* histogram)
+{
+    assert(histogram != NULL);
+
+    free(histogram->bins);
+    free(histogram->lookup);
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+
+int colorizeEqualizedIterationField(int pitch,
+                                    uint32_t* pixels,
+                                    MandelbrotData* data,
+                                    ColorHistogram* histogram)
+{
+    assert(data      != NULL);
+    assert(pixels    != NULL);
+    assert(histogram != NULL);
+    assert((uintptr_t)pixels % 32 == 0 && "pixels must be 32-byte aligned");
+    assert(data->field.width % 8 == 0);
+
+    if (reserveColorHistogram(histogram, data->max_iterations + 1))
+    {
+        return 1;
+    }
+
+    EqualizeContext context = {
+        .pitch     = pitch,
+        .pixels    = pixels,
+        .data      = data,
+        .histogram = histogram,
+        .units     = fieldUnitCount(&data->field),
+    };
+
+    runParallel(histogram->pool, histogram->tasks, countIterationsTask, &context);
+    buildColorLookup(histogram, data);
+    runParallel(histogram->pool, histogram->tasks, mapColorsTask, &context);
+
+    return 0;
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+// строки построчного поля или плитки в порядке хранения: задача берёт
+// подряд идущий кусок памяти
+static int fieldUnitCount(const IterationField* field)
+{
+    assert(field != NULL);
+
+    return (field->layout == FIELD_LAYOUT_ROWS) ? field->height : fieldTileCount(field);
+}
+
+
+static FieldRect fieldUnitRect(const IterationField* field, int unit)
+{
+    assert(field != NULL);
+
+    if (field->layout == FIELD_LAYOUT_ROWS)
+    {
+        FieldRect rect = {0, unit, field->width, 1};
+        return rect;
+    }
+
+    return fieldTileRect(field, unit);
+}
+
+
+static void countIterationsTask(void* context, int index)
+{
+    assert(context != NULL);
+
+    const EqualizeContext* equalize = (const EqualizeContext*)context;
+    const ColorHistogram*  histogram = equalize->histogram;
+    const IterationField*  field = &equalize->data->field;
+
+    uint32_t* bins = histogram->bins + (size_t)index * COLOR_HISTOGRAM_COPIES * histogram->capacity;
+    memset(bins, 0, COLOR_HISTOGRAM_COPIES * histogram->capacity * sizeof(uint32_t));
+
+    const __m256i max_iterations = _mm256_set1_epi32(equalize->data->max_iterations);
+    const int first = (int)((int64_t)equalize->units * index / histogram->tasks);
+    const int last  = (int)((int64_t)equalize->units * (index + 1) / histogram->tasks);
+
+    alignas(32) int lanes[8] = {};
+    for (int unit = first; unit < last; unit++)
+    {
+        const FieldRect rect = fieldUnitRect(field, unit);
+        for (int y = rect.y; y < rect.y + rect.height; y++)
+        {
+            const size_t row_index = fieldIndex(field, rect.x, y);
+            for (int x = 0; x < rect.width; x += 8)
+            {
+                // старое поле после уменьшения max_iterations не выйдет за бины
+                __m256i iterations = _mm256_min_epi32(fieldLoad8At(field, row_index + x), max_iterations);
+                _mm256_store_si256((__m256i*)lanes, iterations);
+
+                // внутри множества и у гладких полос все восемь одинаковы
+                __m256i first_lane = _mm256_set1_epi32(lanes[0]);
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(iterations, first_lane)) == -1)
+                {
+                    bins[lanes[0]] += 8;
+                    continue;
+                }
+
+                // соседние точки часто в одном бине: копии разрывают
+                // зависимость каждого инкремента от предыдущего
+                for (int lane = 0; lane < 8; lane++)
+                {
+                    bins[(lane % COLOR_HISTOGRAM_COPIES) * histogram->capacity + lanes[lane]]++;
+                }
+            }
+        }
+    }
+}
+
+
+static void mapColorsTask(void* context, int index)
+{
+    assert(context != NULL);
+
+    const EqualizeContext* equalize = (const EqualizeContext*)context;
+    const ColorHistogram*  histogram = equalize->histogram;
+    const IterationField*  field = &equalize->data->field;
+
+    const int pitch_u32 = equalize->pitch / sizeof(uint32_t);
+    const __m256i max_iterations = _mm256_set1_epi32(equalize->data->max_iterations);
+    const int first = (int)((int64_t)equalize->units * index / histogram->tasks);
+    const int last  = (int)((int64_t)equalize->units * (index + 1) / histogram->tasks);
+
+    for (int unit = first; unit < last; unit++)
+    {
+        const FieldRect rect = fieldUnitRect(field, unit);
+        for (int y = rect.y; y < rect.y + rect.height; y++)
+        {
+            const size_t row_index = fieldIndex(field, rect.x, y);
+            uint32_t* row = equalize->pixels + y * pitch_u32 + rect.x;
+
+            for (int x = 0; x < rect.width; x += 8)
+            {
+                __m256i iterations = _mm256_min_epi32(fieldLoad8At(field, row_index + x), max_iterations);
+                __m256i colors = _mm256_i32gather_epi32(
+                    (const int*)histogram->lookup,
+                    iterations,
+                    sizeof(uint32_t)
+                );
+
+                _mm256_store_si256((__m256i*)(row + x), colors);
+            }
+        }
+    }
+}
+
+
+static int reserveColorHistogram(ColorHistogram* histogram, int bins)
+{
+    assert(histogram != NULL);
+    assert(histogram->tasks > 0);
+
+    const int capacity = (bins + 7) / 8 * 8;
+    if (capacity <= histogram->capacity)
+    {
+        return 0;
+    }
+
+    free(histogram->bins);
+    free(histogram->lookup);
+    histogram->bins     = (uint32_t*)aligned_alloc(32, (size_t)histogram->tasks * COLOR_HISTOGRAM_COPIES
+                                                           * capacity * sizeof(uint32_t));
+    histogram->lookup   = (uint32_t*)aligned_alloc(32, capacity * sizeof(uint32_t));
+    histogram->capacity = capacity;
+
+    if (!histogram->bins || !histogram->lookup)
+    {
+        fprintf(stderr, "Error while allocating memory for color histogram\n");
+        free(histogram->bins);
+        free(histogram->lookup);
+        histogram->bins     = NULL;
+        histogram->lookup   = NULL;
+        histogram->capacity = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// все копии бинов всех задач складываются в первую, затем префиксная сумма по
+// вышедшим точкам даёт номер цвета; внутренние точки - нулевой цвет
+static void buildColorLookup(ColorHistogram* histogram, const MandelbrotData* data)
+{
+    assert(histogram != NULL);
+    assert(data      != NULL);
+
+    uint32_t* merged = histogram->bins;
+    for (int bin = 0; bin < histogram->capacity; bin += 8)
+    {
+        __m256i sum = _mm256_load_si256((const __m256i*)(merged + bin));
+        for (int copy = 1; copy < histogram->tasks * COLOR_HISTOGRAM_COPIES; copy++)
+        {
+            const uint32_t* bins = histogram->bins + (size_t)copy * histogram->capacity;
+            sum = _mm256_add_epi32(sum, _mm256_load_si256((const __m256i*)(bins + bin)));
+        }
+        _mm256_store_si256((__m256i*)(merged + bin), sum);
+    }
+
+    const int max_iterations = data->max_iterations;
+    uint64_t escaped = 0;
+    for (int bin = 0; bin < max_iterations; bin++)
+    {
+        escaped += merged[bin];
+    }
+
+    uint64_t cumulative = 0;
+    for (int bin = 0; bin < max_iterations; bin++)
+    {
+        cumulative += merged[bin];
+        const uint64_t index = escaped ? cumulative * (MAX_ITERATIONS - 1) / escaped : 0;
+        histogram->lookup[bin] = data->colors[index];
+    }
+    histogram->lookup[max_iterations] = data->colors[0];
+}
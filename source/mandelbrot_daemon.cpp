@@ -0,0 +1,1051 @@
+#include "mandelbrot_daemon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <SDL3/SDL.h>
+
+#include "mandelbrot_utils.h"
+#include "mandelbrot_logic_formula.h"
+#include "mandelbrot_colorize.h"
+#include "mandelbrot_socket.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+typedef struct TileWaiter
+{
+    uint32_t client;
+    uint32_t request_id;
+} TileWaiter;
+
+typedef struct TileJob
+{
+    TileKey      key;
+    TilePriority priority;
+    bool         rendering;
+
+    TileWaiter*  waiters;
+    int          number_of_waiters;
+    int          waiters_capacity;
+
+    uint32_t*    pixels;
+    uint64_t     render_ns;
+
+    struct TileJob* next;   // следующий в очереди или в списке готовых
+} TileJob;
+
+// запрос может прийти, а ответ уйти по частям; в output лежат ответы,
+// которые клиент ещё не забрал
+typedef struct DaemonClient
+{
+    int      fd;
+    uint32_t id;
+
+    DaemonRequest request;
+    size_t        received;
+
+    uint8_t* output;
+    size_t   output_size;
+    size_t   output_sent;
+    size_t   output_capacity;
+
+    uint64_t progress_ns;       // последний принятый или отправленный байт
+} DaemonClient;
+
+const size_t DAEMON_TILE_RESPONSE_SIZE = sizeof(DaemonResponse) + DAEMON_TILE_PIXELS * sizeof(uint32_t);
+const size_t DAEMON_CLIENT_BACKLOG     = DAEMON_CLIENT_BACKLOG_TILES * DAEMON_TILE_RESPONSE_SIZE;
+
+// всё, кроме clients, защищено lock; с клиентами работает только поток
+// ввода-вывода, рабочие потоки передают ему готовые плитки через completed
+// и будят его записью в wake_pipe
+typedef struct Daemon
+{
+    DaemonConfig config;
+
+    std::mutex              lock;
+    std::condition_variable has_work;
+    bool                    stopping;
+
+    TileJob*  queue_head[TILE_PRIORITY_COUNT];
+    TileJob*  queue_tail[TILE_PRIORITY_COUNT];
+    int       queued;
+
+    TileJob** active;           // в очереди или считаются
+    int       number_of_active;
+    int       active_capacity;
+
+    TileJob*  completed;
+
+    TileCache        cache;
+    DaemonStatistics stats;
+
+    int wake_pipe[2];
+
+    DaemonClient clients[DAEMON_MAX_CLIENTS];
+    int          number_of_clients;
+    uint32_t     next_client_id;
+} Daemon;
+
+static void runDaemonWorker(Daemon* daemon);
+static void renderTile(MandelbrotData* data, TileJob* job);
+
+static void acceptClient(Daemon* daemon, int listen_fd);
+static int  readRequests(Daemon* daemon, DaemonClient* client);
+static int  handleRequest(Daemon* daemon, DaemonClient* client, const DaemonRequest* request);
+static int  requestTile(Daemon* daemon, DaemonClient* client, const DaemonRequest* request);
+static void cancelRequests(Daemon* daemon, uint32_t client, bool all, uint32_t request_id);
+static void deliverCompleted(Daemon* daemon);
+static void removeClient(Daemon* daemon, int index);
+static DaemonClient* findClient(Daemon* daemon, uint32_t id);
+
+static bool clientPending(const DaemonClient* client);
+static int  queueOutput(DaemonClient* client, const void* header, size_t header_size,
+                        const void* payload, size_t payload_size);
+static int  flushClient(DaemonClient* client);
+static int  queueTileResponse(DaemonClient* client, uint32_t request_id, bool cached,
+                              uint64_t render_ns, const uint32_t* pixels);
+static bool normalizeTileKey(TileKey* key);
+
+static TileJob* createJob(const TileKey* key, TilePriority priority);
+static void     destroyJob(TileJob* job);
+static int      addWaiter(TileJob* job, uint32_t client, uint32_t request_id);
+static TileJob* findActiveJob(Daemon* daemon, const TileKey* key);
+static int      addActiveJob(Daemon* daemon, TileJob* job);
+static void     removeActiveJob(Daemon* daemon, TileJob* job);
+static void     pushJob(Daemon* daemon, TileJob* job);
+static TileJob* popJob(Daemon* daemon);
+static void     unqueueJob(Daemon* daemon, TileJob* job);
+
+
+// public ----------------------------------------------------------------------
+
+
+int runMandelbrotDaemon(const DaemonConfig* config, volatile sig_atomic_t* stop)
+{
+    assert(config != NULL);
+    assert(stop   != NULL);
+
+    Daemon* daemon = new Daemon();
+    daemon->config = *config;
+    if (daemon->config.threads < 1)
+    {
+        daemon->config.threads = 1;
+    }
+
+    char socket_path[108] = "";
+    int listen_fd = createListener(config->address, socket_path);
+    if (listen_fd < 0)
+    {
+        delete daemon;
+        return 1;
+    }
+
+    if (pipe(daemon->wake_pipe)
+     || createTileCache(&daemon->cache, config->cache_tiles, DAEMON_TILE_PIXELS * sizeof(uint32_t)))
+    {
+        fprintf(stderr, "Error while starting daemon\n");
+        close(listen_fd);
+        delete daemon;
+        return 1;
+    }
+
+    std::thread* workers = new std::thread[daemon->config.threads];
+    for (int i = 0; i < daemon->config.threads; i++)
+    {
+        workers[i] = std::thread(runDaemonWorker, daemon);
+    }
+
+    printf("Daemon listens on %s with %d threads and %d cached tiles\n",
+           config->address, daemon->config.threads, config->cache_tiles);
+    fflush(stdout);
+
+    struct pollfd fds[DAEMON_MAX_CLIENTS + 2] = {};
+
+    while (!*stop)
+    {
+        fds[0].fd     = listen_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd     = daemon->wake_pipe[0];
+        fds[1].events = POLLIN;
+        bool pending = false;
+        for (int i = 0; i < daemon->number_of_clients; i++)
+        {
+            const DaemonClient* client = &daemon->clients[i];
+
+            fds[i + 2].fd      = client->fd;
+            fds[i + 2].events  = POLLIN | ((client->output_sent < client->output_size) ? POLLOUT : 0);
+            fds[i + 2].revents = 0;
+            pending |= clientPending(client);
+        }
+
+        // пока кто-то из клиентов не дочитан или не дописан, просыпаемся,
+        // чтобы отключить зависших
+        const int number_of_clients = daemon->number_of_clients;
+        int ready = poll(fds, number_of_clients + 2, pending ? DAEMON_CLIENT_STALL_MS / 10 : -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            char drain[64];
+            if (read(daemon->wake_pipe[0], drain, sizeof(drain)) < 0)
+            {
+                perror("read");
+            }
+            deliverCompleted(daemon);
+        }
+
+        // с конца, чтобы удаление клиента не сдвигало непросмотренных
+        const uint64_t now = SDL_GetTicksNS();
+        for (int i = number_of_clients - 1; i >= 0; i--)
+        {
+            DaemonClient* client = &daemon->clients[i];
+
+            bool failed = false;
+            if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                failed = readRequests(daemon, client);
+            }
+            if (!failed && (fds[i + 2].revents & POLLOUT))
+            {
+                failed = flushClient(client);
+            }
+            if (!failed && clientPending(client)
+             && now > client->progress_ns + (uint64_t)DAEMON_CLIENT_STALL_MS * 1000000)
+            {
+                fprintf(stderr, "Client %u stalled, disconnected\n", client->id);
+                failed = true;
+            }
+
+            if (failed)
+            {
+                removeClient(daemon, i);
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            acceptClient(daemon, listen_fd);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(daemon->lock);
+        daemon->stopping = true;
+    }
+    daemon->has_work.notify_all();
+
+    for (int i = 0; i < daemon->config.threads; i++)
+    {
+        workers[i].join();
+    }
+    delete[] workers;
+
+    daemon->stats.cached_tiles = daemon->cache.count;
+    daemon->stats.queued_tiles = daemon->queued;
+    printDaemonStatistics(stdout, &daemon->stats);
+
+    while (daemon->number_of_clients > 0)
+    {
+        removeClient(daemon, daemon->number_of_clients - 1);
+    }
+    for (int i = 0; i < daemon->number_of_active; i++)
+    {
+        destroyJob(daemon->active[i]);
+    }
+    while (daemon->completed)
+    {
+        TileJob* job = daemon->completed;
+        daemon->completed = job->next;
+        destroyJob(job);
+    }
+
+    free(daemon->active);
+    destroyTileCache(&daemon->cache);
+    close(daemon->wake_pipe[0]);
+    close(daemon->wake_pipe[1]);
+    close(listen_fd);
+    if (socket_path[0])
+    {
+        unlink(socket_path);
+    }
+
+    delete daemon;
+    return 0;
+}
+
+
+void tileViewport(const TileKey* key, double* center_x, double* center_y, double* size)
+{
+    assert(key      != NULL);
+    assert(center_x != NULL);
+    assert(center_y != NULL);
+    assert(size     != NULL);
+
+    *size     = DAEMON_WORLD_SIZE / (double)(1ll << key->level);
+    *center_x = DAEMON_WORLD_LEFT + (key->tile_x + 0.5) * *size;
+    *center_y = DAEMON_WORLD_TOP  - (key->tile_y + 0.5) * *size;
+}
+
+
+void printDaemonStatistics(FILE* file, const DaemonStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    const double render_ms = (stats->rendered > 0)
+                           ? (double)stats->render_ns / 1e6 / stats->rendered
+                           : 0.0;
+
+    fprintf(file, "daemon: %llu requests, %llu cache hits, %llu coalesced, %llu promoted, "
+                  "%llu rendered (%.2f ms each), %llu abandoned, %llu cancelled, "
+                  "%d tiles cached, %d queued\n",
+            (unsigned long long)stats->requests,  (unsigned long long)stats->cache_hits,
+            (unsigned long long)stats->coalesced, (unsigned long long)stats->promoted,
+            (unsigned long long)stats->rendered,  render_ms,
+            (unsigned long long)stats->abandoned, (unsigned long long)stats->cancelled,
+            stats->cached_tiles, stats->queued_tiles);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+// поток создаёт своё поле и палитру один раз и держит их до остановки
+static void runDaemonWorker(Daemon* daemon)
+{
+    assert(daemon != NULL);
+
+    MandelbrotData data = {};
+    if (setDefaultMandelbrot(&data)
+     || setMandelbrotField(&data, DAEMON_TILE_SIZE, DAEMON_TILE_SIZE,
+                           FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS))
+    {
+        fprintf(stderr, "Daemon worker could not allocate its field\n");
+        return;
+    }
+
+    while (true)
+    {
+        TileJob* job = NULL;
+        {
+            std::unique_lock<std::mutex> guard(daemon->lock);
+            daemon->has_work.wait(guard, [daemon] {
+                return daemon->stopping || daemon->queued > 0;
+            });
+
+            if (daemon->stopping)
+            {
+                break;
+            }
+
+            job = popJob(daemon);
+            if (job == NULL)
+            {
+                continue;
+            }
+            job->rendering = true;
+        }
+
+        renderTile(&data, job);
+
+        {
+            std::lock_guard<std::mutex> guard(daemon->lock);
+
+            void* cached = insertCachedTile(&daemon->cache, &job->key);
+            memcpy(cached, job->pixels, DAEMON_TILE_PIXELS * sizeof(uint32_t));
+
+            removeActiveJob(daemon, job);
+            job->next = daemon->completed;
+            daemon->completed = job;
+
+            daemon->stats.rendered++;
+            daemon->stats.render_ns += job->render_ns;
+        }
+
+        const char wake = 1;
+        if (write(daemon->wake_pipe[1], &wake, 1) < 0)
+        {
+            perror("write");
+        }
+    }
+
+    freeMandelbrot(&data);
+}
+
+
+static void renderTile(MandelbrotData* data, TileJob* job)
+{
+    assert(data != NULL);
+    assert(job  != NULL);
+
+    const uint64_t start = SDL_GetTicksNS();
+
+    double size = 0;
+    tileViewport(&job->key, &data->center_x, &data->center_y, &size);
+
+    data->width          = size;
+    data->height         = size;
+    data->max_iterations = job->key.max_iterations;
+    data->formula        = (FormulaType)job->key.formula;
+    data->julia_re       = job->key.julia_re;
+    data->julia_im       = job->key.julia_im;
+
+    calculateFormulaIterationFieldIntrinsics(data);
+    colorizeIterationField(DAEMON_TILE_SIZE * sizeof(uint32_t), job->pixels, data);
+
+    job->render_ns = SDL_GetTicksNS() - start;
+}
+
+
+static void acceptClient(Daemon* daemon, int listen_fd)
+{
+    assert(daemon != NULL);
+
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+        perror("accept");
+        return;
+    }
+
+    if (daemon->number_of_clients == DAEMON_MAX_CLIENTS)
+    {
+        fprintf(stderr, "Too many clients, connection refused\n");
+        close(fd);
+        return;
+    }
+
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        perror("fcntl");
+        close(fd);
+        return;
+    }
+
+    DaemonClient* client = &daemon->clients[daemon->number_of_clients++];
+    memset(client, 0, sizeof(*client));
+    client->fd = fd;
+    client->id = ++daemon->next_client_id;
+}
+
+
+// читает, сколько есть, не больше DAEMON_REQUESTS_PER_POLL запросов за раз,
+// чтобы один клиент не занимал поток ввода-вывода
+static int readRequests(Daemon* daemon, DaemonClient* client)
+{
+    assert(daemon != NULL);
+    assert(client != NULL);
+
+    for (int handled = 0; handled < DAEMON_REQUESTS_PER_POLL; )
+    {
+        ssize_t received = recv(client->fd, (char*)&client->request + client->received,
+                                sizeof(client->request) - client->received, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0;
+        }
+        if (received <= 0)
+        {
+            return 1;
+        }
+
+        client->progress_ns = SDL_GetTicksNS();
+        client->received   += received;
+        if (client->received < sizeof(client->request))
+        {
+            continue;
+        }
+
+        client->received = 0;
+        handled++;
+        if (handleRequest(daemon, client, &client->request))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int handleRequest(Daemon* daemon, DaemonClient* client, const DaemonRequest* request)
+{
+    assert(daemon  != NULL);
+    assert(client  != NULL);
+    assert(request != NULL);
+
+    if (request->magic != DAEMON_MESSAGE_MAGIC)
+    {
+        return 1;
+    }
+
+    switch (request->type)
+    {
+        case DAEMON_REQUEST_TILE:
+            return requestTile(daemon, client, request);
+
+        case DAEMON_CANCEL_TILE:
+            cancelRequests(daemon, client->id, false, request->request_id);
+            return 0;
+
+        case DAEMON_REQUEST_STATISTICS:
+        {
+            DaemonStatistics stats = {};
+            {
+                std::lock_guard<std::mutex> guard(daemon->lock);
+                stats = daemon->stats;
+                stats.cached_tiles = daemon->cache.count;
+                stats.queued_tiles = daemon->queued;
+            }
+
+            DaemonResponse response = {};
+            response.magic      = DAEMON_MESSAGE_MAGIC;
+            response.type       = DAEMON_STATISTICS;
+            response.request_id = request->request_id;
+
+            return queueOutput(client, &response, sizeof(response), &stats, sizeof(stats))
+                || flushClient(client);
+        }
+
+        default:
+            fprintf(stderr, "Unknown daemon request %u\n", request->type);
+            return 1;
+    }
+}
+
+
+// 1 - клиента пора отключить: ответ не помещается в его очередь
+static int requestTile(Daemon* daemon, DaemonClient* client, const DaemonRequest* request)
+{
+    assert(daemon  != NULL);
+    assert(client  != NULL);
+    assert(request != NULL);
+
+    TileKey key = request->key;
+    if (!normalizeTileKey(&key))
+    {
+        fprintf(stderr, "Client %u requested invalid tile\n", client->id);
+        return 0;
+    }
+
+    const TilePriority priority = (request->priority == TILE_PRIORITY_VISIBLE)
+                                ? TILE_PRIORITY_VISIBLE
+                                : TILE_PRIORITY_PREFETCH;
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> guard(daemon->lock);
+        daemon->stats.requests++;
+
+        const void* pixels = findCachedTile(&daemon->cache, &key);
+        if (pixels)
+        {
+            // копия под блокировкой: рабочий поток может вытеснить плитку
+            if (queueTileResponse(client, request->request_id, true, 0, (const uint32_t*)pixels))
+            {
+                return 1;
+            }
+            daemon->stats.cache_hits++;
+            cached = true;
+        }
+        else if (TileJob* job = findActiveJob(daemon, &key))
+        {
+            addWaiter(job, client->id, request->request_id);
+            daemon->stats.coalesced++;
+
+            if (priority == TILE_PRIORITY_VISIBLE && job->priority != TILE_PRIORITY_VISIBLE
+             && !job->rendering)
+            {
+                unqueueJob(daemon, job);
+                job->priority = TILE_PRIORITY_VISIBLE;
+                pushJob(daemon, job);
+                daemon->stats.promoted++;
+            }
+        }
+        else
+        {
+            TileJob* created = createJob(&key, priority);
+            if (!created || addWaiter(created, client->id, request->request_id)
+             || addActiveJob(daemon, created))
+            {
+                fprintf(stderr, "Error while allocating memory for tile job\n");
+                destroyJob(created);
+                return 0;
+            }
+            pushJob(daemon, created);
+        }
+    }
+
+    if (cached)
+    {
+        return flushClient(client);
+    }
+
+    daemon->has_work.notify_one();
+    return 0;
+}
+
+
+// брошенные плитки остаются в очереди, рабочий поток выбросит их, не считая
+static void cancelRequests(Daemon* daemon, uint32_t client, bool all, uint32_t request_id)
+{
+    assert(daemon != NULL);
+
+    std::lock_guard<std::mutex> guard(daemon->lock);
+
+    for (int i = 0; i < daemon->number_of_active; i++)
+    {
+        TileJob* job = daemon->active[i];
+
+        for (int waiter = 0; waiter < job->number_of_waiters; )
+        {
+            if (job->waiters[waiter].client == client
+             && (all || job->waiters[waiter].request_id == request_id))
+            {
+                job->waiters[waiter] = job->waiters[--job->number_of_waiters];
+                daemon->stats.cancelled++;
+            }
+            else
+            {
+                waiter++;
+            }
+        }
+    }
+}
+
+
+static void deliverCompleted(Daemon* daemon)
+{
+    assert(daemon != NULL);
+
+    TileJob* completed = NULL;
+    {
+        std::lock_guard<std::mutex> guard(daemon->lock);
+        completed = daemon->completed;
+        daemon->completed = NULL;
+    }
+
+    while (completed)
+    {
+        TileJob* job = completed;
+        completed = job->next;
+
+        for (int i = 0; i < job->number_of_waiters; i++)
+        {
+            DaemonClient* client = findClient(daemon, job->waiters[i].client);
+            if (client && (queueTileResponse(client, job->waiters[i].request_id,
+                                             false, job->render_ns, job->pixels)
+                        || flushClient(client)))
+            {
+                // соединение порвалось или клиент не забирает ответы,
+                // его закроет следующий poll
+                shutdown(client->fd, SHUT_RDWR);
+            }
+        }
+
+        destroyJob(job);
+    }
+}
+
+
+static void removeClient(Daemon* daemon, int index)
+{
+    assert(daemon != NULL);
+    assert(index >= 0 && index < daemon->number_of_clients);
+
+    DaemonClient* client = &daemon->clients[index];
+
+    // клиент ушёл: его запросы больше никому не нужны
+    cancelRequests(daemon, client->id, true, 0);
+    close(client->fd);
+    free(client->output);
+
+    daemon->clients[index] = daemon->clients[--daemon->number_of_clients];
+}
+
+
+static DaemonClient* findClient(Daemon* daemon, uint32_t id)
+{
+    assert(daemon != NULL);
+
+    for (int i = 0; i < daemon->number_of_clients; i++)
+    {
+        if (daemon->clients[i].id == id)
+        {
+            return &daemon->clients[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+static bool clientPending(const DaemonClient* client)
+{
+    assert(client != NULL);
+
+    return client->received > 0 || client->output_sent < client->output_size;
+}
+
+
+static int queueOutput(DaemonClient* client, const void* header, size_t header_size,
+                       const void* payload, size_t payload_size)
+{
+    assert(client != NULL);
+    assert(header != NULL);
+    assert(payload != NULL);
+
+    const size_t size   = header_size + payload_size;
+    const size_t unsent = client->output_size - client->output_sent;
+    if (unsent + size > DAEMON_CLIENT_BACKLOG)
+    {
+        fprintf(stderr, "Client %u does not read its tiles, disconnected\n", client->id);
+        return 1;
+    }
+
+    if (unsent == 0)
+    {
+        // очередь была пуста: ожидание клиента отсчитывается с этого ответа
+        client->progress_ns = SDL_GetTicksNS();
+    }
+
+    if (client->output_size + size > client->output_capacity && client->output_sent > 0)
+    {
+        memmove(client->output, client->output + client->output_sent, unsent);
+        client->output_size = unsent;
+        client->output_sent = 0;
+    }
+    if (client->output_size + size > client->output_capacity)
+    {
+        size_t capacity = 2 * client->output_capacity;
+        if (capacity < client->output_size + size)
+        {
+            capacity = client->output_size + size;
+        }
+
+        uint8_t* output = (uint8_t*)realloc(client->output, capacity);
+        if (!output)
+        {
+            fprintf(stderr, "Error while allocating memory for client output\n");
+            return 1;
+        }
+        client->output          = output;
+        client->output_capacity = capacity;
+    }
+
+    memcpy(client->output + client->output_size, header, header_size);
+    memcpy(client->output + client->output_size + header_size, payload, payload_size);
+    client->output_size += size;
+
+    return 0;
+}
+
+
+// отправляет, сколько примет сокет; остальное уйдёт по POLLOUT
+static int flushClient(DaemonClient* client)
+{
+    assert(client != NULL);
+
+    while (client->output_sent < client->output_size)
+    {
+        ssize_t sent = send(client->fd, client->output + client->output_sent,
+                            client->output_size - client->output_sent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0;
+        }
+        if (sent <= 0)
+        {
+            return 1;
+        }
+
+        client->output_sent += sent;
+        client->progress_ns  = SDL_GetTicksNS();
+    }
+
+    client->output_size = 0;
+    client->output_sent = 0;
+
+    // буфер, раздутый очередью ответов, не держим за простаивающим клиентом
+    if (client->output_capacity > DAEMON_TILE_RESPONSE_SIZE)
+    {
+        free(client->output);
+        client->output          = NULL;
+        client->output_capacity = 0;
+    }
+
+    return 0;
+}
+
+
+static int queueTileResponse(DaemonClient* client, uint32_t request_id, bool cached,
+                             uint64_t render_ns, const uint32_t* pixels)
+{
+    assert(client != NULL);
+    assert(pixels != NULL);
+
+    DaemonResponse response = {};
+    response.magic      = DAEMON_MESSAGE_MAGIC;
+    response.type       = DAEMON_TILE_READY;
+    response.request_id = request_id;
+    response.cached     = cached;
+    response.render_ns  = render_ns;
+
+    return queueOutput(client, &response, sizeof(response),
+                       pixels, DAEMON_TILE_PIXELS * sizeof(uint32_t));
+}
+
+
+// параметры Жюлиа не влияют на остальные формулы, их обнуляем, чтобы
+// одинаковые плитки совпадали в кэше; плитки за краем пирамиды не
+// принимаются, иначе ими можно вытеснить из кэша все настоящие
+static bool normalizeTileKey(TileKey* key)
+{
+    assert(key != NULL);
+
+    if (key->formula < 0 || key->formula >= FORMULA_COUNT
+     || key->level   < 0 || key->level   > DAEMON_MAX_LEVEL
+     || key->max_iterations < 1 || key->max_iterations > DAEMON_MAX_ITERATIONS)
+    {
+        return false;
+    }
+
+    const int64_t tiles_per_side = 1ll << key->level;
+    if (key->tile_x < 0 || key->tile_x >= tiles_per_side
+     || key->tile_y < 0 || key->tile_y >= tiles_per_side)
+    {
+        return false;
+    }
+
+    key->reserved = 0;
+    if (key->formula != FORMULA_JULIA)
+    {
+        key->julia_re = 0;
+        key->julia_im = 0;
+    }
+
+    return true;
+}
+
+
+static TileJob* createJob(const TileKey* key, TilePriority priority)
+{
+    assert(key != NULL);
+
+    TileJob* job = (TileJob*)calloc(1, sizeof(TileJob));
+    if (!job)
+    {
+        return NULL;
+    }
+
+    job->key      = *key;
+    job->priority = priority;
+    job->pixels   = (uint32_t*)aligned_alloc(32, DAEMON_TILE_PIXELS * sizeof(uint32_t));
+    if (!job->pixels)
+    {
+        free(job);
+        return NULL;
+    }
+
+    return job;
+}
+
+
+static void destroyJob(TileJob* job)
+{
+    if (job)
+    {
+        free(job->waiters);
+        free(job->pixels);
+        free(job);
+    }
+}
+
+
+static int addWaiter(TileJob* job, uint32_t client, uint32_t request_id)
+{
+    assert(job != NULL);
+
+    if (job->number_of_waiters == job->waiters_capacity)
+    {
+        int capacity = (job->waiters_capacity > 0) ? 2 * job->waiters_capacity : 4;
+        TileWaiter* waiters = (TileWaiter*)realloc(job->waiters, capacity * sizeof(TileWaiter));
+        if (!waiters)
+        {
+            return 1;
+        }
+
+        job->waiters          = waiters;
+        job->waiters_capacity = capacity;
+    }
+
+    TileWaiter waiter = {client, request_id};
+    job->waiters[job->number_of_waiters++] = waiter;
+    return 0;
+}
+
+
+static TileJob* findActiveJob(Daemon* daemon, const TileKey* key)
+{
+    assert(daemon != NULL);
+    assert(key    != NULL);
+
+    for (int i = 0; i < daemon->number_of_active; i++)
+    {
+        if (sameTileKey(&daemon->active[i]->key, key))
+        {
+            return daemon->active[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+static int addActiveJob(Daemon* daemon, TileJob* job)
+{
+    assert(daemon != NULL);
+    assert(job    != NULL);
+
+    if (daemon->number_of_active == daemon->active_capacity)
+    {
+        int capacity = (daemon->active_capacity > 0) ? 2 * daemon->active_capacity : 64;
+        TileJob** active = (TileJob**)realloc(daemon->active, capacity * sizeof(TileJob*));
+        if (!active)
+        {
+            return 1;
+        }
+
+        daemon->active          = active;
+        daemon->active_capacity = capacity;
+    }
+
+    daemon->active[daemon->number_of_active++] = job;
+    return 0;
+}
+
+
+static void removeActiveJob(Daemon* daemon, TileJob* job)
+{
+    assert(daemon != NULL);
+    assert(job    != NULL);
+
+    for (int i = 0; i < daemon->number_of_active; i++)
+    {
+        if (daemon->active[i] == job)
+        {
+            daemon->active[i] = daemon->active[--daemon->number_of_active];
+            return;
+        }
+    }
+}
+
+
+static void pushJob(Daemon* daemon, TileJob* job)
+{
+    assert(daemon != NULL);
+    assert(job    != NULL);
+
+    job->next = NULL;
+    if (daemon->queue_tail[job->priority])
+    {
+        daemon->queue_tail[job->priority]->next = job;
+    }
+    else
+    {
+        daemon->queue_head[job->priority] = job;
+    }
+    daemon->queue_tail[job->priority] = job;
+    daemon->queued++;
+}
+
+
+// видимые плитки раньше запасных; плитки, которые никто больше не ждёт,
+// выбрасываются без счёта
+static TileJob* popJob(Daemon* daemon)
+{
+    assert(daemon != NULL);
+
+    for (int priority = 0; priority < TILE_PRIORITY_COUNT; priority++)
+    {
+        while (daemon->queue_head[priority])
+        {
+            TileJob* job = daemon->queue_head[priority];
+
+            daemon->queue_head[priority] = job->next;
+            if (daemon->queue_head[priority] == NULL)
+            {
+                daemon->queue_tail[priority] = NULL;
+            }
+            daemon->queued--;
+
+            if (job->number_of_waiters > 0)
+            {
+                return job;
+            }
+
+            removeActiveJob(daemon, job);
+            destroyJob(job);
+            daemon->stats.abandoned++;
+        }
+    }
+
+    return NULL;
+}
+
+
+static void unqueueJob(Daemon* daemon, TileJob* job)
+{
+    assert(daemon != NULL);
+    assert(job    != NULL);
+
+    TileJob** link = &daemon->queue_head[job->priority];
+    TileJob*  previous = NULL;
+
+    while (*link && *link != job)
+    {
+        previous = *link;
+        link = &(*link)->next;
+    }
+
+    if (*link == NULL)
+    {
+        return;
+    }
+
+    *link = job->next;
+    if (daemon->queue_tail[job->priority] == job)
+    {
+        daemon->queue_tail[job->priority] = previous;
+    }
+    daemon->queued--;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <thread>
+
+#include "mandelbrot_daemon.h"
+
+
+//     mandel_daemon --address unix:/tmp/mandel_daemon.sock --threads 4 --cache-tiles 512
+
+static const char* DEFAULT_DAEMON_ADDRESS = "unix:/tmp/mandel_daemon.sock";
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void requestStop(int);
+
+
+int main(int argc, char* argv[])
+{
+    DaemonConfig config = {};
+    config.address     = DEFAULT_DAEMON_ADDRESS;
+    config.threads     = (int)std::thread::hardware_concurrency();
+    config.cache_tiles = DEFAULT_CACHE_TILES;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--address") && has_value)
+        {
+            config.address = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--threads") && has_value)
+        {
+            config.threads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--cache-tiles") && has_value)
+        {
+            config.cache_tiles = atoi(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (config.cache_tiles < 1)
+    {
+        fprintf(stderr, "Cache must hold at least one tile\n");
+        return 1;
+    }
+
+    // без SA_RESTART, чтобы сигнал прерывал poll
+    struct sigaction action = {};
+    action.sa_handler = requestStop;
+    sigaction(SIGINT,  &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    return runMandelbrotDaemon(&config, &stop_requested);
+}
+
+
+static void requestStop(int)
+{
+    stop_requested = 1;
+}
@@ -0,0 +1,859 @@
+#include "mandelbrot_distributed.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <SDL3/SDL.h>
+
+#include "mandelbrot_utils.h"
+#include "mandelbrot_logic_formula.h"
+#include "mandelbrot_socket.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+typedef enum TileState
+{
+    TILE_PENDING = 0,
+    TILE_IN_FLIGHT,
+    TILE_DONE
+} TileState;
+
+typedef struct TileSchedule
+{
+    TileState* states;
+    int*       copies;      // сколько рабочих сейчас считают плитку
+    int*       order;       // очередь плиток, самые дорогие первыми
+    int        next;
+    int*       retry;       // плитки умерших рабочих, раздаются раньше очереди
+    int        retry_count;
+    int        done;
+} TileSchedule;
+
+static int  acceptWorker(DistributedCoordinator* coordinator);
+static void spawnLocalWorker(DistributedCoordinator* coordinator, int index);
+
+static int  sendTile(DistributedCoordinator* coordinator, int worker,
+                     const MandelbrotData* data, int slot);
+static int  receiveTile(DistributedCoordinator* coordinator, int worker,
+                        MandelbrotData* data, TileSchedule* schedule,
+                        int* tile_buffer, DistributedStatistics* stats);
+static void dropWorker(DistributedCoordinator* coordinator, int worker,
+                       TileSchedule* schedule, DistributedStatistics* stats);
+static int  findInFlight(const DistributedWorker* worker, uint32_t frame, int slot);
+static void forgetTile(DistributedWorker* worker, int index);
+
+static void finishTilesLocally(MandelbrotData* data, TileSchedule* schedule,
+                               int tiles, DistributedStatistics* stats);
+static int  nextPendingTile(TileSchedule* schedule);
+static int  findStraggler(DistributedCoordinator* coordinator, TileSchedule* schedule, uint64_t now);
+static void orderTilesByCost(DistributedCoordinator* coordinator, TileSchedule* schedule);
+static int  compareCostKeys(const void* a, const void* b);
+static bool validTileRequest(const TileRequest* request);
+
+
+// public ----------------------------------------------------------------------
+
+
+void setDefaultDistributedConfig(DistributedConfig* config, const char* address)
+{
+    assert(config  != NULL);
+    assert(address != NULL);
+
+    config->address              = address;
+    config->local_workers        = 4;
+    config->expected_workers     = 4;
+    config->pipeline_depth       = DEFAULT_PIPELINE_DEPTH;
+    config->straggler_factor     = DEFAULT_STRAGGLER_FACTOR;
+    config->fail_worker_after    = 0;
+    config->slow_worker_delay_ms = 0;
+}
+
+
+int startCoordinator(DistributedCoordinator* coordinator, const DistributedConfig* config)
+{
+    assert(coordinator != NULL);
+    assert(config      != NULL);
+
+    memset(coordinator, 0, sizeof(*coordinator));
+    coordinator->config = *config;
+
+    if (coordinator->config.pipeline_depth < 1)
+    {
+        coordinator->config.pipeline_depth = 1;
+    }
+    if (coordinator->config.pipeline_depth > MAX_PIPELINE_DEPTH)
+    {
+        coordinator->config.pipeline_depth = MAX_PIPELINE_DEPTH;
+    }
+    if (coordinator->config.expected_workers > MAX_DISTRIBUTED_WORKERS)
+    {
+        coordinator->config.expected_workers = MAX_DISTRIBUTED_WORKERS;
+    }
+
+    // запись в сокет умершего рабочего не должна убивать координатор
+    signal(SIGPIPE, SIG_IGN);
+
+    coordinator->listen_fd = createListener(config->address, coordinator->socket_path);
+    if (coordinator->listen_fd < 0)
+    {
+        return 1;
+    }
+
+    const int local_workers = (config->local_workers < coordinator->config.expected_workers)
+                            ? config->local_workers
+                            : coordinator->config.expected_workers;
+
+    for (int i = 0; i < local_workers; i++)
+    {
+        spawnLocalWorker(coordinator, i);
+    }
+
+    while (coordinator->number_of_workers < coordinator->config.expected_workers)
+    {
+        if (acceptWorker(coordinator))
+        {
+            fprintf(stderr, "Only %d of %d workers connected\n",
+                    coordinator->number_of_workers, coordinator->config.expected_workers);
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+int renderDistributed(DistributedCoordinator* coordinator,
+                      MandelbrotData* data,
+                      DistributedStatistics* stats)
+{
+    assert(coordinator != NULL);
+    assert(data        != NULL);
+    assert(stats       != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (data->field.width  > MAX_DISTRIBUTED_FIELD_SIDE
+     || data->field.height > MAX_DISTRIBUTED_FIELD_SIDE
+     || data->max_iterations < 1 || data->max_iterations > MAX_DISTRIBUTED_ITERATIONS)
+    {
+        fprintf(stderr, "Field %dx%d with %d iterations is too large for distributed rendering\n",
+                data->field.width, data->field.height, data->max_iterations);
+        return 1;
+    }
+
+    const uint64_t start = SDL_GetTicksNS();
+    const int tiles = fieldTileCount(&data->field);
+
+    coordinator->frame++;
+
+    if (coordinator->number_of_tiles != tiles)
+    {
+        free(coordinator->tile_cost_ns);
+        coordinator->tile_cost_ns    = (uint64_t*)calloc(tiles, sizeof(uint64_t));
+        coordinator->number_of_tiles = tiles;
+    }
+
+    TileSchedule schedule = {};
+    schedule.states = (TileState*)calloc(tiles, sizeof(TileState));
+    schedule.copies = (int*)calloc(tiles, sizeof(int));
+    schedule.order  = (int*)calloc(tiles + 1, sizeof(int));
+    schedule.retry  = (int*)calloc(tiles, sizeof(int));
+    int* tile_buffer = (int*)calloc(FIELD_TILE_AREA, sizeof(int));
+
+    if (!coordinator->tile_cost_ns || !schedule.states || !schedule.copies
+     || !schedule.order || !schedule.retry || !tile_buffer)
+    {
+        fprintf(stderr, "Error while allocating memory for tile schedule\n");
+        free(schedule.states);
+        free(schedule.copies);
+        free(schedule.order);
+        free(schedule.retry);
+        free(tile_buffer);
+        return 1;
+    }
+
+    orderTilesByCost(coordinator, &schedule);
+
+    struct pollfd fds[MAX_DISTRIBUTED_WORKERS + 1] = {};
+    int poll_workers[MAX_DISTRIBUTED_WORKERS] = {};
+
+    while (schedule.done < tiles)
+    {
+        const uint64_t now = SDL_GetTicksNS();
+        int alive = 0;
+
+        for (int worker = 0; worker < coordinator->number_of_workers; worker++)
+        {
+            DistributedWorker* current = &coordinator->workers[worker];
+            if (!current->alive)
+            {
+                continue;
+            }
+            alive++;
+
+            while (current->alive && current->in_flight < coordinator->config.pipeline_depth)
+            {
+                int slot = nextPendingTile(&schedule);
+                if (slot < 0)
+                {
+                    // очередь пуста: простаивающий рабочий берёт копию
+                    // самой долгой плитки, первый ответ побеждает
+                    if (current->in_flight > 0
+                     || (slot = findStraggler(coordinator, &schedule, now)) < 0)
+                    {
+                        break;
+                    }
+                    stats->duplicated_tiles++;
+                }
+
+                if (sendTile(coordinator, worker, data, slot))
+                {
+                    if (schedule.copies[slot] == 0)
+                    {
+                        schedule.retry[schedule.retry_count++] = slot;
+                    }
+                    dropWorker(coordinator, worker, &schedule, stats);
+                    break;
+                }
+
+                schedule.states[slot] = TILE_IN_FLIGHT;
+                schedule.copies[slot]++;
+            }
+        }
+
+        if (alive == 0)
+        {
+            // все рабочие умерли: координатор досчитывает кадр сам
+            finishTilesLocally(data, &schedule, tiles, stats);
+            break;
+        }
+
+        int number_of_fds = 0;
+        for (int worker = 0; worker < coordinator->number_of_workers; worker++)
+        {
+            if (coordinator->workers[worker].alive)
+            {
+                fds[number_of_fds].fd     = coordinator->workers[worker].fd;
+                fds[number_of_fds].events = POLLIN;
+                poll_workers[number_of_fds] = worker;
+                number_of_fds++;
+            }
+        }
+        fds[number_of_fds].fd     = coordinator->listen_fd;
+        fds[number_of_fds].events = POLLIN;
+
+        int ready = poll(fds, number_of_fds + 1, (int)MIN_STRAGGLER_MS / 4);
+        if (ready < 0 && errno != EINTR)
+        {
+            // ответов больше не дождаться; опоздавшие отбросятся как
+            // ответы на прошлый кадр
+            perror("poll");
+            finishTilesLocally(data, &schedule, tiles, stats);
+            break;
+        }
+
+        for (int i = 0; i < number_of_fds && ready > 0; i++)
+        {
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                int worker = poll_workers[i];
+                if (receiveTile(coordinator, worker, data, &schedule, tile_buffer, stats))
+                {
+                    dropWorker(coordinator, worker, &schedule, stats);
+                }
+            }
+        }
+
+        // рабочие могут подключаться и между кадрами, и посреди кадра
+        if (ready > 0 && (fds[number_of_fds].revents & POLLIN)
+         && coordinator->number_of_workers < MAX_DISTRIBUTED_WORKERS)
+        {
+            acceptWorker(coordinator);
+        }
+    }
+
+    stats->tiles    = tiles;
+    stats->frame_ms = (double)(SDL_GetTicksNS() - start) / 1e6;
+    for (int worker = 0; worker < coordinator->number_of_workers; worker++)
+    {
+        stats->workers += coordinator->workers[worker].alive;
+    }
+
+    free(schedule.states);
+    free(schedule.copies);
+    free(schedule.order);
+    free(schedule.retry);
+    free(tile_buffer);
+
+    return 0;
+}
+
+
+void stopCoordinator(DistributedCoordinator* coordinator)
+{
+    assert(coordinator != NULL);
+
+    // закрытый сокет для рабочего означает конец работы
+    for (int worker = 0; worker < coordinator->number_of_workers; worker++)
+    {
+        if (coordinator->workers[worker].fd >= 0)
+        {
+            close(coordinator->workers[worker].fd);
+            coordinator->workers[worker].fd = -1;
+        }
+    }
+
+    for (int i = 0; i < coordinator->number_of_local_workers; i++)
+    {
+        waitpid(coordinator->local_pids[i], NULL, 0);
+    }
+    coordinator->number_of_local_workers = 0;
+
+    if (coordinator->listen_fd >= 0)
+    {
+        close(coordinator->listen_fd);
+        coordinator->listen_fd = -1;
+    }
+    if (coordinator->socket_path[0])
+    {
+        unlink(coordinator->socket_path);
+    }
+
+    free(coordinator->tile_cost_ns);
+    coordinator->tile_cost_ns    = NULL;
+    coordinator->number_of_tiles = 0;
+}
+
+
+int runMandelbrotWorker(const char* address, int fail_after, int delay_ms)
+{
+    assert(address != NULL);
+
+    int fd = connectToAddress(address);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    MandelbrotData data = {};
+    if (setDefaultMandelbrot(&data))
+    {
+        close(fd);
+        return 1;
+    }
+
+    int* tile_buffer = (int*)calloc(FIELD_TILE_AREA, sizeof(int));
+    if (!tile_buffer)
+    {
+        fprintf(stderr, "Error while allocating memory for tile buffer\n");
+        freeMandelbrot(&data);
+        close(fd);
+        return 1;
+    }
+
+    int return_code = 0;
+    int tiles_done  = 0;
+    TileRequest request = {};
+
+    while (readFull(fd, &request, sizeof(request)) == 0)
+    {
+        if (!validTileRequest(&request))
+        {
+            fprintf(stderr, "Worker received malformed tile request\n");
+            return_code = 1;
+            break;
+        }
+
+        // плиточное поле во весь кадр: страницы памяти выделяются только
+        // под посчитанные плитки, а координаты пикселей считаются так же,
+        // как в однопроцессном рендере, и результат совпадает побитно
+        if (data.field.width != request.field_width || data.field.height != request.field_height)
+        {
+            if (setMandelbrotField(&data, request.field_width, request.field_height,
+                                   FIELD_FORMAT_I32, FIELD_LAYOUT_TILED))
+            {
+                return_code = 1;
+                break;
+            }
+        }
+
+        data.max_iterations = request.max_iterations;
+        data.formula        = (FormulaType)request.formula;
+        data.center_x       = request.center_x;
+        data.center_y       = request.center_y;
+        data.width          = request.width;
+        data.height         = request.height;
+        data.julia_re       = request.julia_re;
+        data.julia_im       = request.julia_im;
+
+        const uint64_t start = SDL_GetTicksNS();
+        calculateFormulaIterationRectIntrinsics(&data, request.rect);
+        if (delay_ms > 0)
+        {
+            usleep(delay_ms * 1000);
+        }
+
+        const FieldRect rect = request.rect;
+        for (int y = 0; y < rect.height; y++)
+        {
+            for (int x = 0; x < rect.width; x++)
+            {
+                tile_buffer[y * rect.width + x] = fieldLoad(&data.field, rect.x + x, rect.y + y);
+            }
+        }
+
+        TileResponse response = {};
+        response.magic      = TILE_MESSAGE_MAGIC;
+        response.frame      = request.frame;
+        response.slot       = request.slot;
+        response.rect       = rect;
+        response.compute_ns = SDL_GetTicksNS() - start;
+
+        if (writeFull(fd, &response, sizeof(response))
+         || writeFull(fd, tile_buffer, (size_t)rect.width * rect.height * sizeof(int)))
+        {
+            return_code = 1;
+            break;
+        }
+
+        if (fail_after > 0 && ++tiles_done >= fail_after)
+        {
+            // имитация падения: выходим, не дожидаясь остальных плиток
+            break;
+        }
+    }
+
+    free(tile_buffer);
+    freeMandelbrot(&data);
+    close(fd);
+
+    return return_code;
+}
+
+
+void printDistributedStatistics(FILE* file, const DistributedStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    fprintf(file, "frame %.2f ms, %d tiles, %d workers alive, %d died, "
+                  "%d redispatched, %d duplicated, %d computed locally\n",
+            stats->frame_ms, stats->tiles, stats->workers, stats->dead_workers,
+            stats->redispatched_tiles, stats->duplicated_tiles, stats->local_tiles);
+
+    for (int worker = 0; worker < MAX_DISTRIBUTED_WORKERS; worker++)
+    {
+        if (stats->tiles_per_worker[worker] > 0)
+        {
+            fprintf(file, "    worker %2d: %5d tiles, busy %.2f ms\n",
+                    worker, stats->tiles_per_worker[worker], stats->busy_ms_per_worker[worker]);
+        }
+    }
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static int acceptWorker(DistributedCoordinator* coordinator)
+{
+    assert(coordinator != NULL);
+
+    struct pollfd listener = {coordinator->listen_fd, POLLIN, 0};
+    if (poll(&listener, 1, WORKER_ACCEPT_TIMEOUT_MS) <= 0)
+    {
+        return 1;
+    }
+
+    int fd = accept(coordinator->listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+        perror("accept");
+        return 1;
+    }
+
+    int no_delay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    DistributedWorker* worker = &coordinator->workers[coordinator->number_of_workers++];
+    worker->fd        = fd;
+    worker->alive     = true;
+    worker->in_flight = 0;
+
+    return 0;
+}
+
+
+static void spawnLocalWorker(DistributedCoordinator* coordinator, int index)
+{
+    assert(coordinator != NULL);
+
+    const DistributedConfig* config = &coordinator->config;
+
+    int fail_after = (index == 0) ? config->fail_worker_after    : 0;
+    int delay_ms   = (index == 1) ? config->slow_worker_delay_ms : 0;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return;
+    }
+
+    if (pid == 0)
+    {
+        close(coordinator->listen_fd);
+        _exit(runMandelbrotWorker(config->address, fail_after, delay_ms));
+    }
+
+    coordinator->local_pids[coordinator->number_of_local_workers++] = pid;
+}
+
+
+static int sendTile(DistributedCoordinator* coordinator, int worker,
+                    const MandelbrotData* data, int slot)
+{
+    assert(coordinator != NULL);
+    assert(data        != NULL);
+
+    DistributedWorker* current = &coordinator->workers[worker];
+
+    TileRequest request = {};
+    request.magic          = TILE_MESSAGE_MAGIC;
+    request.frame          = coordinator->frame;
+    request.slot           = slot;
+    request.rect           = fieldTileRect(&data->field, slot);
+    request.field_width    = data->field.width;
+    request.field_height   = data->field.height;
+    request.max_iterations = data->max_iterations;
+    request.formula        = data->formula;
+    request.center_x       = data->center_x;
+    request.center_y       = data->center_y;
+    request.width          = data->width;
+    request.height         = data->height;
+    request.julia_re       = data->julia_re;
+    request.julia_im       = data->julia_im;
+
+    if (writeFull(current->fd, &request, sizeof(request)))
+    {
+        return 1;
+    }
+
+    current->slots[current->in_flight]   = slot;
+    current->frames[current->in_flight]  = coordinator->frame;
+    current->rects[current->in_flight]   = request.rect;
+    current->sent_ns[current->in_flight] = SDL_GetTicksNS();
+    current->in_flight++;
+
+    return 0;
+}
+
+
+static int receiveTile(DistributedCoordinator* coordinator, int worker,
+                       MandelbrotData* data, TileSchedule* schedule,
+                       int* tile_buffer, DistributedStatistics* stats)
+{
+    assert(coordinator != NULL);
+    assert(data        != NULL);
+    assert(schedule    != NULL);
+    assert(tile_buffer != NULL);
+    assert(stats       != NULL);
+
+    DistributedWorker* current = &coordinator->workers[worker];
+
+    TileResponse response = {};
+    if (readFull(current->fd, &response, sizeof(response)))
+    {
+        return 1;
+    }
+
+    // ответ сверяется с тем запросом, на который он пришёл: опоздавший
+    // ответ на прошлый кадр мог считаться для поля другого размера
+    const int index = (response.magic == TILE_MESSAGE_MAGIC)
+                    ? findInFlight(current, response.frame, response.slot)
+                    : -1;
+    if (index < 0)
+    {
+        fprintf(stderr, "Worker %d sent malformed tile\n", worker);
+        return 1;
+    }
+
+    const FieldRect rect = current->rects[index];
+    if (memcmp(&rect, &response.rect, sizeof(rect)))
+    {
+        fprintf(stderr, "Worker %d sent tile of wrong size\n", worker);
+        return 1;
+    }
+
+    if (readFull(current->fd, tile_buffer, (size_t)rect.width * rect.height * sizeof(int)))
+    {
+        return 1;
+    }
+
+    forgetTile(current, index);
+
+    stats->busy_ms_per_worker[worker] += (double)response.compute_ns / 1e6;
+
+    // ответ на прошлый кадр или опоздавшая копия уже посчитанной плитки
+    if (response.frame != coordinator->frame || schedule->states[response.slot] == TILE_DONE)
+    {
+        return 0;
+    }
+
+    const FieldRect field_rect = fieldTileRect(&data->field, response.slot);
+    if (memcmp(&rect, &field_rect, sizeof(rect)))
+    {
+        fprintf(stderr, "Worker %d sent tile of wrong size\n", worker);
+        return 1;
+    }
+
+    for (int y = 0; y < rect.height; y++)
+    {
+        fieldStoreSpan(&data->field, rect.x, rect.y + y, tile_buffer + y * rect.width, rect.width);
+    }
+
+    schedule->states[response.slot] = TILE_DONE;
+    schedule->done++;
+    coordinator->tile_cost_ns[response.slot] = response.compute_ns;
+    stats->tiles_per_worker[worker]++;
+
+    return 0;
+}
+
+
+static void dropWorker(DistributedCoordinator* coordinator, int worker,
+                       TileSchedule* schedule, DistributedStatistics* stats)
+{
+    assert(coordinator != NULL);
+    assert(schedule    != NULL);
+    assert(stats       != NULL);
+
+    DistributedWorker* current = &coordinator->workers[worker];
+
+    close(current->fd);
+    current->fd    = -1;
+    current->alive = false;
+    stats->dead_workers++;
+
+    for (int i = 0; i < current->in_flight; i++)
+    {
+        int slot = current->slots[i];
+        if (current->frames[i] != coordinator->frame || schedule->states[slot] == TILE_DONE)
+        {
+            continue;
+        }
+
+        schedule->copies[slot]--;
+        if (schedule->copies[slot] == 0)
+        {
+            schedule->states[slot] = TILE_PENDING;
+            schedule->retry[schedule->retry_count++] = slot;
+            stats->redispatched_tiles++;
+        }
+    }
+
+    current->in_flight = 0;
+}
+
+
+static int findInFlight(const DistributedWorker* worker, uint32_t frame, int slot)
+{
+    assert(worker != NULL);
+
+    for (int i = 0; i < worker->in_flight; i++)
+    {
+        if (worker->slots[i] == slot && worker->frames[i] == frame)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+static void forgetTile(DistributedWorker* worker, int index)
+{
+    assert(worker != NULL);
+    assert(index >= 0 && index < worker->in_flight);
+
+    worker->in_flight--;
+    worker->slots[index]   = worker->slots[worker->in_flight];
+    worker->frames[index]  = worker->frames[worker->in_flight];
+    worker->rects[index]   = worker->rects[worker->in_flight];
+    worker->sent_ns[index] = worker->sent_ns[worker->in_flight];
+}
+
+
+static void finishTilesLocally(MandelbrotData* data, TileSchedule* schedule,
+                               int tiles, DistributedStatistics* stats)
+{
+    assert(data     != NULL);
+    assert(schedule != NULL);
+    assert(stats    != NULL);
+
+    for (int slot = 0; slot < tiles; slot++)
+    {
+        if (schedule->states[slot] != TILE_DONE)
+        {
+            calculateFormulaIterationRectIntrinsics(data, fieldTileRect(&data->field, slot));
+            schedule->states[slot] = TILE_DONE;
+            schedule->done++;
+            stats->local_tiles++;
+        }
+    }
+}
+
+
+static int nextPendingTile(TileSchedule* schedule)
+{
+    assert(schedule != NULL);
+
+    while (schedule->retry_count > 0)
+    {
+        int slot = schedule->retry[--schedule->retry_count];
+        if (schedule->states[slot] == TILE_PENDING)
+        {
+            return slot;
+        }
+    }
+
+    return (schedule->order[schedule->next] >= 0)
+         ? schedule->order[schedule->next++]
+         : -1;
+}
+
+
+// плитка отстаёт, если считается дольше straggler_factor средних плиток;
+// копии получают только плитки, которые пока считает один рабочий
+static int findStraggler(DistributedCoordinator* coordinator, TileSchedule* schedule, uint64_t now)
+{
+    assert(coordinator != NULL);
+    assert(schedule    != NULL);
+
+    uint64_t total_cost = 0;
+    int measured = 0;
+    for (int slot = 0; slot < coordinator->number_of_tiles; slot++)
+    {
+        if (schedule->states[slot] == TILE_DONE)
+        {
+            total_cost += coordinator->tile_cost_ns[slot];
+            measured++;
+        }
+    }
+
+    double threshold_ns = MIN_STRAGGLER_MS * 1e6;
+    if (measured > 0)
+    {
+        double average_ns = (double)total_cost / measured * coordinator->config.straggler_factor;
+        if (average_ns > threshold_ns)
+        {
+            threshold_ns = average_ns;
+        }
+    }
+
+    int      straggler = -1;
+    uint64_t oldest    = now;
+    for (int worker = 0; worker < coordinator->number_of_workers; worker++)
+    {
+        const DistributedWorker* current = &coordinator->workers[worker];
+        if (!current->alive)
+        {
+            continue;
+        }
+
+        for (int i = 0; i < current->in_flight; i++)
+        {
+            int slot = current->slots[i];
+            if (current->frames[i] == coordinator->frame
+             && schedule->copies[slot] == 1 && schedule->states[slot] == TILE_IN_FLIGHT
+             && (double)(now - current->sent_ns[i]) > threshold_ns && current->sent_ns[i] < oldest)
+            {
+                oldest    = current->sent_ns[i];
+                straggler = slot;
+            }
+        }
+    }
+
+    return straggler;
+}
+
+
+static void orderTilesByCost(DistributedCoordinator* coordinator, TileSchedule* schedule)
+{
+    assert(coordinator != NULL);
+    assert(schedule    != NULL);
+
+    const int tiles = coordinator->number_of_tiles;
+
+    // в старших битах инвертированная стоимость, в младших номер плитки;
+    // без замеров порядок остаётся порядком хранения
+    uint64_t* keys = (uint64_t*)calloc(tiles, sizeof(uint64_t));
+    assert(keys != NULL);
+
+    for (int slot = 0; slot < tiles; slot++)
+    {
+        uint64_t cost_us = coordinator->tile_cost_ns[slot] / 1000;
+        if (cost_us > 0xFFFFFFFF)
+        {
+            cost_us = 0xFFFFFFFF;
+        }
+        keys[slot] = ((0xFFFFFFFF - cost_us) << 32) | (uint32_t)slot;
+    }
+
+    qsort(keys, tiles, sizeof(uint64_t), compareCostKeys);
+
+    for (int i = 0; i < tiles; i++)
+    {
+        schedule->order[i] = (int)(keys[i] & 0xFFFFFFFF);
+    }
+    schedule->order[tiles] = -1;
+
+    free(keys);
+}
+
+
+static int compareCostKeys(const void* a, const void* b)
+{
+    uint64_t lhs = *(const uint64_t*)a;
+    uint64_t rhs = *(const uint64_t*)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+
+// запрос приходит из сети, поэтому проверяется всё, что попадает в
+// размеры поля и индексы пикселей; SIMD ядро пишет по 8 точек строки
+static bool validTileRequest(const TileRequest* request)
+{
+    assert(request != NULL);
+
+    const FieldRect rect = request->rect;
+
+    return request->magic == TILE_MESSAGE_MAGIC
+        && request->formula >= 0 && request->formula < FORMULA_COUNT
+        && request->max_iterations >= 1 && request->max_iterations <= MAX_DISTRIBUTED_ITERATIONS
+        && request->field_width  > 0 && request->field_width  <= MAX_DISTRIBUTED_FIELD_SIDE
+        && request->field_width % 16 == 0
+        && request->field_height > 0 && request->field_height <= MAX_DISTRIBUTED_FIELD_SIDE
+        && rect.width  > 0 && rect.width  <= FIELD_TILE_SIZE
+        && rect.height > 0 && rect.height <= FIELD_TILE_SIZE
+        && rect.x % 8 == 0 && rect.width % 8 == 0
+        && rect.x >= 0 && rect.x <= request->field_width  - rect.width
+        && rect.y >= 0 && rect.y <= request->field_height - rect.height;
+}
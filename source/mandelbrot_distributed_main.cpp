@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mandelbrot_distributed.h"
+#include "mandelbrot_utils.h"
+#include "mandelbrot_logic_formula.h"
+
+
+// Координатор с рабочими на этой же машине:
+//     mandel_distributed --workers 4 --frames 5 --verify
+// Рабочий для чужого координатора:
+//     mandel_distributed --worker tcp:127.0.0.1:5555
+
+static const char* DEFAULT_ADDRESS = "unix:/tmp/mandel_distributed.sock";
+
+static const int    DEFAULT_FRAMES      = 3;
+static const int    DEFAULT_FIELD_WIDTH  = 3840;
+static const int    DEFAULT_FIELD_HEIGHT = 2160;
+static const double FRAME_ZOOM_FACTOR   = 1.5;
+
+static int verifyField(MandelbrotData* data);
+
+
+int main(int argc, char* argv[])
+{
+    DistributedConfig config = {};
+    setDefaultDistributedConfig(&config, DEFAULT_ADDRESS);
+
+    const char* worker_address = NULL;
+    int  remote_workers = 0;
+    int  frames = DEFAULT_FRAMES;
+    int  field_width  = DEFAULT_FIELD_WIDTH;
+    int  field_height = DEFAULT_FIELD_HEIGHT;
+    bool verify = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--worker") && has_value)
+        {
+            worker_address = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--address") && has_value)
+        {
+            config.address = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--workers") && has_value)
+        {
+            config.local_workers = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--remote-workers") && has_value)
+        {
+            remote_workers = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--depth") && has_value)
+        {
+            config.pipeline_depth = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--frames") && has_value)
+        {
+            frames = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--size") && has_value)
+        {
+            if (sscanf(argv[++i], "%dx%d", &field_width, &field_height) != 2
+             || field_width <= 0 || field_width % 16 || field_height <= 0)
+            {
+                fprintf(stderr, "Size must be WIDTHxHEIGHT with width divisible by 16\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--fail-after") && has_value)
+        {
+            config.fail_worker_after = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--slow-ms") && has_value)
+        {
+            config.slow_worker_delay_ms = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--verify"))
+        {
+            verify = true;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (worker_address)
+    {
+        return runMandelbrotWorker(worker_address, 0, 0);
+    }
+
+    config.expected_workers = config.local_workers + remote_workers;
+
+    MandelbrotData data = {};
+    if (setDefaultMandelbrot(&data)
+     || setMandelbrotField(&data, field_width, field_height, FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS))
+    {
+        return 1;
+    }
+
+    DistributedCoordinator coordinator = {};
+    if (startCoordinator(&coordinator, &config))
+    {
+        freeMandelbrot(&data);
+        return 1;
+    }
+
+    int return_code = 0;
+
+    // каждый следующий кадр приближается к границе множества, так что
+    // раздача плиток по стоимости прошлого кадра работает как в анимации
+    for (int frame = 0; frame < frames && !return_code; frame++)
+    {
+        DistributedStatistics stats = {};
+        if (renderDistributed(&coordinator, &data, &stats))
+        {
+            return_code = 1;
+            break;
+        }
+
+        printf("frame %d, zoom %.2f: ", frame, data.zoom);
+        printDistributedStatistics(stdout, &stats);
+
+        if (verify && verifyField(&data))
+        {
+            return_code = 1;
+        }
+
+        data.zoom     *= FRAME_ZOOM_FACTOR;
+        data.center_x += (-0.7453 - data.center_x) / 2;
+        data.center_y += ( 0.1127 - data.center_y) / 2;
+        updateDimension(&data);
+    }
+
+    stopCoordinator(&coordinator);
+    freeMandelbrot(&data);
+
+    return return_code;
+}
+
+
+static int verifyField(MandelbrotData* data)
+{
+    MandelbrotData reference = *data;
+    reference.field = {};
+    reference.distance_per_pixel = NULL;
+
+    if (createIterationField(&reference.field, data->field.width, data->field.height,
+                             FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS))
+    {
+        return 1;
+    }
+
+    calculateFormulaIterationFieldIntrinsics(&reference);
+
+    long long mismatches = 0;
+    for (int y = 0; y < data->field.height; y++)
+    {
+        for (int x = 0; x < data->field.width; x++)
+        {
+            mismatches += fieldLoad(&data->field, x, y) != fieldLoad(&reference.field, x, y);
+        }
+    }
+
+    destroyIterationField(&reference.field);
+
+    if (mismatches)
+    {
+        fprintf(stderr, "Distributed field differs from local render in %lld pixels\n", mismatches);
+        return 1;
+    }
+
+    printf("    matches single-process render\n");
+    return 0;
+}
@@ -0,0 +1,431 @@
+#include "mandelbrot_engine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <new>
+
+#include "mandelbrot_utils.h"
+#include "mandelbrot_logic_formula.h"
+#include "mandelbrot_colorize.h"
+#include "mandelbrot_memory.h"
+
+
+// свой пул кадров у каждого движка; буферы держат его через shared_ptr,
+// поэтому он живёт, пока жив последний буфер
+struct BufferPool
+{
+    FramePool* frames;
+
+    BufferPool();
+    ~BufferPool();
+};
+
+struct RenderJob
+{
+    MandelbrotEngine* engine;
+    MandelbrotData    data;
+    RenderViewport    viewport;
+    bool              want_image;
+
+    FieldBuffer       field;
+    ImageBuffer       image;
+
+    // результат уходит либо в promise, либо в ожидающую корутину
+    std::promise<FieldBuffer> field_promise;
+    std::promise<ImageBuffer> image_promise;
+    std::coroutine_handle<>   continuation;
+    FieldBuffer*              field_result;
+    ImageBuffer*              image_result;
+
+    // друзья движка и буферов, поэтому живут здесь, а не в static
+    static RenderJob* create(MandelbrotEngine* engine,
+                             const RenderViewport& viewport,
+                             const uint32_t* palette,
+                             bool want_image);
+    static void run(void* context, int index);
+    static void renderTile(void* context, int slot);
+    static int  allocateBuffers(RenderJob* job, const std::shared_ptr<BufferPool>& pool);
+};
+
+
+// static ----------------------------------------------------------------------
+
+
+static void* acquireBuffer(BufferPool* pool, size_t bytes);
+static void  releaseBuffer(BufferPool* pool, void* buffer, size_t bytes);
+
+
+// public ----------------------------------------------------------------------
+
+
+void setDefaultRenderViewport(RenderViewport* viewport, int width, int height)
+{
+    assert(viewport != NULL);
+
+    viewport->width          = width;
+    viewport->height         = height;
+    viewport->center_x       = DEFAULT_CENTER_X;
+    viewport->center_y       = DEFAULT_CENTER_Y;
+    viewport->view_width     = DEFAULT_WIDTH / DEFAULT_ZOOM;
+    viewport->max_iterations = MAX_ITERATIONS;
+    viewport->formula        = FORMULA_MANDELBROT;
+    viewport->julia_re       = DEFAULT_JULIA_RE;
+    viewport->julia_im       = DEFAULT_JULIA_IM;
+    viewport->layout         = FIELD_LAYOUT_TILED;
+}
+
+
+FieldBuffer::FieldBuffer() : field(), viewport(), pool() {}
+
+
+FieldBuffer::FieldBuffer(FieldBuffer&& other) noexcept
+    : field(other.field), viewport(other.viewport), pool(static_cast<std::shared_ptr<BufferPool>&&>(other.pool))
+{
+    memset(&other.field, 0, sizeof(other.field));
+}
+
+
+FieldBuffer& FieldBuffer::operator=(FieldBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        this->~FieldBuffer();
+        new (this) FieldBuffer(static_cast<FieldBuffer&&>(other));
+    }
+
+    return *this;
+}
+
+
+FieldBuffer::~FieldBuffer()
+{
+    if (!field.tile_slots)
+    {
+        return;
+    }
+
+    void*  data  = field.data;
+    size_t bytes = field.bytes;
+
+    destroyIterationField(&field);
+    releaseBuffer(pool.get(), data, bytes);
+}
+
+
+ImageBuffer::ImageBuffer() : pixels(NULL), width(0), height(0), pitch(0), viewport(), pool(), bytes(0) {}
+
+
+ImageBuffer::ImageBuffer(ImageBuffer&& other) noexcept
+    : pixels(other.pixels), width(other.width), height(other.height), pitch(other.pitch),
+      viewport(other.viewport), pool(static_cast<std::shared_ptr<BufferPool>&&>(other.pool)),
+      bytes(other.bytes)
+{
+    other.pixels = NULL;
+    other.bytes  = 0;
+}
+
+
+ImageBuffer& ImageBuffer::operator=(ImageBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        this->~ImageBuffer();
+        new (this) ImageBuffer(static_cast<ImageBuffer&&>(other));
+    }
+
+    return *this;
+}
+
+
+ImageBuffer::~ImageBuffer()
+{
+    if (pixels)
+    {
+        releaseBuffer(pool.get(), pixels, bytes);
+    }
+}
+
+
+MandelbrotEngine::MandelbrotEngine(int threads)
+    : pool(createThreadPool(threads > 0 ? threads : defaultThreadCount())),
+      buffers(std::make_shared<BufferPool>()),
+      active_jobs(0)
+{
+    MandelbrotData palette_data = {};
+    setMandelbrotPalette(&palette_data);
+    memcpy(default_palette, palette_data.colors, sizeof(default_palette));
+}
+
+
+// ждёт все отправленные задачи; движок нельзя уничтожать из его же пула
+MandelbrotEngine::~MandelbrotEngine()
+{
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        jobs_done.wait(guard, [this] { return active_jobs == 0; });
+    }
+
+    destroyThreadPool(pool);
+}
+
+
+std::future<FieldBuffer> MandelbrotEngine::renderField(const RenderViewport& viewport)
+{
+    RenderJob* job = RenderJob::create(this, viewport, NULL, false);
+    std::future<FieldBuffer> result = job->field_promise.get_future();
+
+    submit(job);
+
+    return result;
+}
+
+
+std::future<ImageBuffer> MandelbrotEngine::renderImage(const RenderViewport& viewport, const uint32_t* palette)
+{
+    RenderJob* job = RenderJob::create(this, viewport, palette, true);
+    std::future<ImageBuffer> result = job->image_promise.get_future();
+
+    submit(job);
+
+    return result;
+}
+
+
+RenderAwaitable<FieldBuffer> MandelbrotEngine::fieldAwaitable(const RenderViewport& viewport)
+{
+    return RenderAwaitable<FieldBuffer>(this, viewport, NULL);
+}
+
+
+RenderAwaitable<ImageBuffer> MandelbrotEngine::imageAwaitable(const RenderViewport& viewport,
+                                                              const uint32_t* palette)
+{
+    return RenderAwaitable<ImageBuffer>(this, viewport, palette);
+}
+
+
+template <>
+void RenderAwaitable<FieldBuffer>::await_suspend(std::coroutine_handle<> continuation)
+{
+    RenderJob* job = RenderJob::create(engine, viewport, NULL, false);
+    job->continuation = continuation;
+    job->field_result = &result;
+
+    engine->submit(job);
+}
+
+
+template <>
+void RenderAwaitable<ImageBuffer>::await_suspend(std::coroutine_handle<> continuation)
+{
+    RenderJob* job = RenderJob::create(engine, viewport, palette, true);
+    job->continuation = continuation;
+    job->image_result = &result;
+
+    engine->submit(job);
+}
+
+
+void MandelbrotEngine::submit(RenderJob* job)
+{
+    assert(job != NULL);
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        active_jobs++;
+    }
+
+    if (submitTask(pool, RenderJob::run, job, 0))
+    {
+        RenderJob::run(job, 0);
+    }
+}
+
+
+void MandelbrotEngine::finish(RenderJob* job)
+{
+    assert(job != NULL);
+
+    std::coroutine_handle<> continuation = job->continuation;
+
+    if (continuation && job->want_image)
+    {
+        *job->image_result = static_cast<ImageBuffer&&>(job->image);
+    }
+    else if (continuation)
+    {
+        *job->field_result = static_cast<FieldBuffer&&>(job->field);
+    }
+    else if (job->want_image)
+    {
+        job->image_promise.set_value(static_cast<ImageBuffer&&>(job->image));
+    }
+    else
+    {
+        job->field_promise.set_value(static_cast<FieldBuffer&&>(job->field));
+    }
+
+    // поле задачи с картинкой здесь же возвращается в пул
+    delete job;
+
+    if (continuation)
+    {
+        continuation.resume();
+    }
+
+    // под мьютексом: иначе ожидающий деструктор может уничтожить
+    // jobs_done раньше notify_all
+    std::lock_guard<std::mutex> guard(lock);
+    active_jobs--;
+    jobs_done.notify_all();
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+RenderJob* RenderJob::create(MandelbrotEngine* engine,
+                             const RenderViewport& viewport,
+                             const uint32_t* palette,
+                             bool want_image)
+{
+    assert(engine != NULL);
+    assert(viewport.width > 0 && viewport.width % 16 == 0);
+    assert(viewport.height > 0);
+
+    RenderJob* job = new RenderJob();
+    job->engine     = engine;
+    job->viewport   = viewport;
+    job->want_image = want_image;
+
+    MandelbrotData* data = &job->data;
+    data->max_iterations = viewport.max_iterations;
+    data->formula        = viewport.formula;
+    data->julia_re       = viewport.julia_re;
+    data->julia_im       = viewport.julia_im;
+    data->center_x       = viewport.center_x;
+    data->center_y       = viewport.center_y;
+    data->width          = viewport.view_width;
+    data->height         = viewport.view_width * viewport.height / viewport.width;
+    data->zoom           = DEFAULT_WIDTH / viewport.view_width;
+
+    memcpy(data->colors, palette ? palette : engine->default_palette, sizeof(data->colors));
+
+    return job;
+}
+
+
+// плитки задачи раздаются тому же пулу; если все его потоки заняты
+// другими задачами, поток задачи считает плитки сам
+void RenderJob::run(void* context, int)
+{
+    assert(context != NULL);
+
+    RenderJob* job = (RenderJob*)context;
+
+    if (allocateBuffers(job, job->engine->buffers) == 0)
+    {
+        runParallel(job->engine->pool, fieldTileCount(&job->data.field), RenderJob::renderTile, job);
+    }
+
+    job->engine->finish(job);
+}
+
+
+void RenderJob::renderTile(void* context, int slot)
+{
+    assert(context != NULL);
+
+    RenderJob* job = (RenderJob*)context;
+    FieldRect rect = fieldTileRect(&job->data.field, slot);
+
+    calculateFormulaIterationRectIntrinsics(&job->data, rect);
+
+    if (job->want_image)
+    {
+        colorizeIterationRect(job->image.pitch, job->image.pixels, &job->data, rect);
+    }
+}
+
+
+int RenderJob::allocateBuffers(RenderJob* job, const std::shared_ptr<BufferPool>& pool)
+{
+    assert(job != NULL);
+
+    const RenderViewport& viewport = job->viewport;
+    const FieldFormat format = chooseFieldFormat(viewport.max_iterations);
+    const size_t field_bytes = iterationFieldBytes(viewport.width, viewport.height, format, viewport.layout);
+
+    void* field_data = acquireBuffer(pool.get(), field_bytes);
+    if (!field_data)
+    {
+        fprintf(stderr, "Error while allocating memory for render job\n");
+        return 1;
+    }
+    if (attachIterationField(&job->field.field, field_data,
+                             viewport.width, viewport.height, format, viewport.layout))
+    {
+        releaseBuffer(pool.get(), field_data, field_bytes);
+        return 1;
+    }
+    job->field.pool     = pool;
+    job->field.viewport = viewport;
+    job->data.field     = job->field.field;
+
+    if (!job->want_image)
+    {
+        return 0;
+    }
+
+    ImageBuffer* image = &job->image;
+    image->pitch  = viewport.width * sizeof(uint32_t);
+    image->bytes  = (size_t)image->pitch * viewport.height;
+    image->pixels = (uint32_t*)acquireBuffer(pool.get(), image->bytes);
+    if (!image->pixels)
+    {
+        fprintf(stderr, "Error while allocating memory for render job\n");
+        return 1;
+    }
+    image->width    = viewport.width;
+    image->height   = viewport.height;
+    image->viewport = viewport;
+    image->pool     = pool;
+
+    return 0;
+}
+
+
+static void* acquireBuffer(BufferPool* pool, size_t bytes)
+{
+    assert(pool != NULL);
+
+    return pool->frames ? acquireFrameBuffer(pool->frames, bytes) : NULL;
+}
+
+
+static void releaseBuffer(BufferPool* pool, void* buffer, size_t bytes)
+{
+    assert(pool   != NULL);
+    assert(buffer != NULL);
+
+    releaseFrameBuffer(pool->frames, buffer, bytes);
+}
+
+
+BufferPool::BufferPool()
+{
+    FramePoolConfig config = {};
+    setDefaultFramePoolConfig(&config);
+    config.max_buffers = ENGINE_POOLED_BUFFERS;
+
+    frames = createFramePool(&config);
+}
+
+
+BufferPool::~BufferPool()
+{
+    destroyFramePool(frames);
+}
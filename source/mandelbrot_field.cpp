@@ -0,0 +1,250 @@
+#include "mandelbrot_field.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "mandelbrot_memory.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+static uint32_t mortonCode(uint32_t x, uint32_t y);
+static uint32_t spreadBits(uint32_t value);
+static void     orderTiles(IterationField* field);
+static int      compareKeys(const void* a, const void* b);
+
+
+// public ----------------------------------------------------------------------
+
+
+int createIterationField(IterationField* field,
+                         int width,
+                         int height,
+                         FieldFormat format,
+                         FieldLayout layout)
+{
+    assert(field != NULL);
+
+    const size_t bytes = iterationFieldBytes(width, height, format, layout);
+
+    void* data = acquireFrameBuffer(defaultFramePool(), bytes);
+    if (!data)
+    {
+        fprintf(stderr, "Error while allocating memory for iterations field");
+        return 1;
+    }
+
+    if (attachIterationField(field, data, width, height, format, layout))
+    {
+        releaseFrameBuffer(defaultFramePool(), data, bytes);
+        return 1;
+    }
+    field->external_data = false;
+
+    return 0;
+}
+
+
+int attachIterationField(IterationField* field,
+                         void* data,
+                         int width,
+                         int height,
+                         FieldFormat format,
+                         FieldLayout layout)
+{
+    assert(field != NULL);
+    assert(data  != NULL);
+    assert((uintptr_t)data % 32 == 0);
+    assert(width  > 0 && width % 16 == 0 && "field width must be a multiple of 16");
+    assert(height > 0);
+
+    field->data    = data;
+    field->bytes   = iterationFieldBytes(width, height, format, layout);
+    field->width   = width;
+    field->height  = height;
+    field->format  = format;
+    field->layout  = layout;
+    field->tiles_x = (width  + FIELD_TILE_SIZE - 1) / FIELD_TILE_SIZE;
+    field->tiles_y = (height + FIELD_TILE_SIZE - 1) / FIELD_TILE_SIZE;
+    field->external_data = true;
+
+    const int tiles = field->tiles_x * field->tiles_y;
+    field->tile_slots = (int*)calloc(tiles, sizeof(int));
+    field->slot_tiles = (int*)calloc(tiles, sizeof(int));
+
+    if (!field->tile_slots || !field->slot_tiles)
+    {
+        fprintf(stderr, "Error while allocating memory for iterations field");
+        free(field->tile_slots);
+        free(field->slot_tiles);
+        field->tile_slots = NULL;
+        field->slot_tiles = NULL;
+        field->data = NULL;
+        return 1;
+    }
+
+    orderTiles(field);
+
+    return 0;
+}
+
+
+void destroyIterationField(IterationField* field)
+{
+    assert(field != NULL);
+
+    if (!field->external_data && field->data)
+    {
+        releaseFrameBuffer(defaultFramePool(), field->data, field->bytes);
+    }
+    free(field->tile_slots);
+    free(field->slot_tiles);
+
+    field->data = NULL;
+    field->tile_slots = NULL;
+    field->slot_tiles = NULL;
+    field->bytes = 0;
+}
+
+
+size_t iterationFieldBytes(int width, int height, FieldFormat format, FieldLayout layout)
+{
+    const size_t element_size = (format == FIELD_FORMAT_U16) ? sizeof(uint16_t) : sizeof(int);
+
+    // плиточные раскладки хранят крайние плитки целиком
+    size_t elements = (size_t)width * height;
+    if (layout != FIELD_LAYOUT_ROWS)
+    {
+        const size_t tiles_x = (width  + FIELD_TILE_SIZE - 1) / FIELD_TILE_SIZE;
+        const size_t tiles_y = (height + FIELD_TILE_SIZE - 1) / FIELD_TILE_SIZE;
+        elements = tiles_x * tiles_y * FIELD_TILE_AREA;
+    }
+
+    return (elements * element_size + 31) / 32 * 32;
+}
+
+
+FieldFormat chooseFieldFormat(int max_iterations)
+{
+    return (max_iterations <= FIELD_U16_MAX_ITERATIONS) ? FIELD_FORMAT_U16 : FIELD_FORMAT_I32;
+}
+
+
+bool fieldFitsIterations(const IterationField* field, int max_iterations)
+{
+    assert(field != NULL);
+
+    return field->format == FIELD_FORMAT_I32 || max_iterations <= FIELD_U16_MAX_ITERATIONS;
+}
+
+
+FieldRect fieldRect(const IterationField* field)
+{
+    assert(field != NULL);
+
+    FieldRect rect = {0, 0, field->width, field->height};
+    return rect;
+}
+
+
+int fieldTileCount(const IterationField* field)
+{
+    assert(field != NULL);
+
+    return field->tiles_x * field->tiles_y;
+}
+
+
+FieldRect fieldTileRect(const IterationField* field, int slot)
+{
+    assert(field != NULL);
+    assert(slot >= 0 && slot < fieldTileCount(field));
+
+    const int tile = field->slot_tiles[slot];
+    const int x = (tile % field->tiles_x) * FIELD_TILE_SIZE;
+    const int y = (tile / field->tiles_x) * FIELD_TILE_SIZE;
+
+    FieldRect rect = {x, y, FIELD_TILE_SIZE, FIELD_TILE_SIZE};
+    if (x + rect.width > field->width)
+    {
+        rect.width = field->width - x;
+    }
+    if (y + rect.height > field->height)
+    {
+        rect.height = field->height - y;
+    }
+
+    return rect;
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static void orderTiles(IterationField* field)
+{
+    assert(field != NULL);
+
+    const int tiles = field->tiles_x * field->tiles_y;
+
+    for (int tile = 0; tile < tiles; tile++)
+    {
+        field->slot_tiles[tile] = tile;
+    }
+
+    if (field->layout == FIELD_LAYOUT_MORTON)
+    {
+        // в старших битах код Мортона, в младших номер плитки
+        uint64_t* keys = (uint64_t*)calloc(tiles, sizeof(uint64_t));
+        assert(keys != NULL);
+
+        for (int tile = 0; tile < tiles; tile++)
+        {
+            uint64_t code = mortonCode(tile % field->tiles_x, tile / field->tiles_x);
+            keys[tile] = (code << 32) | (uint32_t)tile;
+        }
+
+        qsort(keys, tiles, sizeof(uint64_t), compareKeys);
+
+        for (int slot = 0; slot < tiles; slot++)
+        {
+            field->slot_tiles[slot] = (int)(keys[slot] & 0xFFFFFFFF);
+        }
+
+        free(keys);
+    }
+
+    for (int slot = 0; slot < tiles; slot++)
+    {
+        field->tile_slots[field->slot_tiles[slot]] = slot;
+    }
+}
+
+
+static uint32_t mortonCode(uint32_t x, uint32_t y)
+{
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+
+static uint32_t spreadBits(uint32_t value)
+{
+    value &= 0x0000FFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+
+    return value;
+}
+
+
+static int compareKeys(const void* a, const void* b)
+{
+    uint64_t lhs = *(const uint64_t*)a;
+    uint64_t rhs = *(const uint64_t*)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
@@ -0,0 +1,605 @@
+#include "mandelbrot_field_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <atomic>
+
+#include <SDL3/SDL.h>
+
+#include "mandelbrot_utils.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+typedef struct FieldFileRenderContext
+{
+    FieldFile*            file;
+    MandelbrotData        data;
+    IterationRectFunction rect_func;
+    int                   tile_limit;
+    std::atomic<int>      claimed;
+    std::atomic<int>      rendered;
+} FieldFileRenderContext;
+
+static size_t alignToPage(size_t bytes);
+static size_t bitsBytes(int tiles);
+static size_t elementSize(FieldFormat format);
+static int    countTiles(int width, int height);
+
+static void runFieldFileTask(void* context, int slot);
+static void markFieldTileDone(FieldFile* file, int slot);
+
+static size_t encodeBlock(const uint8_t* source, size_t elements, size_t element_size, uint8_t* output);
+static int    decodeBlock(const uint8_t* source, size_t bytes, size_t element_size,
+                          uint8_t* output, size_t elements);
+
+
+// public ----------------------------------------------------------------------
+
+
+int createFieldFile(FieldFile* file,
+                    const char* path,
+                    const MandelbrotData* data,
+                    int width,
+                    int height,
+                    FieldFormat format,
+                    FieldLayout layout)
+{
+    assert(file != NULL);
+    assert(path != NULL);
+    assert(data != NULL);
+
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+
+    file->tiles = countTiles(width, height);
+
+    const size_t bits_offset = FIELD_FILE_ALIGNMENT;
+    const size_t data_offset = bits_offset + alignToPage(bitsBytes(file->tiles));
+    const size_t data_bytes  = iterationFieldBytes(width, height, format, layout);
+
+    file->map_bytes = data_offset + alignToPage(data_bytes);
+    file->writable  = true;
+
+    file->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file->fd < 0)
+    {
+        fprintf(stderr, "Error while creating %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    // файл разреженный: место под поле занимают только посчитанные плитки
+    if (ftruncate(file->fd, file->map_bytes))
+    {
+        fprintf(stderr, "Error while resizing %s: %s\n", path, strerror(errno));
+        closeFieldFile(file);
+        return 1;
+    }
+
+    file->map = mmap(NULL, file->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+    if (file->map == MAP_FAILED)
+    {
+        fprintf(stderr, "Error while mapping %s: %s\n", path, strerror(errno));
+        file->map = NULL;
+        closeFieldFile(file);
+        return 1;
+    }
+
+    FieldFileHeader* header = (FieldFileHeader*)file->map;
+    header->version        = FIELD_FILE_VERSION;
+    header->compression    = FIELD_COMPRESSION_NONE;
+    header->width          = width;
+    header->height         = height;
+    header->format         = format;
+    header->layout         = layout;
+    header->max_iterations = data->max_iterations;
+    header->formula        = data->formula;
+    header->center_x       = data->center_x;
+    header->center_y       = data->center_y;
+    header->view_width     = data->width;
+    header->view_height    = data->height;
+    header->julia_re       = data->julia_re;
+    header->julia_im       = data->julia_im;
+    header->bits_offset    = bits_offset;
+    header->data_offset    = data_offset;
+    header->data_bytes     = data_bytes;
+    header->magic          = FIELD_FILE_MAGIC;
+
+    file->header    = header;
+    file->done_bits = (uint64_t*)((uint8_t*)file->map + bits_offset);
+
+    if (attachIterationField(&file->field, (uint8_t*)file->map + data_offset,
+                             width, height, format, layout))
+    {
+        closeFieldFile(file);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int openFieldFile(FieldFile* file, const char* path, bool writable)
+{
+    assert(file != NULL);
+    assert(path != NULL);
+
+    memset(file, 0, sizeof(*file));
+    file->writable = writable;
+
+    file->fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (file->fd < 0)
+    {
+        fprintf(stderr, "Error while opening %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    struct stat info = {};
+    if (fstat(file->fd, &info) || (size_t)info.st_size < sizeof(FieldFileHeader))
+    {
+        fprintf(stderr, "%s is not an iteration field file\n", path);
+        closeFieldFile(file);
+        return 1;
+    }
+    file->map_bytes = info.st_size;
+
+    // читателю нужен весь файл сразу, так что страницы подгружаются заранее
+    const int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    const int flags      = writable ? MAP_SHARED : MAP_SHARED | MAP_POPULATE;
+
+    file->map = mmap(NULL, file->map_bytes, protection, flags, file->fd, 0);
+    if (file->map == MAP_FAILED)
+    {
+        fprintf(stderr, "Error while mapping %s: %s\n", path, strerror(errno));
+        file->map = NULL;
+        closeFieldFile(file);
+        return 1;
+    }
+
+    FieldFileHeader* header = (FieldFileHeader*)file->map;
+
+    const bool valid_header = header->magic   == FIELD_FILE_MAGIC
+                           && header->version == FIELD_FILE_VERSION
+                           && header->width  > 0 && header->width % 16 == 0
+                           && header->height > 0
+                           && (header->format == FIELD_FORMAT_I32 || header->format == FIELD_FORMAT_U16)
+                           && header->layout >= FIELD_LAYOUT_ROWS && header->layout <= FIELD_LAYOUT_MORTON
+                           && (header->compression == FIELD_COMPRESSION_NONE
+                            || header->compression == FIELD_COMPRESSION_RLE);
+
+    file->tiles = valid_header ? countTiles(header->width, header->height) : 0;
+
+    const bool valid_sizes = valid_header
+                          && header->bits_offset % FIELD_FILE_ALIGNMENT == 0
+                          && header->data_offset % FIELD_FILE_ALIGNMENT == 0
+                          && header->bits_offset + bitsBytes(file->tiles) <= header->data_offset
+                          && header->data_offset + header->data_bytes <= file->map_bytes;
+
+    if (!valid_sizes)
+    {
+        fprintf(stderr, "%s is not an iteration field file or is damaged\n", path);
+        closeFieldFile(file);
+        return 1;
+    }
+
+    file->header    = header;
+    file->done_bits = (uint64_t*)((uint8_t*)file->map + header->bits_offset);
+
+    if (header->compression == FIELD_COMPRESSION_NONE)
+    {
+        if (header->data_bytes != iterationFieldBytes(header->width, header->height,
+                                                      (FieldFormat)header->format,
+                                                      (FieldLayout)header->layout)
+         || attachIterationField(&file->field, (uint8_t*)file->map + header->data_offset,
+                                 header->width, header->height,
+                                 (FieldFormat)header->format, (FieldLayout)header->layout))
+        {
+            fprintf(stderr, "%s has wrong field size\n", path);
+            closeFieldFile(file);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+void closeFieldFile(FieldFile* file)
+{
+    assert(file != NULL);
+
+    if (file->field.tile_slots)
+    {
+        destroyIterationField(&file->field);
+    }
+
+    if (file->map)
+    {
+        if (file->writable)
+        {
+            msync(file->map, file->map_bytes, MS_SYNC);
+        }
+        munmap(file->map, file->map_bytes);
+    }
+
+    if (file->fd >= 0)
+    {
+        close(file->fd);
+    }
+
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+}
+
+
+bool fieldFileMatches(const FieldFile* file,
+                      const MandelbrotData* data,
+                      int width,
+                      int height,
+                      FieldFormat format,
+                      FieldLayout layout)
+{
+    assert(file != NULL);
+    assert(data != NULL);
+
+    const FieldFileHeader* header = file->header;
+
+    return header->width          == width
+        && header->height         == height
+        && header->format         == format
+        && header->layout         == layout
+        && header->max_iterations == data->max_iterations
+        && header->formula        == data->formula
+        && header->center_x       == data->center_x
+        && header->center_y       == data->center_y
+        && header->view_width     == data->width
+        && header->view_height    == data->height
+        && header->julia_re       == data->julia_re
+        && header->julia_im       == data->julia_im;
+}
+
+
+void loadFieldFileViewport(const FieldFile* file, MandelbrotData* data)
+{
+    assert(file != NULL);
+    assert(data != NULL);
+
+    const FieldFileHeader* header = file->header;
+
+    data->max_iterations = header->max_iterations;
+    data->formula        = (FormulaType)header->formula;
+    data->center_x       = header->center_x;
+    data->center_y       = header->center_y;
+    data->width          = header->view_width;
+    data->height         = header->view_height;
+    data->julia_re       = header->julia_re;
+    data->julia_im       = header->julia_im;
+}
+
+
+bool fieldTileDone(const FieldFile* file, int slot)
+{
+    assert(file != NULL);
+    assert(slot >= 0 && slot < file->tiles);
+
+    uint64_t word = __atomic_load_n(&file->done_bits[slot / 64], __ATOMIC_ACQUIRE);
+
+    return (word >> (slot % 64)) & 1;
+}
+
+
+int fieldFileTilesDone(const FieldFile* file)
+{
+    assert(file != NULL);
+
+    int done = 0;
+    for (int word = 0; word < (file->tiles + 63) / 64; word++)
+    {
+        done += __builtin_popcountll(file->done_bits[word]);
+    }
+
+    return done;
+}
+
+
+void renderFieldFile(FieldFile* file,
+                     const MandelbrotData* data,
+                     IterationRectFunction rect_func,
+                     ThreadPool* pool,
+                     int tile_limit,
+                     FieldFileStatistics* stats)
+{
+    assert(file      != NULL);
+    assert(data      != NULL);
+    assert(rect_func != NULL);
+    assert(stats     != NULL);
+    assert(file->writable);
+    assert(file->header->compression == FIELD_COMPRESSION_NONE);
+
+    memset(stats, 0, sizeof(*stats));
+
+    const uint64_t start = SDL_GetPerformanceCounter();
+
+    FieldFileRenderContext context;
+    context.file       = file;
+    context.data       = *data;
+    context.data.field = file->field;
+    context.rect_func  = rect_func;
+    context.tile_limit = tile_limit;
+    context.claimed    = 0;
+    context.rendered   = 0;
+
+    stats->tiles         = file->tiles;
+    stats->tiles_resumed = fieldFileTilesDone(file);
+
+    runParallel(pool, file->tiles, runFieldFileTask, &context);
+
+    stats->tiles_rendered = context.rendered;
+    stats->ms = elapsedMs(start);
+}
+
+
+int compressFieldFile(const FieldFile* file, const char* path)
+{
+    assert(file != NULL);
+    assert(path != NULL);
+
+    const FieldFileHeader* source = file->header;
+    if (source->compression != FIELD_COMPRESSION_NONE)
+    {
+        fprintf(stderr, "Field file is already compressed\n");
+        return 1;
+    }
+
+    const size_t element_size = elementSize((FieldFormat)source->format);
+    const size_t elements     = source->data_bytes / element_size;
+    const size_t blocks       = (elements + FIELD_TILE_AREA - 1) / FIELD_TILE_AREA;
+
+    // серия не длиннее блока, так что худший случай - серии длины 1
+    uint64_t* offsets = (uint64_t*)calloc(blocks + 1, sizeof(uint64_t));
+    uint8_t*  encoded = (uint8_t*)malloc(elements * (sizeof(uint16_t) + element_size));
+    if (!offsets || !encoded)
+    {
+        fprintf(stderr, "Error while allocating memory for compression\n");
+        free(offsets);
+        free(encoded);
+        return 1;
+    }
+
+    const uint8_t* raw = (const uint8_t*)file->map + source->data_offset;
+    for (size_t block = 0; block < blocks; block++)
+    {
+        size_t first = block * FIELD_TILE_AREA;
+        size_t count = (elements - first < (size_t)FIELD_TILE_AREA) ? elements - first : FIELD_TILE_AREA;
+
+        offsets[block + 1] = offsets[block]
+                           + encodeBlock(raw + first * element_size, count, element_size,
+                                         encoded + offsets[block]);
+    }
+
+    FieldFileHeader header = *source;
+    header.compression   = FIELD_COMPRESSION_RLE;
+    header.blocks        = blocks;
+    header.blocks_offset = source->bits_offset + alignToPage(bitsBytes(file->tiles));
+    header.data_offset   = header.blocks_offset + alignToPage((blocks + 1) * sizeof(uint64_t));
+    header.data_bytes    = offsets[blocks];
+
+    FILE* output = fopen(path, "wb");
+    if (!output)
+    {
+        fprintf(stderr, "Error while creating %s: %s\n", path, strerror(errno));
+        free(offsets);
+        free(encoded);
+        return 1;
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, output) == 1
+                && !fseek(output, header.bits_offset, SEEK_SET)
+                && fwrite(file->done_bits, bitsBytes(file->tiles), 1, output) == 1
+                && !fseek(output, header.blocks_offset, SEEK_SET)
+                && fwrite(offsets, sizeof(uint64_t), blocks + 1, output) == blocks + 1
+                && !fseek(output, header.data_offset, SEEK_SET)
+                && fwrite(encoded, 1, header.data_bytes, output) == header.data_bytes;
+
+    written = !fclose(output) && written;
+
+    free(offsets);
+    free(encoded);
+
+    if (!written)
+    {
+        fprintf(stderr, "Error while writing %s\n", path);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int readFieldFile(const FieldFile* file, IterationField* field)
+{
+    assert(file  != NULL);
+    assert(field != NULL);
+
+    const FieldFileHeader* header = file->header;
+
+    if (field->width  != header->width  || field->height != header->height
+     || field->format != header->format || field->layout != header->layout)
+    {
+        fprintf(stderr, "Field does not match field file\n");
+        return 1;
+    }
+
+    const uint8_t* source = (const uint8_t*)file->map + header->data_offset;
+
+    if (header->compression == FIELD_COMPRESSION_NONE)
+    {
+        memcpy(field->data, source, field->bytes);
+        return 0;
+    }
+
+    const size_t element_size = elementSize(field->format);
+    const size_t elements     = field->bytes / element_size;
+
+    if (header->blocks != (elements + FIELD_TILE_AREA - 1) / FIELD_TILE_AREA
+     || header->blocks_offset + (header->blocks + 1) * sizeof(uint64_t) > header->data_offset)
+    {
+        fprintf(stderr, "Compressed field file is damaged\n");
+        return 1;
+    }
+
+    const uint64_t* offsets = (const uint64_t*)((const uint8_t*)file->map + header->blocks_offset);
+
+    for (size_t block = 0; block < header->blocks; block++)
+    {
+        size_t first = block * FIELD_TILE_AREA;
+        size_t count = (elements - first < (size_t)FIELD_TILE_AREA) ? elements - first : FIELD_TILE_AREA;
+
+        if (offsets[block] > offsets[block + 1] || offsets[block + 1] > header->data_bytes
+         || decodeBlock(source + offsets[block], offsets[block + 1] - offsets[block], element_size,
+                        (uint8_t*)field->data + first * element_size, count))
+        {
+            fprintf(stderr, "Compressed field file is damaged\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+void printFieldFileStatistics(FILE* file, const FieldFileStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    fprintf(file, "field file: %d tiles, %d resumed, %d rendered, %d left, %.2f ms\n",
+            stats->tiles, stats->tiles_resumed, stats->tiles_rendered,
+            stats->tiles - stats->tiles_resumed - stats->tiles_rendered, stats->ms);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static size_t alignToPage(size_t bytes)
+{
+    return (bytes + FIELD_FILE_ALIGNMENT - 1) / FIELD_FILE_ALIGNMENT * FIELD_FILE_ALIGNMENT;
+}
+
+
+static size_t bitsBytes(int tiles)
+{
+    return (size_t)(tiles + 63) / 64 * sizeof(uint64_t);
+}
+
+
+static size_t elementSize(FieldFormat format)
+{
+    return (format == FIELD_FORMAT_U16) ? sizeof(uint16_t) : sizeof(int);
+}
+
+
+static int countTiles(int width, int height)
+{
+    return ((width  + FIELD_TILE_SIZE - 1) / FIELD_TILE_SIZE)
+         * ((height + FIELD_TILE_SIZE - 1) / FIELD_TILE_SIZE);
+}
+
+
+static void runFieldFileTask(void* context, int slot)
+{
+    assert(context != NULL);
+
+    FieldFileRenderContext* render = (FieldFileRenderContext*)context;
+
+    if (fieldTileDone(render->file, slot))
+    {
+        return;
+    }
+    if (render->tile_limit >= 0 && render->claimed.fetch_add(1) >= render->tile_limit)
+    {
+        return;
+    }
+
+    render->rect_func(&render->data, fieldTileRect(&render->file->field, slot));
+    markFieldTileDone(render->file, slot);
+    render->rendered++;
+}
+
+
+// бит ставится после записи плитки, так что готовая по биту плитка
+// всегда целиком лежит в файле
+static void markFieldTileDone(FieldFile* file, int slot)
+{
+    assert(file != NULL);
+
+    __atomic_fetch_or(&file->done_bits[slot / 64], (uint64_t)1 << (slot % 64), __ATOMIC_RELEASE);
+}
+
+
+static size_t encodeBlock(const uint8_t* source, size_t elements, size_t element_size, uint8_t* output)
+{
+    assert(source != NULL);
+    assert(output != NULL);
+
+    size_t written = 0;
+    size_t i = 0;
+    while (i < elements)
+    {
+        size_t run = 1;
+        while (i + run < elements
+            && !memcmp(source + (i + run) * element_size, source + i * element_size, element_size))
+        {
+            run++;
+        }
+
+        uint16_t length = (uint16_t)run;
+        memcpy(output + written, &length, sizeof(length));
+        memcpy(output + written + sizeof(length), source + i * element_size, element_size);
+        written += sizeof(length) + element_size;
+
+        i += run;
+    }
+
+    return written;
+}
+
+
+static int decodeBlock(const uint8_t* source, size_t bytes, size_t element_size,
+                       uint8_t* output, size_t elements)
+{
+    assert(source != NULL);
+    assert(output != NULL);
+
+    const size_t entry = sizeof(uint16_t) + element_size;
+
+    size_t decoded = 0;
+    for (size_t position = 0; position + entry <= bytes; position += entry)
+    {
+        uint16_t length = 0;
+        memcpy(&length, source + position, sizeof(length));
+        if (length == 0 || decoded + length > elements)
+        {
+            return 1;
+        }
+
+        const uint8_t* value = source + position + sizeof(length);
+        for (uint16_t i = 0; i < length; i++)
+        {
+            memcpy(output + (decoded + i) * element_size, value, element_size);
+        }
+        decoded += length;
+    }
+
+    return (decoded == elements && bytes % entry == 0) ? 0 : 1;
+}
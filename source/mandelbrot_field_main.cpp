@@ -0,0 +1,538 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <SDL3/SDL.h>
+
+#include "mandelbrot_field_file.h"
+#include "mandelbrot_utils.h"
+#include "mandelbrot_colorize.h"
+#include "mandelbrot_logic_formula.h"
+#include "mandelbrot_thread_pool.h"
+
+
+// Посчитать поле в файл; если процесс убит, тот же запуск досчитает его:
+//     mandel_field render deep.field --size 7680x4320 --center -0.7453 0.1127 --zoom 1e4 --iterations 20000
+// Сжать готовый файл и посмотреть заголовок:
+//     mandel_field compress deep.field deep.rle
+//     mandel_field info deep.rle
+// Перекрасить любой палитрой (файл палитры - строки RRGGBB):
+//     mandel_field color deep.field deep.ppm --palette fire
+
+static const int DEFAULT_FIELD_WIDTH  = 3840;
+static const int DEFAULT_FIELD_HEIGHT = 2160;
+static const int COLOR_RUNS           = 5;
+static const int COLOR_BAND_ROWS      = 64;
+
+typedef struct ColorContext
+{
+    uint32_t*       pixels;
+    int             pitch;
+    MandelbrotData* data;
+} ColorContext;
+
+static int runRender(int argc, char* argv[]);
+static int runCompress(int argc, char* argv[]);
+static int runInfo(int argc, char* argv[]);
+static int runColor(int argc, char* argv[]);
+
+static int  setNamedPalette(MandelbrotData* data, const char* name);
+static int  loadPaletteFile(MandelbrotData* data, const char* path);
+static void setGradientPalette(MandelbrotData* data, const uint8_t* stops, int number_of_stops);
+static void runColorTask(void* context, int index);
+static int  writePPM(const char* path, const uint32_t* pixels, int width, int height);
+
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 3 && !strcmp(argv[1], "render"))
+    {
+        return runRender(argc, argv);
+    }
+    if (argc >= 4 && !strcmp(argv[1], "compress"))
+    {
+        return runCompress(argc, argv);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "info"))
+    {
+        return runInfo(argc, argv);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "color"))
+    {
+        return runColor(argc, argv);
+    }
+
+    fprintf(stderr, "Usage: mandel_field render FILE [options] | compress FILE OUT | info FILE"
+                    " | color FILE [OUT.ppm] [options]\n");
+    return 1;
+}
+
+
+static int runRender(int argc, char* argv[])
+{
+    const char* path = argv[2];
+
+    MandelbrotData data = {};
+    data.max_iterations = MAX_ITERATIONS;
+    data.formula        = FORMULA_MANDELBROT;
+    data.zoom           = DEFAULT_ZOOM;
+    data.center_x       = DEFAULT_CENTER_X;
+    data.center_y       = DEFAULT_CENTER_Y;
+    data.julia_re       = DEFAULT_JULIA_RE;
+    data.julia_im       = DEFAULT_JULIA_IM;
+
+    int  width  = DEFAULT_FIELD_WIDTH;
+    int  height = DEFAULT_FIELD_HEIGHT;
+    int  threads = defaultThreadCount();
+    int  stop_after = -1;
+    bool restart = false;
+    FieldLayout layout = FIELD_LAYOUT_TILED;
+
+    for (int i = 3; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--size") && has_value)
+        {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2
+             || width <= 0 || width % 16 || height <= 0)
+            {
+                fprintf(stderr, "Size must be WIDTHxHEIGHT with width divisible by 16\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--center") && i + 2 < argc)
+        {
+            data.center_x = atof(argv[++i]);
+            data.center_y = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--zoom") && has_value)
+        {
+            data.zoom = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--iterations") && has_value)
+        {
+            data.max_iterations = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--julia"))
+        {
+            data.formula = FORMULA_JULIA;
+        }
+        else if (!strcmp(argv[i], "--burning-ship"))
+        {
+            data.formula = FORMULA_BURNING_SHIP;
+        }
+        else if (!strcmp(argv[i], "--rows"))
+        {
+            layout = FIELD_LAYOUT_ROWS;
+        }
+        else if (!strcmp(argv[i], "--morton"))
+        {
+            layout = FIELD_LAYOUT_MORTON;
+        }
+        else if (!strcmp(argv[i], "--threads") && has_value)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--stop-after") && has_value)
+        {
+            stop_after = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--restart"))
+        {
+            restart = true;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (data.max_iterations <= 0 || data.zoom <= 0)
+    {
+        fprintf(stderr, "Iterations and zoom must be positive\n");
+        return 1;
+    }
+
+    data.width  = DEFAULT_WIDTH / data.zoom;
+    data.height = data.width * height / width;
+
+    const FieldFormat format = chooseFieldFormat(data.max_iterations);
+
+    // тот же вид в существующем файле - досчитываем его, иначе начинаем заново
+    FieldFile file = {};
+    bool resumed = false;
+    if (!restart && access(path, F_OK) == 0)
+    {
+        if (openFieldFile(&file, path, true) == 0)
+        {
+            resumed = file.header->compression == FIELD_COMPRESSION_NONE
+                   && fieldFileMatches(&file, &data, width, height, format, layout);
+            if (!resumed)
+            {
+                printf("%s holds another view, starting over\n", path);
+                closeFieldFile(&file);
+            }
+        }
+    }
+    if (!resumed && createFieldFile(&file, path, &data, width, height, format, layout))
+    {
+        return 1;
+    }
+
+    ThreadPool* pool = createThreadPool(threads);
+
+    FieldFileStatistics stats = {};
+    renderFieldFile(&file, &data, calculateFormulaIterationRectIntrinsics, pool, stop_after, &stats);
+    printFieldFileStatistics(stdout, &stats);
+
+    destroyThreadPool(pool);
+
+    // имитация падения: без msync и закрытия файла
+    if (stop_after >= 0 && fieldFileTilesDone(&file) < file.tiles)
+    {
+        fflush(stdout);
+        raise(SIGKILL);
+    }
+
+    closeFieldFile(&file);
+
+    return 0;
+}
+
+
+static int runCompress(int, char* argv[])
+{
+    FieldFile file = {};
+    if (openFieldFile(&file, argv[2], false))
+    {
+        return 1;
+    }
+
+    int return_code = compressFieldFile(&file, argv[3]);
+    closeFieldFile(&file);
+
+    if (!return_code)
+    {
+        FieldFile compressed = {};
+        if (openFieldFile(&compressed, argv[3], false))
+        {
+            return 1;
+        }
+
+        // исходный файл могли подменить или обрезать, пока шло сжатие
+        FieldFile raw = {};
+        if (openFieldFile(&raw, argv[2], false))
+        {
+            closeFieldFile(&compressed);
+            return 1;
+        }
+        printf("%" PRIu64 " bytes of field in %" PRIu64 " bytes (%.1f%%)\n",
+               raw.header->data_bytes, compressed.header->data_bytes,
+               100.0 * compressed.header->data_bytes / raw.header->data_bytes);
+
+        closeFieldFile(&raw);
+        closeFieldFile(&compressed);
+    }
+
+    return return_code;
+}
+
+
+static int runInfo(int, char* argv[])
+{
+    FieldFile file = {};
+    if (openFieldFile(&file, argv[2], false))
+    {
+        return 1;
+    }
+
+    const FieldFileHeader* header = file.header;
+    printf("%dx%d %s %s field%s, formula %d, %d iterations\n"
+           "center (%.17g, %.17g), view %.17g x %.17g\n"
+           "%d of %d tiles done, %" PRIu64 " bytes of data\n",
+           header->width, header->height,
+           header->format == FIELD_FORMAT_U16 ? "u16" : "i32",
+           header->layout == FIELD_LAYOUT_ROWS ? "rows" : header->layout == FIELD_LAYOUT_TILED ? "tiled" : "morton",
+           header->compression == FIELD_COMPRESSION_RLE ? ", rle compressed" : "",
+           header->formula, header->max_iterations,
+           header->center_x, header->center_y, header->view_width, header->view_height,
+           fieldFileTilesDone(&file), file.tiles, header->data_bytes);
+
+    closeFieldFile(&file);
+
+    return 0;
+}
+
+
+static int runColor(int argc, char* argv[])
+{
+    const char* input  = argv[2];
+    const char* output = NULL;
+    const char* palette = "default";
+    const char* palette_file = NULL;
+    int threads = defaultThreadCount();
+
+    for (int i = 3; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--palette") && has_value)
+        {
+            palette = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--palette-file") && has_value)
+        {
+            palette_file = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--threads") && has_value)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && !output)
+        {
+            output = argv[i];
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FieldFile file = {};
+    if (openFieldFile(&file, input, false))
+    {
+        return 1;
+    }
+
+    const FieldFileHeader* header = file.header;
+    if (fieldFileTilesDone(&file) < file.tiles)
+    {
+        printf("%s is not finished: %d of %d tiles\n", input, fieldFileTilesDone(&file), file.tiles);
+    }
+
+    MandelbrotData data = {};
+    data.max_iterations = header->max_iterations;
+
+    int return_code = palette_file ? loadPaletteFile(&data, palette_file) : setNamedPalette(&data, palette);
+
+    // несжатое поле читается прямо из отображения, сжатое распаковывается
+    if (!return_code && header->compression == FIELD_COMPRESSION_NONE)
+    {
+        data.field = file.field;
+    }
+    else if (!return_code)
+    {
+        uint64_t start = SDL_GetPerformanceCounter();
+
+        return_code = createIterationField(&data.field, header->width, header->height,
+                                           (FieldFormat)header->format, (FieldLayout)header->layout)
+                   || readFieldFile(&file, &data.field);
+
+        printf("decompressed in %.2f ms\n", elapsedMs(start));
+    }
+
+    const int pitch = header->width * sizeof(uint32_t);
+    uint32_t* pixels = (uint32_t*)aligned_alloc(32, (size_t)pitch * header->height);
+    if (!return_code && !pixels)
+    {
+        fprintf(stderr, "Error while allocating memory for pixels\n");
+        return_code = 1;
+    }
+
+    if (!return_code)
+    {
+        ThreadPool* pool = createThreadPool(threads);
+
+        ColorContext context = {pixels, pitch, &data};
+        const int tasks = (header->layout == FIELD_LAYOUT_ROWS)
+                        ? (header->height + COLOR_BAND_ROWS - 1) / COLOR_BAND_ROWS
+                        : file.tiles;
+
+        double best_ms = 0;
+        for (int run = 0; run < COLOR_RUNS; run++)
+        {
+            uint64_t start = SDL_GetPerformanceCounter();
+            runParallel(pool, tasks, runColorTask, &context);
+            double ms = elapsedMs(start);
+
+            if (run == 0 || ms < best_ms)
+            {
+                best_ms = ms;
+            }
+        }
+        destroyThreadPool(pool);
+
+        const double bytes = (double)data.field.bytes + (double)pitch * header->height;
+        printf("recoloured %dx%d in %.2f ms with %d threads, %.2f GB/s of field and pixels\n",
+               header->width, header->height, best_ms, threads, bytes / (best_ms * 1e6));
+
+        if (output)
+        {
+            return_code = writePPM(output, pixels, header->width, header->height);
+        }
+    }
+
+    if (header->compression != FIELD_COMPRESSION_NONE && data.field.tile_slots)
+    {
+        destroyIterationField(&data.field);
+    }
+    free(pixels);
+    closeFieldFile(&file);
+
+    return return_code;
+}
+
+
+static int setNamedPalette(MandelbrotData* data, const char* name)
+{
+    // опорные цвета RGB, между ними линейная интерполяция
+    static const uint8_t GRAY[]  = {0, 0, 0,  255, 255, 255};
+    static const uint8_t FIRE[]  = {0, 0, 0,  128, 0, 0,  255, 96, 0,  255, 220, 64,  255, 255, 255};
+    static const uint8_t OCEAN[] = {0, 7, 100,  32, 107, 203,  237, 255, 255,  255, 170, 0,  0, 2, 0};
+
+    if (!strcmp(name, "default"))
+    {
+        setMandelbrotPalette(data);
+    }
+    else if (!strcmp(name, "gray"))
+    {
+        setGradientPalette(data, GRAY, sizeof(GRAY) / 3);
+    }
+    else if (!strcmp(name, "fire"))
+    {
+        setGradientPalette(data, FIRE, sizeof(FIRE) / 3);
+    }
+    else if (!strcmp(name, "ocean"))
+    {
+        setGradientPalette(data, OCEAN, sizeof(OCEAN) / 3);
+    }
+    else
+    {
+        fprintf(stderr, "Unknown palette %s: use default, gray, fire, ocean or --palette-file\n", name);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static int loadPaletteFile(MandelbrotData* data, const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Error while opening %s\n", path);
+        return 1;
+    }
+
+    uint8_t stops[MAX_ITERATIONS * 3] = {};
+    int number_of_stops = 0;
+
+    unsigned int color = 0;
+    while (number_of_stops < MAX_ITERATIONS && fscanf(file, " %6x", &color) == 1)
+    {
+        stops[number_of_stops * 3 + 0] = (color >> 16) & 0xFF;
+        stops[number_of_stops * 3 + 1] = (color >>  8) & 0xFF;
+        stops[number_of_stops * 3 + 2] = (color >>  0) & 0xFF;
+        number_of_stops++;
+    }
+    fclose(file);
+
+    if (number_of_stops < 2)
+    {
+        fprintf(stderr, "Palette %s needs at least two RRGGBB colors\n", path);
+        return 1;
+    }
+
+    setGradientPalette(data, stops, number_of_stops);
+
+    return 0;
+}
+
+
+static void setGradientPalette(MandelbrotData* data, const uint8_t* stops, int number_of_stops)
+{
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+
+    for (int i = 0; i < MAX_ITERATIONS; i++)
+    {
+        float t = i / (float)(MAX_ITERATIONS - 1) * (number_of_stops - 1);
+        int   k = (int)t;
+        if (k >= number_of_stops - 1)
+        {
+            k = number_of_stops - 2;
+        }
+        float f = t - k;
+
+        const uint8_t* a = stops + k * 3;
+        const uint8_t* b = stops + (k + 1) * 3;
+        data->colors[i] = SDL_MapRGBA(format, NULL,
+                                      (uint8_t)(a[0] + (b[0] - a[0]) * f),
+                                      (uint8_t)(a[1] + (b[1] - a[1]) * f),
+                                      (uint8_t)(a[2] + (b[2] - a[2]) * f),
+                                      255);
+    }
+}
+
+
+// плитка плиточного поля или полоса строк построчного
+static void runColorTask(void* context, int index)
+{
+    ColorContext* color = (ColorContext*)context;
+    const IterationField* field = &color->data->field;
+
+    FieldRect rect = {};
+    if (field->layout == FIELD_LAYOUT_ROWS)
+    {
+        rect.y      = index * COLOR_BAND_ROWS;
+        rect.width  = field->width;
+        rect.height = (field->height - rect.y < COLOR_BAND_ROWS) ? field->height - rect.y : COLOR_BAND_ROWS;
+    }
+    else
+    {
+        rect = fieldTileRect(field, index);
+    }
+
+    colorizeIterationRect(color->pitch, color->pixels, color->data, rect);
+}
+
+
+static int writePPM(const char* path, const uint32_t* pixels, int width, int height)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Error while opening %s\n", path);
+        return 1;
+    }
+
+    uint8_t* row = (uint8_t*)malloc((size_t)width * 3);
+    if (!row)
+    {
+        fclose(file);
+        return 1;
+    }
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            SDL_GetRGB(pixels[(size_t)y * width + x], format, NULL,
+                       &row[x * 3], &row[x * 3 + 1], &row[x * 3 + 2]);
+        }
+        fwrite(row, 3, width, file);
+    }
+
+    free(row);
+
+    return fclose(file) ? 1 : 0;
+}
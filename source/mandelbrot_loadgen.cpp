@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include <SDL3/SDL.h>
+
+#include "mandelbrot_daemon.h"
+#include "mandelbrot_socket.h"
+#include "mandelbrot_utils.h"
+
+
+// Нагрузка на демон: каждый клиент изображает просмотрщик, который
+// панорамирует по уровню пирамиды. На каждом шаге он запрашивает видимые
+// плитки и кольцо плиток про запас, ждёт видимые, а недождавшиеся
+// запасные отменяет перед следующим шагом. Задержка считается только по
+// видимым плиткам - её и видит пользователь.
+//
+//     mandel_loadgen --clients 8 --steps 40 --level 5 --spread 1
+
+static const char* DEFAULT_DAEMON_ADDRESS = "unix:/tmp/mandel_daemon.sock";
+
+typedef enum RequestState
+{
+    REQUEST_FREE = 0,
+    REQUEST_VISIBLE,
+    REQUEST_PREFETCH,
+    REQUEST_CANCELLED
+} RequestState;
+
+typedef struct LoadConfig
+{
+    const char* address;
+    int clients;
+    int steps;
+    int level;
+    int view_width;
+    int view_height;
+    int prefetch_ring;
+    int spread;
+    int max_iterations;
+    int formula;
+} LoadConfig;
+
+typedef struct ClientResult
+{
+    double* latencies_ms;
+    int     number_of_latencies;
+    int     prefetch_received;
+    int     prefetch_cancelled;
+    int     cached_responses;
+    bool    failed;
+} ClientResult;
+
+typedef struct ClientState
+{
+    int       fd;
+    uint32_t  next_request_id;
+    uint8_t*  states;           // по номеру запроса
+    uint64_t* sent_ns;
+    int       capacity;
+    uint32_t* pixels;
+} ClientState;
+
+static void runClient(const LoadConfig* config, int index, ClientResult* result);
+static int  sendTileRequest(const LoadConfig* config, ClientState* client,
+                            int tile_x, int tile_y, RequestState kind);
+static int  receiveResponse(ClientState* client, ClientResult* result, int* visible_left);
+static int  fetchDaemonStatistics(const char* address, DaemonStatistics* stats);
+static int  compareDoubles(const void* a, const void* b);
+
+
+int main(int argc, char* argv[])
+{
+    LoadConfig config = {};
+    config.address        = DEFAULT_DAEMON_ADDRESS;
+    config.clients        = 4;
+    config.steps          = 30;
+    config.level          = 4;
+    config.view_width     = 4;
+    config.view_height    = 3;
+    config.prefetch_ring  = 1;
+    config.spread         = 0;
+    config.max_iterations = MAX_ITERATIONS;
+    config.formula        = FORMULA_MANDELBROT;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--address") && has_value)
+        {
+            config.address = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--clients") && has_value)
+        {
+            config.clients = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--steps") && has_value)
+        {
+            config.steps = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--level") && has_value)
+        {
+            config.level = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--view") && has_value)
+        {
+            if (sscanf(argv[++i], "%dx%d", &config.view_width, &config.view_height) != 2)
+            {
+                fprintf(stderr, "View must be COLUMNSxROWS of tiles\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--prefetch") && has_value)
+        {
+            config.prefetch_ring = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--spread") && has_value)
+        {
+            config.spread = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--max-iterations") && has_value)
+        {
+            config.max_iterations = atoi(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (config.clients < 1 || config.steps < 1 || config.level < 0 || config.level > DAEMON_MAX_LEVEL
+     || config.view_width < 1 || config.view_height < 1 || config.prefetch_ring < 0
+     || config.max_iterations < 1 || config.max_iterations > DAEMON_MAX_ITERATIONS)
+    {
+        fprintf(stderr, "Invalid load configuration\n");
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    ClientResult* results = (ClientResult*)calloc(config.clients, sizeof(ClientResult));
+    std::thread*  threads = new std::thread[config.clients];
+    assert(results != NULL);
+
+    const uint64_t start = SDL_GetTicksNS();
+    for (int i = 0; i < config.clients; i++)
+    {
+        threads[i] = std::thread(runClient, &config, i, &results[i]);
+    }
+    for (int i = 0; i < config.clients; i++)
+    {
+        threads[i].join();
+    }
+    const double seconds = (double)(SDL_GetTicksNS() - start) / 1e9;
+
+    int total_latencies = 0;
+    int prefetch_received = 0;
+    int prefetch_cancelled = 0;
+    int cached_responses = 0;
+    int failed_clients = 0;
+    for (int i = 0; i < config.clients; i++)
+    {
+        total_latencies    += results[i].number_of_latencies;
+        prefetch_received  += results[i].prefetch_received;
+        prefetch_cancelled += results[i].prefetch_cancelled;
+        cached_responses   += results[i].cached_responses;
+        failed_clients     += results[i].failed;
+    }
+
+    double* latencies = (double*)calloc(total_latencies + 1, sizeof(double));
+    assert(latencies != NULL);
+
+    int filled = 0;
+    for (int i = 0; i < config.clients; i++)
+    {
+        memcpy(latencies + filled, results[i].latencies_ms,
+               results[i].number_of_latencies * sizeof(double));
+        filled += results[i].number_of_latencies;
+        free(results[i].latencies_ms);
+    }
+    qsort(latencies, total_latencies, sizeof(double), compareDoubles);
+
+    printf("%d clients x %d steps, view %dx%d tiles, prefetch ring %d, level %d\n",
+           config.clients, config.steps, config.view_width, config.view_height,
+           config.prefetch_ring, config.level);
+    printf("visible tiles: %d in %.2f s, %.1f tiles/s (%.1f with prefetch), %d responses from cache\n",
+           total_latencies, seconds, total_latencies / seconds,
+           (total_latencies + prefetch_received) / seconds, cached_responses);
+    printf("prefetch: %d received, %d cancelled\n", prefetch_received, prefetch_cancelled);
+
+    if (total_latencies > 0)
+    {
+        printf("visible latency ms: p50 %.2f, p95 %.2f, p99 %.2f, max %.2f\n",
+               latencies[(int)(0.50 * (total_latencies - 1))],
+               latencies[(int)(0.95 * (total_latencies - 1))],
+               latencies[(int)(0.99 * (total_latencies - 1))],
+               latencies[total_latencies - 1]);
+    }
+
+    DaemonStatistics stats = {};
+    if (fetchDaemonStatistics(config.address, &stats) == 0)
+    {
+        printDaemonStatistics(stdout, &stats);
+    }
+
+    free(latencies);
+    free(results);
+    delete[] threads;
+
+    if (failed_clients)
+    {
+        fprintf(stderr, "%d clients failed\n", failed_clients);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static void runClient(const LoadConfig* config, int index, ClientResult* result)
+{
+    assert(config != NULL);
+    assert(result != NULL);
+
+    const int visible = config->view_width * config->view_height;
+    const int ring    = config->prefetch_ring;
+    const int per_step = (config->view_width  + 2 * ring)
+                       * (config->view_height + 2 * ring);
+
+    ClientState client = {};
+    client.capacity = config->steps * per_step + 1;
+    client.fd       = connectToAddress(config->address);
+    client.states   = (uint8_t*)calloc(client.capacity, sizeof(uint8_t));
+    client.sent_ns  = (uint64_t*)calloc(client.capacity, sizeof(uint64_t));
+    client.pixels   = (uint32_t*)calloc(DAEMON_TILE_PIXELS, sizeof(uint32_t));
+    result->latencies_ms = (double*)calloc(config->steps * visible, sizeof(double));
+
+    if (client.fd < 0 || !client.states || !client.sent_ns || !client.pixels || !result->latencies_ms)
+    {
+        result->failed = true;
+    }
+
+    // все клиенты идут одним путём, сдвинутым на spread плиток, так что
+    // часть плиток у них общая
+    const int tiles_per_side = 1 << config->level;
+    const int start_x = (tiles_per_side / 4 + index * config->spread) % tiles_per_side;
+    const int start_y = tiles_per_side / 2 - config->view_height / 2;
+
+    for (int step = 0; step < config->steps && !result->failed; step++)
+    {
+        const int view_x = (start_x + step) % tiles_per_side;
+        const uint32_t first_request_id = client.next_request_id;
+        int visible_left = 0;
+
+        for (int y = -ring; y < config->view_height + ring && !result->failed; y++)
+        {
+            for (int x = -ring; x < config->view_width + ring; x++)
+            {
+                const int tile_x = view_x  + x;
+                const int tile_y = start_y + y;
+                if (tile_x < 0 || tile_x >= tiles_per_side || tile_y < 0 || tile_y >= tiles_per_side)
+                {
+                    continue;
+                }
+
+                bool is_visible = x >= 0 && x < config->view_width && y >= 0 && y < config->view_height;
+                if (sendTileRequest(config, &client, tile_x, tile_y,
+                                    is_visible ? REQUEST_VISIBLE : REQUEST_PREFETCH))
+                {
+                    result->failed = true;
+                    break;
+                }
+                visible_left += is_visible;
+            }
+        }
+
+        while (visible_left > 0 && !result->failed)
+        {
+            if (receiveResponse(&client, result, &visible_left))
+            {
+                result->failed = true;
+            }
+        }
+
+        // вид сдвинулся: запасные плитки этого шага больше не нужны
+        for (uint32_t id = first_request_id; id < client.next_request_id && !result->failed; id++)
+        {
+            if (client.states[id] == REQUEST_PREFETCH)
+            {
+                DaemonRequest cancel = {};
+                cancel.magic      = DAEMON_MESSAGE_MAGIC;
+                cancel.type       = DAEMON_CANCEL_TILE;
+                cancel.request_id = id;
+
+                if (writeFull(client.fd, &cancel, sizeof(cancel)))
+                {
+                    result->failed = true;
+                }
+                client.states[id] = REQUEST_CANCELLED;
+                result->prefetch_cancelled++;
+            }
+        }
+    }
+
+    if (client.fd >= 0)
+    {
+        close(client.fd);
+    }
+    free(client.states);
+    free(client.sent_ns);
+    free(client.pixels);
+}
+
+
+static int sendTileRequest(const LoadConfig* config, ClientState* client,
+                           int tile_x, int tile_y, RequestState kind)
+{
+    assert(config != NULL);
+    assert(client != NULL);
+
+    const uint32_t id = client->next_request_id++;
+    assert((int)id < client->capacity);
+
+    DaemonRequest request = {};
+    request.magic              = DAEMON_MESSAGE_MAGIC;
+    request.type               = DAEMON_REQUEST_TILE;
+    request.request_id         = id;
+    request.priority           = (kind == REQUEST_VISIBLE) ? TILE_PRIORITY_VISIBLE : TILE_PRIORITY_PREFETCH;
+    request.key.formula        = config->formula;
+    request.key.max_iterations = config->max_iterations;
+    request.key.level          = config->level;
+    request.key.tile_x         = tile_x;
+    request.key.tile_y         = tile_y;
+
+    client->states[id]  = kind;
+    client->sent_ns[id] = SDL_GetTicksNS();
+
+    return writeFull(client->fd, &request, sizeof(request));
+}
+
+
+static int receiveResponse(ClientState* client, ClientResult* result, int* visible_left)
+{
+    assert(client       != NULL);
+    assert(result       != NULL);
+    assert(visible_left != NULL);
+
+    DaemonResponse response = {};
+    if (readFull(client->fd, &response, sizeof(response))
+     || response.magic != DAEMON_MESSAGE_MAGIC || response.type != DAEMON_TILE_READY
+     || readFull(client->fd, client->pixels, DAEMON_TILE_PIXELS * sizeof(uint32_t)))
+    {
+        return 1;
+    }
+
+    if (response.request_id >= client->next_request_id)
+    {
+        return 1;
+    }
+
+    // ответ на отменённый запрос мог уже быть в пути
+    switch (client->states[response.request_id])
+    {
+        case REQUEST_VISIBLE:
+            result->latencies_ms[result->number_of_latencies++] =
+                (double)(SDL_GetTicksNS() - client->sent_ns[response.request_id]) / 1e6;
+            (*visible_left)--;
+            break;
+
+        case REQUEST_PREFETCH:
+            result->prefetch_received++;
+            break;
+
+        default:
+            break;
+    }
+
+    result->cached_responses += (response.cached != 0);
+    client->states[response.request_id] = REQUEST_FREE;
+
+    return 0;
+}
+
+
+static int fetchDaemonStatistics(const char* address, DaemonStatistics* stats)
+{
+    assert(address != NULL);
+    assert(stats   != NULL);
+
+    int fd = connectToAddress(address);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    DaemonRequest request = {};
+    request.magic = DAEMON_MESSAGE_MAGIC;
+    request.type  = DAEMON_REQUEST_STATISTICS;
+
+    DaemonResponse response = {};
+    int error = writeFull(fd, &request, sizeof(request))
+             || readFull(fd, &response, sizeof(response))
+             || response.type != DAEMON_STATISTICS
+             || readFull(fd, stats, sizeof(*stats));
+
+    close(fd);
+    return error;
+}
+
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double lhs = *(const double*)a;
+    double rhs = *(const double*)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
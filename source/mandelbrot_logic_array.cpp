@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 
@@ -52,6 +53,7 @@
 
 static void calculateIterationsArray(double x0[ARRAY_SIZE], 
                                      double y0[ARRAY_SIZE],
+                                     int max_iterations,
                                      int iterations[ARRAY_SIZE]);
 
 
@@ -66,17 +68,18 @@ void calculateMandelbrotArraySeparated(int pitch,
     assert(data   != NULL);
 
     int pitch_u32 = pitch / sizeof(uint32_t);
-    int* field = data->iterations_per_pixel;
+    const IterationField* field = &data->field;
 
     calculateIterationFieldArray(data);
-    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    for (int y = 0; y < field->height; y++)
     {
-        for (int x = 0; x < SCREEN_WIDTH; x += ARRAY_SIZE) 
+        for (int x = 0; x < field->width; x += ARRAY_SIZE) 
         {
             for (int i = 0; i < ARRAY_SIZE; i++) 
             {
-                int iteration = field[y * SCREEN_WIDTH + x + i] % MAX_ITERATIONS;
-                pixels[y * pitch_u32 + x + i] = data->colors[iteration];
+                int iteration = fieldLoad(field, x + i, y);
+                int index = (iteration >= data->max_iterations) ? 0 : iteration % MAX_ITERATIONS;
+                pixels[y * pitch_u32 + x + i] = data->colors[index];
             }
         }
     }
@@ -87,18 +90,28 @@ void calculateIterationFieldArray(MandelbrotData* data)
 {
     assert(data != NULL);
 
-    int* field = data->iterations_per_pixel;
+    calculateIterationRectArray(data, fieldRect(&data->field));
+}
+
+
+void calculateIterationRectArray(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(rect.x % ARRAY_SIZE == 0 && rect.width % ARRAY_SIZE == 0);
+    assert(fieldFitsIterations(&data->field, data->max_iterations));
+
+    IterationField* field = &data->field;
 
-    const double dx = data->width / SCREEN_WIDTH;
-    const double dy = data->height / SCREEN_HEIGHT;
+    const double dx = data->width / field->width;
+    const double dy = data->height / field->height;
     const double offset_x = data->center_x - data->width / 2;
     const double offset_y = data->center_y - data->height / 2;
 
-    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    for (int y = rect.y; y < rect.y + rect.height; y++)
     {
-        const double y0_value = (SCREEN_HEIGHT - y) * dy + offset_y;
+        const double y0_value = (field->height - y) * dy + offset_y;
         
-        for (int x = 0; x < SCREEN_WIDTH; x += ARRAY_SIZE) 
+        for (int x = rect.x; x < rect.x + rect.width; x += ARRAY_SIZE) 
         {
             double x0[ARRAY_SIZE] = {};
             double y0[ARRAY_SIZE] = {};
@@ -110,8 +123,8 @@ void calculateIterationFieldArray(MandelbrotData* data)
                 y0[i] = y0_value;
             }
             
-            calculateIterationsArray(x0, y0, iterations);
-            memcpy(field + y * SCREEN_WIDTH + x, iterations, 4 * ARRAY_SIZE);
+            calculateIterationsArray(x0, y0, data->max_iterations, iterations);
+            fieldStoreSpan(field, x, y, iterations, ARRAY_SIZE);
         }
     }
 }
@@ -121,6 +134,7 @@ void calculateIterationFieldArray(MandelbrotData* data)
 
 static void calculateIterationsArray(double x0[ARRAY_SIZE], 
                                      double y0[ARRAY_SIZE],
+                                     int max_iterations,
                                      int iterations[ARRAY_SIZE])
 {
     assert(x0 != NULL);
@@ -134,7 +148,7 @@ static void calculateIterationsArray(double x0[ARRAY_SIZE],
     int mask[ARRAY_SIZE] = {0};
     bool active = false;
     
-    for (int i = 0; i < MAX_ITERATIONS; i++) 
+    for (int i = 0; i < max_iterations; i++) 
     {
         double radius[ARRAY_SIZE] = {0.0};
         ARRAY_AND_ARRAY_OP(+, radius, x2, y2, ARRAY_SIZE);
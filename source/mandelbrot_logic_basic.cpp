@@ -38,14 +38,23 @@ void calculateIterationField(MandelbrotData* data)
 {
     assert(data != NULL);
 
-    int* field = data->iterations_per_pixel;
+    calculateIterationRect(data, fieldRect(&data->field));
+}
+
+
+void calculateIterationRect(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(fieldFitsIterations(&data->field, data->max_iterations));
+
+    IterationField* field = &data->field;
     
-    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    for (int y = rect.y; y < rect.y + rect.height; y++)
     {
-        for (int x = 0; x < SCREEN_WIDTH; x++) 
+        for (int x = rect.x; x < rect.x + rect.width; x++) 
         {
             int iterations = calculateIterationFromPosition(x, y, data);
-            field[y * SCREEN_WIDTH + x] = iterations % MAX_ITERATIONS;
+            fieldStore(field, x, y, iterations);
         }
     }
 }
@@ -60,8 +69,11 @@ static int calculateIterationFromPosition(int x_pixel,
 {
     assert(data != NULL);
 
-    double norm_x = (x_pixel / (double)SCREEN_WIDTH) * data->width;
-    double norm_y = ((SCREEN_HEIGHT - y_pixel) / (double)SCREEN_HEIGHT) * data->height;
+    const int field_width  = data->field.width;
+    const int field_height = data->field.height;
+
+    double norm_x = (x_pixel / (double)field_width) * data->width;
+    double norm_y = ((field_height - y_pixel) / (double)field_height) * data->height;
 
     const double x0 = norm_x - (data->width / 2) + data->center_x;
     const double y0 = norm_y - (data->height / 2) + data->center_y;
@@ -70,8 +82,10 @@ static int calculateIterationFromPosition(int x_pixel,
     double y2 = 0.0;
     double w = 0.0;
 
+    const int max_iterations = data->max_iterations;
+
     int iteration = 0;
-    while (x2 + y2 <= 4.0 && iteration < MAX_ITERATIONS)
+    while (x2 + y2 <= 4.0 && iteration < max_iterations)
     {
         double x = x2 - y2 + x0;
         double y = w - x2 - y2 + y0;
@@ -92,16 +106,17 @@ static int calculateColors(int pitch, uint32_t* pixels, MandelbrotData* data)
 {
     assert(data != NULL);
 
-    int* field = data->iterations_per_pixel;
+    const IterationField* field = &data->field;
     uint32_t* palette = data->colors;
     int pitch_u32 = pitch / sizeof(uint32_t);
 
-    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    for (int y = 0; y < field->height; y++)
     {
-        for (int x = 0; x < SCREEN_WIDTH; x++)
+        for (int x = 0; x < field->width; x++)
         {
-            int iterations = field[y * SCREEN_WIDTH + x];
-            pixels[y * pitch_u32 + x] = palette[iterations % MAX_ITERATIONS];
+            int iterations = fieldLoad(field, x, y);
+            int index = (iterations >= data->max_iterations) ? 0 : iterations % MAX_ITERATIONS;
+            pixels[y * pitch_u32 + x] = palette[index];
         }
     }
 
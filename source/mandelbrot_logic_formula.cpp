@@ -0,0 +1,694 @@
+#include "mandelbrot_logic_formula.h"
+
+#include <immintrin.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include "screen_constants.h"
+#include "mandelbrot_utils.h"
+#include "mandelbrot_formula.h"
+#include "mandelbrot_colorize.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+#define ARRAY_SIZE 16
+
+typedef void (*IterationRectFunction)(MandelbrotData* data, FieldRect rect);
+typedef int  (*IterationPointFunction)(double x, double y, MandelbrotData* data);
+typedef void (*IterationPointsFunction)(const double* x, const double* y, int count,
+                                        int* iterations, MandelbrotData* data);
+
+template <typename Formula>
+static int calculatePointBasic(double x, double y, MandelbrotData* data);
+template <typename Formula>
+static void calculateRectBasic(MandelbrotData* data, FieldRect rect);
+template <typename Formula>
+static void calculateRectArray(MandelbrotData* data, FieldRect rect);
+template <typename Formula>
+static void calculateRectIntrinsics(MandelbrotData* data, FieldRect rect);
+template <typename Formula>
+static void calculateRectDistance(MandelbrotData* data, FieldRect rect);
+template <typename Formula>
+static void calculatePointsIntrinsics(const double* x, const double* y, int count,
+                                      int* iterations, MandelbrotData* data);
+
+static const IterationPointFunction POINT_KERNELS[FORMULA_COUNT] = {
+    calculatePointBasic<MandelbrotFormula>,
+    calculatePointBasic<JuliaFormula>,
+    calculatePointBasic<BurningShipFormula>,
+    calculatePointBasic<MultibrotFormula<3>>,
+    calculatePointBasic<MultibrotFormula<4>>,
+    calculatePointBasic<MultibrotFormula<5>>,
+};
+
+static const IterationRectFunction BASIC_KERNELS[FORMULA_COUNT] = {
+    calculateRectBasic<MandelbrotFormula>,
+    calculateRectBasic<JuliaFormula>,
+    calculateRectBasic<BurningShipFormula>,
+    calculateRectBasic<MultibrotFormula<3>>,
+    calculateRectBasic<MultibrotFormula<4>>,
+    calculateRectBasic<MultibrotFormula<5>>,
+};
+
+static const IterationRectFunction ARRAY_KERNELS[FORMULA_COUNT] = {
+    calculateRectArray<MandelbrotFormula>,
+    calculateRectArray<JuliaFormula>,
+    calculateRectArray<BurningShipFormula>,
+    calculateRectArray<MultibrotFormula<3>>,
+    calculateRectArray<MultibrotFormula<4>>,
+    calculateRectArray<MultibrotFormula<5>>,
+};
+
+static const IterationRectFunction INTRINSICS_KERNELS[FORMULA_COUNT] = {
+    calculateRectIntrinsics<MandelbrotFormula>,
+    calculateRectIntrinsics<JuliaFormula>,
+    calculateRectIntrinsics<BurningShipFormula>,
+    calculateRectIntrinsics<MultibrotFormula<3>>,
+    calculateRectIntrinsics<MultibrotFormula<4>>,
+    calculateRectIntrinsics<MultibrotFormula<5>>,
+};
+
+static const IterationRectFunction DISTANCE_KERNELS[FORMULA_COUNT] = {
+    calculateRectDistance<MandelbrotFormula>,
+    calculateRectDistance<JuliaFormula>,
+    calculateRectDistance<BurningShipFormula>,
+    calculateRectDistance<MultibrotFormula<3>>,
+    calculateRectDistance<MultibrotFormula<4>>,
+    calculateRectDistance<MultibrotFormula<5>>,
+};
+
+static const IterationPointsFunction POINTS_KERNELS[FORMULA_COUNT] = {
+    calculatePointsIntrinsics<MandelbrotFormula>,
+    calculatePointsIntrinsics<JuliaFormula>,
+    calculatePointsIntrinsics<BurningShipFormula>,
+    calculatePointsIntrinsics<MultibrotFormula<3>>,
+    calculatePointsIntrinsics<MultibrotFormula<4>>,
+    calculatePointsIntrinsics<MultibrotFormula<5>>,
+};
+
+
+// public ----------------------------------------------------------------------
+
+
+void calculateFormulaSeparated(int pitch,
+                               uint32_t* pixels,
+                               MandelbrotData* data)
+{
+    assert(data   != NULL);
+    assert(pixels != NULL);
+
+    calculateFormulaIterationField(data);
+    colorizeIterationField(pitch, pixels, data);
+}
+
+
+void calculateFormulaArraySeparated(int pitch,
+                                    uint32_t* pixels,
+                                    MandelbrotData* data)
+{
+    assert(data   != NULL);
+    assert(pixels != NULL);
+
+    calculateFormulaIterationFieldArray(data);
+    colorizeIterationField(pitch, pixels, data);
+}
+
+
+void calculateFormulaIntrinsicsSeparated(int pitch,
+                                         uint32_t* pixels,
+                                         MandelbrotData* data)
+{
+    assert(data   != NULL);
+    assert(pixels != NULL);
+
+    calculateFormulaIterationFieldIntrinsics(data);
+    colorizeIterationField(pitch, pixels, data);
+}
+
+
+int calculateFormulaIterationsAtPoint(double x, double y, MandelbrotData* data)
+{
+    assert(data != NULL);
+    assert(data->formula >= 0 && data->formula < FORMULA_COUNT);
+
+    return POINT_KERNELS[data->formula](x, y, data);
+}
+
+
+void calculateFormulaIterationField(MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    calculateFormulaIterationRect(data, fieldRect(&data->field));
+}
+
+
+void calculateFormulaIterationRect(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(data->formula >= 0 && data->formula < FORMULA_COUNT);
+
+    BASIC_KERNELS[data->formula](data, rect);
+}
+
+
+void calculateFormulaIterationFieldArray(MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    calculateFormulaIterationRectArray(data, fieldRect(&data->field));
+}
+
+
+void calculateFormulaIterationRectArray(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(data->formula >= 0 && data->formula < FORMULA_COUNT);
+
+    ARRAY_KERNELS[data->formula](data, rect);
+}
+
+
+void calculateFormulaIterationFieldIntrinsics(MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    calculateFormulaIterationRectIntrinsics(data, fieldRect(&data->field));
+}
+
+
+void calculateFormulaIterationRectIntrinsics(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(data->formula >= 0 && data->formula < FORMULA_COUNT);
+    assert((uintptr_t)data->field.data % 32 == 0 && "iterations field must be 32-byte aligned");
+
+    INTRINSICS_KERNELS[data->formula](data, rect);
+}
+
+
+void calculateFormulaIterationFieldDistance(MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    calculateFormulaIterationRectDistance(data, fieldRect(&data->field));
+}
+
+
+void calculateFormulaIterationRectDistance(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(data->formula >= 0 && data->formula < FORMULA_COUNT);
+    assert(data->distance_per_pixel != NULL && "distance estimation is not enabled");
+    assert((uintptr_t)data->field.data % 32 == 0 && "iterations field must be 32-byte aligned");
+
+    DISTANCE_KERNELS[data->formula](data, rect);
+}
+
+
+void calculateFormulaIterationsAtPoints(const double* x, 
+                                        const double* y, 
+                                        int count,
+                                        int* iterations,
+                                        MandelbrotData* data)
+{
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(iterations != NULL);
+    assert(data != NULL);
+    assert(count % 4 == 0);
+
+    POINTS_KERNELS[data->formula](x, y, count, iterations, data);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+template <typename Formula>
+static inline int calculateIterationsBasic(double px, double py,
+                                           double julia_re, double julia_im,
+                                           int max_iterations)
+{
+    if (Formula::HAS_INTERIOR_TEST && Formula::isInterior(px, py))
+    {
+        return max_iterations;
+    }
+
+    double x  = 0.0;
+    double y  = 0.0;
+    double cx = px;
+    double cy = py;
+
+    if (Formula::STARTS_AT_PIXEL)
+    {
+        x  = px;
+        y  = py;
+        cx = julia_re;
+        cy = julia_im;
+    }
+
+    double x2 = x * x;
+    double y2 = y * y;
+
+    int iteration = 0;
+    while (x2 + y2 <= 4.0 && iteration < max_iterations)
+    {
+        Formula::step(&x, &y, x2, y2, cx, cy);
+
+        x2 = x * x;
+        y2 = y * y;
+
+        iteration++;
+    }
+
+    return iteration;
+}
+
+
+template <typename Formula>
+static int calculatePointBasic(double x, double y, MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    return calculateIterationsBasic<Formula>(
+        x, y, data->julia_re, data->julia_im, data->max_iterations
+    );
+}
+
+
+template <typename Formula>
+static void calculateRectBasic(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(fieldFitsIterations(&data->field, data->max_iterations));
+
+    IterationField* field = &data->field;
+
+    const double dx = data->width / field->width;
+    const double dy = data->height / field->height;
+    const double offset_x = data->center_x - data->width / 2;
+    const double offset_y = data->center_y - data->height / 2;
+
+    for (int y = rect.y; y < rect.y + rect.height; y++)
+    {
+        const double py = (field->height - y) * dy + offset_y;
+
+        for (int x = rect.x; x < rect.x + rect.width; x++)
+        {
+            const double px = x * dx + offset_x;
+            int iterations = calculateIterationsBasic<Formula>(
+                px, py, data->julia_re, data->julia_im, data->max_iterations
+            );
+            fieldStore(field, x, y, iterations);
+        }
+    }
+}
+
+
+template <typename Formula>
+static void calculateIterationsArray(const double px[ARRAY_SIZE],
+                                     const double py[ARRAY_SIZE],
+                                     double julia_re,
+                                     double julia_im,
+                                     int max_iterations,
+                                     int iterations[ARRAY_SIZE])
+{
+    assert(px != NULL);
+    assert(py != NULL);
+    assert(iterations != NULL);
+
+    if (Formula::HAS_INTERIOR_TEST)
+    {
+        bool all_interior = true;
+        for (int i = 0; i < ARRAY_SIZE; i++)
+        {
+            all_interior &= Formula::isInterior(px[i], py[i]);
+        }
+
+        if (all_interior)
+        {
+            for (int i = 0; i < ARRAY_SIZE; i++)
+            {
+                iterations[i] = max_iterations;
+            }
+            return;
+        }
+    }
+
+    double x[ARRAY_SIZE]  = {0.0};
+    double y[ARRAY_SIZE]  = {0.0};
+    double cx[ARRAY_SIZE] = {0.0};
+    double cy[ARRAY_SIZE] = {0.0};
+
+    for (int i = 0; i < ARRAY_SIZE; i++)
+    {
+        if (Formula::STARTS_AT_PIXEL)
+        {
+            x[i]  = px[i];
+            y[i]  = py[i];
+            cx[i] = julia_re;
+            cy[i] = julia_im;
+        }
+        else
+        {
+            cx[i] = px[i];
+            cy[i] = py[i];
+        }
+    }
+
+    for (int n = 0; n < max_iterations; n++)
+    {
+        double x2[ARRAY_SIZE] = {0.0};
+        double y2[ARRAY_SIZE] = {0.0};
+        int mask[ARRAY_SIZE]  = {0};
+        bool active = false;
+
+        for (int i = 0; i < ARRAY_SIZE; i++)
+        {
+            x2[i] = x[i] * x[i];
+            y2[i] = y[i] * y[i];
+            mask[i] = (x2[i] + y2[i] <= 4.0);
+            active |= mask[i];
+        }
+
+        if (!active)
+        {
+            break;
+        }
+
+        for (int i = 0; i < ARRAY_SIZE; i++)
+        {
+            Formula::step(&x[i], &y[i], x2[i], y2[i], cx[i], cy[i]);
+            iterations[i] += mask[i];
+        }
+    }
+}
+
+
+template <typename Formula>
+static void calculateRectArray(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(rect.x % ARRAY_SIZE == 0 && rect.width % ARRAY_SIZE == 0);
+    assert(fieldFitsIterations(&data->field, data->max_iterations));
+
+    IterationField* field = &data->field;
+
+    const double dx = data->width / field->width;
+    const double dy = data->height / field->height;
+    const double offset_x = data->center_x - data->width / 2;
+    const double offset_y = data->center_y - data->height / 2;
+
+    for (int y = rect.y; y < rect.y + rect.height; y++)
+    {
+        const double py_value = (field->height - y) * dy + offset_y;
+
+        for (int x = rect.x; x < rect.x + rect.width; x += ARRAY_SIZE)
+        {
+            double px[ARRAY_SIZE] = {};
+            double py[ARRAY_SIZE] = {};
+            int iterations[ARRAY_SIZE] = {0};
+
+            for (int i = 0; i < ARRAY_SIZE; i++)
+            {
+                px[i] = (x + i) * dx + offset_x;
+                py[i] = py_value;
+            }
+
+            calculateIterationsArray<Formula>(
+                px, py, data->julia_re, data->julia_im, data->max_iterations, iterations
+            );
+
+            fieldStoreSpan(field, x, y, iterations, ARRAY_SIZE);
+        }
+    }
+}
+
+
+template <typename Formula>
+static inline __m128i calculateIterationsIntrinsics(__m256d px, __m256d py,
+                                                    __m256d julia_re, __m256d julia_im,
+                                                    int max_iterations)
+{
+    // смешанные векторы на границе кардиоиды просто итерируются целиком
+    if (Formula::HAS_INTERIOR_TEST 
+     && _mm256_movemask_pd(Formula::isInterior(px, py)) == 0xF)
+    {
+        return _mm_set1_epi32(max_iterations);
+    }
+
+    __m256d x  = _mm256_setzero_pd();
+    __m256d y  = _mm256_setzero_pd();
+    __m256d cx = px;
+    __m256d cy = py;
+
+    if (Formula::STARTS_AT_PIXEL)
+    {
+        x  = px;
+        y  = py;
+        cx = julia_re;
+        cy = julia_im;
+    }
+
+    __m256i iterations = _mm256_setzero_si256();
+    const __m256d max_radius = _mm256_set1_pd(4.0);
+
+    for (int i = 0; i < max_iterations; i++)
+    {
+        __m256d x2 = _mm256_mul_pd(x, x);
+        __m256d y2 = _mm256_mul_pd(y, y);
+        __m256d mask = _mm256_cmp_pd(_mm256_add_pd(x2, y2), max_radius, _CMP_LE_OQ);
+
+        if (!_mm256_movemask_pd(mask))
+        {
+            break;
+        }
+
+        Formula::step(&x, &y, x2, y2, cx, cy);
+
+        iterations = _mm256_sub_epi64(iterations, _mm256_castpd_si256(mask));
+    }
+
+    // младшие 32 бита каждого 64-битного счётчика собираем в одну половину
+    __m256i packed = _mm256_permutevar8x32_epi32(
+        iterations,
+        _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)
+    );
+
+    return _mm256_castsi256_si128(packed);
+}
+
+
+template <typename Formula>
+static void calculateRectIntrinsics(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(rect.x % 8 == 0 && rect.width % 8 == 0);
+    assert(fieldFitsIterations(&data->field, data->max_iterations));
+
+    IterationField* field = &data->field;
+
+    const double dx = data->width / field->width;
+    const double dy = data->height / field->height;
+    const __m256d offset_x = _mm256_set1_pd(data->center_x - data->width / 2);
+    const __m256d julia_re = _mm256_set1_pd(data->julia_re);
+    const __m256d julia_im = _mm256_set1_pd(data->julia_im);
+    const int max_iterations = data->max_iterations;
+
+    for (int y = rect.y; y < rect.y + rect.height; y++)
+    {
+        const double norm_y = (field->height - y) * dy - data->height / 2 + data->center_y;
+        const __m256d py = _mm256_set1_pd(norm_y);
+
+        for (int x = rect.x; x < rect.x + rect.width; x += 8)
+        {
+            __m256d x_pixels1 = _mm256_add_pd(
+                _mm256_set1_pd(x),
+                _mm256_set_pd(3.0, 2.0, 1.0, 0.0)
+            );
+
+            __m256d x_pixels2 = _mm256_add_pd(
+                _mm256_set1_pd(x),
+                _mm256_set_pd(7.0, 6.0, 5.0, 4.0)
+            );
+
+            __m256d px1 = _mm256_fmadd_pd(x_pixels1, _mm256_set1_pd(dx), offset_x);
+            __m128i iterations1 = calculateIterationsIntrinsics<Formula>(
+                px1, py, julia_re, julia_im, max_iterations
+            );
+
+            __m256d px2 = _mm256_fmadd_pd(x_pixels2, _mm256_set1_pd(dx), offset_x);
+            __m128i iterations2 = calculateIterationsIntrinsics<Formula>(
+                px2, py, julia_re, julia_im, max_iterations
+            );
+
+            fieldStore4(field, x,     y, iterations1);
+            fieldStore4(field, x + 4, y, iterations2);
+        }
+    }
+}
+
+
+template <typename Formula>
+static void calculatePointsIntrinsics(const double* x, const double* y, int count,
+                                      int* iterations, MandelbrotData* data)
+{
+    const __m256d julia_re = _mm256_set1_pd(data->julia_re);
+    const __m256d julia_im = _mm256_set1_pd(data->julia_im);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128i result = calculateIterationsIntrinsics<Formula>(
+            _mm256_loadu_pd(x + i), 
+            _mm256_loadu_pd(y + i), 
+            julia_re, julia_im, data->max_iterations
+        );
+
+        _mm_storeu_si128((__m128i*)(iterations + i), result);
+    }
+}
+
+
+// в отличие от calculateIterationsIntrinsics замораживает z и dz у вышедших
+// дорожек, иначе к концу цикла от них остались бы inf и nan
+template <typename Formula>
+static inline __m128i calculateDistanceIntrinsics(__m256d px, __m256d py,
+                                                  __m256d julia_re, __m256d julia_im,
+                                                  int max_iterations,
+                                                  float distance[4])
+{
+    if (Formula::HAS_INTERIOR_TEST 
+     && _mm256_movemask_pd(Formula::isInterior(px, py)) == 0xF)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            distance[i] = FLT_MAX;
+        }
+        return _mm_set1_epi32(max_iterations);
+    }
+
+    __m256d x   = _mm256_setzero_pd();
+    __m256d y   = _mm256_setzero_pd();
+    __m256d cx  = px;
+    __m256d cy  = py;
+    __m256d dzx = _mm256_setzero_pd();
+    __m256d dzy = _mm256_setzero_pd();
+
+    if (Formula::STARTS_AT_PIXEL)
+    {
+        x   = px;
+        y   = py;
+        cx  = julia_re;
+        cy  = julia_im;
+        dzx = _mm256_set1_pd(1.0);
+    }
+
+    __m256i iterations = _mm256_setzero_si256();
+    const __m256d max_radius = _mm256_set1_pd(4.0);
+
+    for (int i = 0; i < max_iterations; i++)
+    {
+        __m256d x2 = _mm256_mul_pd(x, x);
+        __m256d y2 = _mm256_mul_pd(y, y);
+        __m256d mask = _mm256_cmp_pd(_mm256_add_pd(x2, y2), max_radius, _CMP_LE_OQ);
+
+        if (!_mm256_movemask_pd(mask))
+        {
+            break;
+        }
+
+        __m256d next_dzx = dzx;
+        __m256d next_dzy = dzy;
+        Formula::derivative(&next_dzx, &next_dzy, x, y);
+
+        __m256d next_x = x;
+        __m256d next_y = y;
+        Formula::step(&next_x, &next_y, x2, y2, cx, cy);
+
+        x   = _mm256_blendv_pd(x,   next_x,   mask);
+        y   = _mm256_blendv_pd(y,   next_y,   mask);
+        dzx = _mm256_blendv_pd(dzx, next_dzx, mask);
+        dzy = _mm256_blendv_pd(dzy, next_dzy, mask);
+
+        iterations = _mm256_sub_epi64(iterations, _mm256_castpd_si256(mask));
+    }
+
+    alignas(32) double zx[4];
+    alignas(32) double zy[4];
+    alignas(32) double dx[4];
+    alignas(32) double dy[4];
+    alignas(32) int64_t lanes[4];
+
+    _mm256_store_pd(zx, x);
+    _mm256_store_pd(zy, y);
+    _mm256_store_pd(dx, dzx);
+    _mm256_store_pd(dy, dzy);
+    _mm256_store_si256((__m256i*)lanes, iterations);
+
+    // логарифма в AVX2 нет, а считается он один раз на пиксель
+    for (int i = 0; i < 4; i++)
+    {
+        double dz = sqrt(dx[i] * dx[i] + dy[i] * dy[i]);
+        if (!Formula::HAS_DISTANCE_ESTIMATE || lanes[i] >= max_iterations || dz == 0.0)
+        {
+            distance[i] = FLT_MAX;
+            continue;
+        }
+
+        double r = sqrt(zx[i] * zx[i] + zy[i] * zy[i]);
+        distance[i] = (float)(r * log(r) / dz);
+    }
+
+    __m256i packed = _mm256_permutevar8x32_epi32(
+        iterations,
+        _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)
+    );
+
+    return _mm256_castsi256_si128(packed);
+}
+
+
+template <typename Formula>
+static void calculateRectDistance(MandelbrotData* data, FieldRect rect)
+{
+    assert(data != NULL);
+    assert(rect.x % 4 == 0 && rect.width % 4 == 0);
+    assert(fieldFitsIterations(&data->field, data->max_iterations));
+
+    IterationField* field = &data->field;
+    float* distance = data->distance_per_pixel;
+
+    const double dx = data->width / field->width;
+    const double dy = data->height / field->height;
+    const __m256d offset_x = _mm256_set1_pd(data->center_x - data->width / 2);
+    const __m256d julia_re = _mm256_set1_pd(data->julia_re);
+    const __m256d julia_im = _mm256_set1_pd(data->julia_im);
+    const int max_iterations = data->max_iterations;
+
+    for (int y = rect.y; y < rect.y + rect.height; y++)
+    {
+        const double norm_y = (field->height - y) * dy - data->height / 2 + data->center_y;
+        const __m256d py = _mm256_set1_pd(norm_y);
+
+        for (int x = rect.x; x < rect.x + rect.width; x += 4)
+        {
+            __m256d x_pixels = _mm256_add_pd(
+                _mm256_set1_pd(x),
+                _mm256_set_pd(3.0, 2.0, 1.0, 0.0)
+            );
+
+            __m256d px = _mm256_fmadd_pd(x_pixels, _mm256_set1_pd(dx), offset_x);
+            __m128i iterations = calculateDistanceIntrinsics<Formula>(
+                px, py, julia_re, julia_im, max_iterations, 
+                distance + (size_t)y * field->width + x
+            );
+
+            fieldStore4(field, x, y, iterations);
+        }
+    }
+}
@@ -10,9 +10,10 @@
 // static ----------------------------------------------------------------------
 
 
-static inline __m256i calculateIterationsFromPositionIntrinsics(__m256d x0, __m256d y0);
-static inline __m128i calculateIterationsFromPositionIntrinsicsCastIter(__m256d x0, __m256d y0);
-static __m256i calculateIterationsFromPositionIntrinsics(__m256d x0, __m256d y0);
+static inline __m256i calculateIterationsFromPositionIntrinsics(__m256d x0, __m256d y0, 
+                                                                int max_iterations);
+static inline __m128i calculateIterationsFromPositionIntrinsicsCastIter(__m256d x0, __m256d y0, 
+                                                                        int max_iterations);
 
 
 // public ----------------------------------------------------------------------
@@ -26,18 +27,23 @@ void calculateMandelbrotIntrinsicsSeparated(int pitch,
     assert(pixels != NULL);
     assert((uintptr_t)pixels % 32 == 0 && "pixels must be 32-byte aligned");
     assert((uintptr_t)data->colors % 32 == 0 && "color palette must be 32-byte aligned");
-    assert((uintptr_t)data->iterations_per_pixel % 32 == 0 && "iterations filed must be 32-byte aligned");
+    assert((uintptr_t)data->field.data % 32 == 0 && "iterations filed must be 32-byte aligned");
 
     int pitch_u32 = pitch / sizeof(uint32_t);
-    int* field = data->iterations_per_pixel;
+    const IterationField* field = &data->field;
+    const __m256i max_iterations = _mm256_set1_epi32(data->max_iterations);
 
     calculateIterationsFieldIntrinsics(data);
-    for (int y = 0; y < SCREEN_HEIGHT; y++)    
+    for (int y = 0; y < field->height; y++)    
     {
-        for (int x = 0; x < SCREEN_WIDTH; x += 8) 
+        for (int x = 0; x < field->width; x += 8) 
         {
-            __m256i iterations = _mm256_load_si256((__m256i*)(field + y * SCREEN_WIDTH + x));
-            __m256i indices = _mm256_and_si256(iterations, _mm256_set1_epi32(MAX_ITERATIONS - 1));
+            __m256i iterations = fieldLoad8(field, x, y);
+            __m256i interior = _mm256_cmpeq_epi32(iterations, max_iterations);
+            __m256i indices = _mm256_andnot_si256(
+                interior,
+                _mm256_and_si256(iterations, _mm256_set1_epi32(MAX_ITERATIONS - 1))
+            );
             __m256i colors = _mm256_i32gather_epi32(
                 (const int*)data->colors,
                 indices,
@@ -54,23 +60,33 @@ void calculateMandelbrotIntrinsicsSeparated(int pitch,
 
 
 void calculateIterationsFieldIntrinsics(MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    calculateIterationsRectIntrinsics(data, fieldRect(&data->field));
+}
+
+
+void calculateIterationsRectIntrinsics(MandelbrotData* data, FieldRect rect)
 {
     assert(data != NULL);
     assert((uintptr_t)data->colors % 32 == 0 && "color palette must be 32-byte aligned");
-    assert((uintptr_t)data->iterations_per_pixel % 32 == 0 && "iterations field must be 32-byte aligned");
+    assert((uintptr_t)data->field.data % 32 == 0 && "iterations field must be 32-byte aligned");
+    assert(rect.x % 8 == 0 && rect.width % 8 == 0);
+    assert(fieldFitsIterations(&data->field, data->max_iterations));
 
-    int* field = data->iterations_per_pixel;
+    IterationField* field = &data->field;
 
-    const double dx = data->width / SCREEN_WIDTH;
-    const double dy = data->height / SCREEN_HEIGHT;
+    const double dx = data->width / field->width;
+    const double dy = data->height / field->height;
     const __m256d offset_x = _mm256_set1_pd(data->center_x - data->width / 2);
 
-    for (int y = 0; y < SCREEN_HEIGHT; y++) 
+    for (int y = rect.y; y < rect.y + rect.height; y++) 
     {
-        const double norm_y = (SCREEN_HEIGHT - y) * dy - data->height / 2 + data->center_y;
+        const double norm_y = (field->height - y) * dy - data->height / 2 + data->center_y;
         const __m256d y0 = _mm256_set1_pd(norm_y);
         
-        for (int x = 0; x < SCREEN_WIDTH; x += 8) 
+        for (int x = rect.x; x < rect.x + rect.width; x += 8) 
         {
             __m256d x_pixels1 = _mm256_add_pd(
                 _mm256_set1_pd(x),
@@ -83,20 +99,13 @@ void calculateIterationsFieldIntrinsics(MandelbrotData* data)
             );
 
             __m256d x01 = _mm256_fmadd_pd(x_pixels1, _mm256_set1_pd(dx), offset_x);
-            __m128i iterations1 = calculateIterationsFromPositionIntrinsicsCastIter(x01, y0);
+            __m128i iterations1 = calculateIterationsFromPositionIntrinsicsCastIter(x01, y0, data->max_iterations);
 
             __m256d x02 = _mm256_fmadd_pd(x_pixels2, _mm256_set1_pd(dx), offset_x);
-            __m128i iterations2 = calculateIterationsFromPositionIntrinsicsCastIter(x02, y0);
+            __m128i iterations2 = calculateIterationsFromPositionIntrinsicsCastIter(x02, y0, data->max_iterations);
 
-            _mm_store_si128(
-                (__m128i*)(field + y * SCREEN_WIDTH + x),
-                iterations1
-            );
-
-            _mm_store_si128(
-                (__m128i*)(field + y * SCREEN_WIDTH + x + 4),
-                iterations2
-            );
+            fieldStore4(field, x,     y, iterations1);
+            fieldStore4(field, x + 4, y, iterations2);
         }
     }
 }
@@ -105,9 +114,10 @@ void calculateIterationsFieldIntrinsics(MandelbrotData* data)
 // static ----------------------------------------------------------------------
 
 
-static inline __m128i calculateIterationsFromPositionIntrinsicsCastIter(__m256d x0, __m256d y0) 
+static inline __m128i calculateIterationsFromPositionIntrinsicsCastIter(__m256d x0, __m256d y0, 
+                                                                        int max_iterations) 
 {
-    __m256i iterations = calculateIterationsFromPositionIntrinsics(x0, y0);
+    __m256i iterations = calculateIterationsFromPositionIntrinsics(x0, y0, max_iterations);
     __m128i low = _mm256_castsi256_si128(iterations);
     __m128i high = _mm256_extracti128_si256(iterations, 1);
 
@@ -120,7 +130,8 @@ static inline __m128i calculateIterationsFromPositionIntrinsicsCastIter(__m256d
 }
 
 
-static inline __m256i calculateIterationsFromPositionIntrinsics(__m256d x0, __m256d y0)
+static inline __m256i calculateIterationsFromPositionIntrinsics(__m256d x0, __m256d y0, 
+                                                                int max_iterations)
 {
     __m256d x2 = _mm256_setzero_pd();
     __m256d y2 = _mm256_setzero_pd();
@@ -129,7 +140,7 @@ static inline __m256i calculateIterationsFromPositionIntrinsics(__m256d x0, __m2
     __m256i iterations = _mm256_setzero_si256();
     const __m256d max_radius = _mm256_set1_pd(4.0);
     
-    for (int i = 0; i < MAX_ITERATIONS; i++) {
+    for (int i = 0; i < max_iterations; i++) {
         __m256d mask = _mm256_cmp_pd(_mm256_add_pd(x2, y2), max_radius, _CMP_LE_OQ);
 
         if (!_mm256_movemask_pd(mask)) 
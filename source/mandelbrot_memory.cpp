@@ -0,0 +1,352 @@
+#include "mandelbrot_memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <mutex>
+
+
+struct FramePool
+{
+    FramePoolConfig     config;
+    std::mutex          lock;
+    void**              buffers;      // от старых к новым
+    size_t*             sizes;
+    int                 count;
+    size_t              bytes;        // сумма sizes
+    FramePoolStatistics stats;
+};
+
+
+// static ----------------------------------------------------------------------
+
+
+static void*  allocateBuffer(const FramePoolConfig* config, size_t bytes);
+static void   freeBuffer(const FramePoolConfig* config, void* buffer, size_t bytes);
+static bool   usesHugePages(const FramePoolConfig* config);
+static size_t mappedLength(const FramePoolConfig* config, size_t bytes);
+
+
+// public ----------------------------------------------------------------------
+
+
+int numaNodeCount()
+{
+    DIR* nodes = opendir("/sys/devices/system/node");
+    if (!nodes)
+    {
+        return 1;
+    }
+
+    int count = 0;
+    struct dirent* entry = NULL;
+    while ((entry = readdir(nodes)))
+    {
+        if (!strncmp(entry->d_name, "node", 4) && isdigit((unsigned char)entry->d_name[4]))
+        {
+            count++;
+        }
+    }
+    closedir(nodes);
+
+    return count > 0 ? count : 1;
+}
+
+
+void setDefaultFramePoolConfig(FramePoolConfig* config)
+{
+    assert(config != NULL);
+
+    const bool numa = (numaNodeCount() > 1);
+
+    config->max_buffers = FRAME_POOL_BUFFERS;
+    config->max_bytes   = FRAME_POOL_BYTES;
+    config->huge_pages  = !numa;
+    config->first_touch = numa;
+    config->populate    = false;
+}
+
+
+FramePool* createFramePool(const FramePoolConfig* config)
+{
+    assert(config != NULL);
+    assert(config->max_buffers >= 0);
+
+    FramePool* pool = new FramePool();
+    pool->config  = *config;
+    pool->buffers = (void**)calloc(config->max_buffers + 1, sizeof(void*));
+    pool->sizes   = (size_t*)calloc(config->max_buffers + 1, sizeof(size_t));
+
+    if (!pool->buffers || !pool->sizes)
+    {
+        fprintf(stderr, "Error while allocating memory for frame pool\n");
+        free(pool->buffers);
+        free(pool->sizes);
+        delete pool;
+        return NULL;
+    }
+
+    return pool;
+}
+
+
+void destroyFramePool(FramePool* pool)
+{
+    if (!pool)
+    {
+        return;
+    }
+
+    trimFramePool(pool);
+    free(pool->buffers);
+    free(pool->sizes);
+    delete pool;
+}
+
+
+FramePool* defaultFramePool()
+{
+    static FramePool* pool = []
+    {
+        FramePoolConfig config = {};
+        setDefaultFramePoolConfig(&config);
+        return createFramePool(&config);
+    }();
+
+    return pool;
+}
+
+
+void* acquireFrameBuffer(FramePool* pool, size_t bytes)
+{
+    assert(pool != NULL);
+    assert(bytes > 0);
+
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pool->stats.acquired++;
+
+        // самый свежий буфер нужного размера: его страницы скорее в кэше и TLB
+        for (int i = pool->count - 1; i >= 0; i--)
+        {
+            if (pool->sizes[i] != bytes)
+            {
+                continue;
+            }
+
+            void* buffer = pool->buffers[i];
+            memmove(pool->buffers + i, pool->buffers + i + 1, (pool->count - i - 1) * sizeof(void*));
+            memmove(pool->sizes   + i, pool->sizes   + i + 1, (pool->count - i - 1) * sizeof(size_t));
+            pool->count--;
+            pool->bytes -= bytes;
+            pool->stats.reused++;
+            return buffer;
+        }
+
+        if (bytes >= FRAME_LARGE_BUFFER_BYTES)
+        {
+            pool->stats.mapped++;
+        }
+        else
+        {
+            pool->stats.allocated++;
+        }
+    }
+
+    void* buffer = allocateBuffer(&pool->config, bytes);
+    if (!buffer)
+    {
+        fprintf(stderr, "Error while allocating %zu bytes for frame buffer\n", bytes);
+    }
+
+    return buffer;
+}
+
+
+void releaseFrameBuffer(FramePool* pool, void* buffer, size_t bytes)
+{
+    assert(pool != NULL);
+
+    if (!buffer)
+    {
+        return;
+    }
+
+    // больше всего пула: хранить его пришлось бы ценой всех остальных
+    if (bytes > pool->config.max_bytes)
+    {
+        {
+            std::lock_guard<std::mutex> guard(pool->lock);
+            pool->stats.evicted++;
+        }
+        freeBuffer(&pool->config, buffer, bytes);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+
+        pool->buffers[pool->count] = buffer;
+        pool->sizes[pool->count]   = bytes;
+        pool->count++;
+        pool->bytes += bytes;
+    }
+
+    // вытесненные буферы освобождаются вне блокировки, по одному
+    while (true)
+    {
+        void*  evicted       = NULL;
+        size_t evicted_bytes = 0;
+        {
+            std::lock_guard<std::mutex> guard(pool->lock);
+
+            if (pool->count > 0
+             && (pool->count > pool->config.max_buffers || pool->bytes > pool->config.max_bytes))
+            {
+                evicted       = pool->buffers[0];
+                evicted_bytes = pool->sizes[0];
+                pool->count--;
+                pool->bytes -= evicted_bytes;
+                memmove(pool->buffers, pool->buffers + 1, pool->count * sizeof(void*));
+                memmove(pool->sizes,   pool->sizes   + 1, pool->count * sizeof(size_t));
+                pool->stats.evicted++;
+            }
+        }
+
+        if (!evicted)
+        {
+            break;
+        }
+        freeBuffer(&pool->config, evicted, evicted_bytes);
+    }
+}
+
+
+void trimFramePool(FramePool* pool)
+{
+    assert(pool != NULL);
+
+    std::lock_guard<std::mutex> guard(pool->lock);
+    for (int i = 0; i < pool->count; i++)
+    {
+        freeBuffer(&pool->config, pool->buffers[i], pool->sizes[i]);
+    }
+    pool->count = 0;
+    pool->bytes = 0;
+}
+
+
+void getFramePoolStatistics(FramePool* pool, FramePoolStatistics* stats)
+{
+    assert(pool  != NULL);
+    assert(stats != NULL);
+
+    std::lock_guard<std::mutex> guard(pool->lock);
+
+    *stats = pool->stats;
+    stats->cached_bytes = pool->bytes;
+}
+
+
+void printFramePoolStatistics(FILE* file, const FramePoolStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    fprintf(file, "frame pool: %lu buffers acquired, %lu reused, %lu mapped, %lu allocated, "
+                  "%lu evicted, %.1f MB cached\n",
+            stats->acquired, stats->reused, stats->mapped, stats->allocated,
+            stats->evicted, stats->cached_bytes / (1024.0 * 1024.0));
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static void* allocateBuffer(const FramePoolConfig* config, size_t bytes)
+{
+    assert(config != NULL);
+
+    if (bytes < FRAME_LARGE_BUFFER_BYTES)
+    {
+        return aligned_alloc(32, (bytes + 31) / 32 * 32);
+    }
+
+    const bool   huge      = usesHugePages(config);
+    const size_t alignment = huge ? FRAME_HUGE_PAGE_BYTES : (size_t)sysconf(_SC_PAGESIZE);
+    const size_t length    = mappedLength(config, bytes);
+    const size_t reserved  = length + (huge ? FRAME_HUGE_PAGE_BYTES : 0);
+
+    char* raw = (char*)mmap(NULL, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    // лишнее до и после выровненного куска возвращается ядру
+    char* start = (char*)(((uintptr_t)raw + alignment - 1) / alignment * alignment);
+    if (start > raw)
+    {
+        munmap(raw, start - raw);
+    }
+    if (raw + reserved > start + length)
+    {
+        munmap(start + length, raw + reserved - (start + length));
+    }
+
+    if (huge)
+    {
+        madvise(start, length, MADV_HUGEPAGE);
+#ifdef MADV_POPULATE_WRITE
+        if (config->populate)
+        {
+            madvise(start, length, MADV_POPULATE_WRITE);
+        }
+#endif
+    }
+    else if (config->first_touch)
+    {
+        madvise(start, length, MADV_NOHUGEPAGE);
+    }
+
+    return start;
+}
+
+
+static void freeBuffer(const FramePoolConfig* config, void* buffer, size_t bytes)
+{
+    assert(config != NULL);
+    assert(buffer != NULL);
+
+    if (bytes < FRAME_LARGE_BUFFER_BYTES)
+    {
+        free(buffer);
+        return;
+    }
+
+    munmap(buffer, mappedLength(config, bytes));
+}
+
+
+static bool usesHugePages(const FramePoolConfig* config)
+{
+    assert(config != NULL);
+
+    return config->huge_pages && !config->first_touch;
+}
+
+
+static size_t mappedLength(const FramePoolConfig* config, size_t bytes)
+{
+    assert(config != NULL);
+
+    const size_t granularity = usesHugePages(config) ? FRAME_HUGE_PAGE_BYTES : (size_t)sysconf(_SC_PAGESIZE);
+
+    return (bytes + granularity - 1) / granularity * granularity;
+}
@@ -0,0 +1,506 @@
+#include "mandelbrot_orbit_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <immintrin.h>
+
+#include "mandelbrot_field.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+// вид кадра в тех же величинах, что у SIMD ядра, чтобы c совпадали до бита
+typedef struct OrbitFrame
+{
+    double left;
+    double dx;
+    double dy;
+    double half_height;
+    double center_y;
+    int    max_iterations;
+} OrbitFrame;
+
+static void        setOrbitFrame(OrbitFrame* frame, const MandelbrotData* data);
+static double      frameRadius(const OrbitFrame* frame, const IterationField* field, double x, double y);
+static bool        frameContains(const OrbitFrame* frame, const IterationField* field, double x, double y);
+static int         buildOrbitEntry(OrbitEntry* entry, double x, double y, int max_iterations);
+static int         chooseSkip(const OrbitEntry* entry, double radius, double pixel, int max_iterations);
+static OrbitEntry* findOrbitEntry(OrbitCache* cache, const OrbitFrame* frame,
+                                  const IterationField* field, int* skip);
+static OrbitEntry* replaceOrbitEntry(OrbitCache* cache);
+static uint64_t    iterateField(IterationField* field, const OrbitFrame* frame,
+                                double reference_x, double reference_y,
+                                const OrbitStep* start, int skip);
+static int         probeSkip(const IterationField* field, const OrbitFrame* frame,
+                             const OrbitEntry* entry, int skip, int* probes);
+static inline __m256i iterateFrom(__m256d x0, __m256d y0, __m256d dx, __m256d dy,
+                                  const OrbitStep* start, int skip, int max_iterations);
+static inline __m128i packIterations(__m256i iterations);
+
+
+// public ----------------------------------------------------------------------
+
+
+void initOrbitCache(OrbitCache* cache)
+{
+    assert(cache != NULL);
+
+    memset(cache, 0, sizeof(*cache));
+}
+
+
+void destroyOrbitCache(OrbitCache* cache)
+{
+    assert(cache != NULL);
+
+    for (int i = 0; i < cache->count; i++)
+    {
+        free(cache->entries[i].steps);
+    }
+    memset(cache, 0, sizeof(*cache));
+}
+
+
+int calculateOrbitCachedField(OrbitCache* cache, MandelbrotData* data, OrbitCacheStatistics* stats)
+{
+    assert(cache != NULL);
+    assert(data  != NULL);
+    assert(stats != NULL);
+    assert(data->formula == FORMULA_MANDELBROT);
+    assert((uintptr_t)data->field.data % 32 == 0 && "iterations field must be 32-byte aligned");
+    assert(data->field.width % 8 == 0);
+    assert(fieldFitsIterations(&data->field, data->max_iterations));
+
+    memset(stats, 0, sizeof(*stats));
+
+    OrbitFrame frame = {};
+    setOrbitFrame(&frame, data);
+
+    int skip = 0;
+    OrbitEntry* entry = findOrbitEntry(cache, &frame, &data->field, &skip);
+    stats->reused = (entry != NULL);
+
+    // в кадре нет годной опорной точки: новая в его центре
+    if (!entry)
+    {
+        entry = replaceOrbitEntry(cache);
+        if (buildOrbitEntry(entry, data->center_x, data->center_y, data->max_iterations))
+        {
+            return 1;
+        }
+        skip = chooseSkip(entry, frameRadius(&frame, &data->field, entry->center_x, entry->center_y),
+                          frame.dx, data->max_iterations);
+    }
+    entry->last_used = ++cache->clock;
+
+    // проверка до расчёта кадра: пока пробы расходятся с пересчётом с нуля
+    // сильнее порога, пропуск уменьшается вдвое, и запись это запоминает;
+    // каждая попытка стоит две пробы, поэтому их не больше
+    // ORBIT_CACHE_MAX_HALVINGS, а дальше кадр считается с нуля
+    while (skip > 0)
+    {
+        stats->probe_mismatches = probeSkip(&data->field, &frame, entry, skip, &stats->probes);
+        if (stats->probe_mismatches <= ORBIT_CACHE_MAX_MISMATCH * stats->probes)
+        {
+            break;
+        }
+
+        skip = (stats->rejected_skips < ORBIT_CACHE_MAX_HALVINGS) ? skip / 2 : 0;
+        entry->max_skip = skip;
+        stats->rejected_skips++;
+    }
+    if (skip == 0)
+    {
+        stats->probe_mismatches = 0;
+    }
+
+    stats->skip       = skip;
+    stats->pixels     = (uint64_t)data->field.width * data->field.height;
+    stats->saved      = stats->pixels * skip;
+    stats->iterations = iterateField(&data->field, &frame, entry->center_x, entry->center_y,
+                                     &entry->steps[skip], skip);
+
+    return 0;
+}
+
+
+void calculateDirectIterationField(MandelbrotData* data)
+{
+    assert(data != NULL);
+    assert(data->formula == FORMULA_MANDELBROT);
+    assert((uintptr_t)data->field.data % 32 == 0 && "iterations field must be 32-byte aligned");
+    assert(data->field.width % 8 == 0);
+
+    OrbitFrame frame = {};
+    setOrbitFrame(&frame, data);
+
+    const OrbitStep zero = {};
+    iterateField(&data->field, &frame, 0, 0, &zero, 0);
+}
+
+
+void printOrbitCacheStatistics(FILE* file, const OrbitCacheStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    const double total = (double)stats->saved + stats->iterations;
+
+    fprintf(file, "orbit cache: %s reference, skip %d, %.1fM of %.1fM iterations saved (%.1f%%), "
+                  "%d of %d probes mismatched, skip halved %d times\n",
+            stats->reused ? "cached" : "new", stats->skip,
+            stats->saved / 1e6, total / 1e6, total > 0 ? 100.0 * stats->saved / total : 0.0,
+            stats->probe_mismatches, stats->probes, stats->rejected_skips);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static void setOrbitFrame(OrbitFrame* frame, const MandelbrotData* data)
+{
+    assert(frame != NULL);
+    assert(data  != NULL);
+
+    frame->left           = data->center_x - data->width / 2;
+    frame->dx             = data->width / data->field.width;
+    frame->dy             = data->height / data->field.height;
+    frame->half_height    = data->height / 2;
+    frame->center_y       = data->center_y;
+    frame->max_iterations = data->max_iterations;
+}
+
+
+// наибольшее |d| по углам кадра
+static double frameRadius(const OrbitFrame* frame, const IterationField* field, double x, double y)
+{
+    assert(frame != NULL);
+    assert(field != NULL);
+
+    const double right  = frame->left + field->width * frame->dx;
+    const double top    = field->height * frame->dy - frame->half_height + frame->center_y;
+    const double bottom = -frame->half_height + frame->center_y;
+
+    const double radius_x = fmax(fabs(frame->left - x), fabs(right - x));
+    const double radius_y = fmax(fabs(top - y), fabs(bottom - y));
+
+    return hypot(radius_x, radius_y);
+}
+
+
+static bool frameContains(const OrbitFrame* frame, const IterationField* field, double x, double y)
+{
+    assert(frame != NULL);
+    assert(field != NULL);
+
+    const double right  = frame->left + field->width * frame->dx;
+    const double top    = field->height * frame->dy - frame->half_height + frame->center_y;
+    const double bottom = -frame->half_height + frame->center_y;
+
+    return x >= frame->left && x <= right && y >= bottom && y <= top;
+}
+
+
+static int buildOrbitEntry(OrbitEntry* entry, double x, double y, int max_iterations)
+{
+    assert(entry != NULL);
+    assert(max_iterations > 0);
+
+    free(entry->steps);
+    memset(entry, 0, sizeof(*entry));
+
+    entry->steps = (OrbitStep*)calloc(max_iterations + 1, sizeof(OrbitStep));
+    if (!entry->steps)
+    {
+        fprintf(stderr, "Error while allocating memory for reference orbit\n");
+        return 1;
+    }
+    entry->center_x = x;
+    entry->center_y = y;
+    entry->max_skip = max_iterations;
+
+    // Z' = Z^2 + c0, A' = 2ZA + 1, B' = 2ZB + A^2, C' = 2ZC + 2AB
+    OrbitStep step = {};
+    int n = 0;
+    for (; n < max_iterations; n++)
+    {
+        entry->steps[n] = step;
+        if (step.z_re * step.z_re + step.z_im * step.z_im > 4.0)
+        {
+            break;
+        }
+
+        const OrbitStep s = step;
+        step.z_re = s.z_re * s.z_re - s.z_im * s.z_im + x;
+        step.z_im = 2 * s.z_re * s.z_im + y;
+        step.a_re = 2 * (s.z_re * s.a_re - s.z_im * s.a_im) + 1;
+        step.a_im = 2 * (s.z_re * s.a_im + s.z_im * s.a_re);
+        step.b_re = 2 * (s.z_re * s.b_re - s.z_im * s.b_im) + s.a_re * s.a_re - s.a_im * s.a_im;
+        step.b_im = 2 * (s.z_re * s.b_im + s.z_im * s.b_re) + 2 * s.a_re * s.a_im;
+        step.c_re = 2 * (s.z_re * s.c_re - s.z_im * s.c_im) + 2 * (s.a_re * s.b_re - s.a_im * s.b_im);
+        step.c_im = 2 * (s.z_re * s.c_im + s.z_im * s.c_re) + 2 * (s.a_re * s.b_im + s.a_im * s.b_re);
+    }
+    entry->steps[n] = step;
+    entry->length   = n;
+
+    return 0;
+}
+
+
+// K растёт, пока точки всего кадра не могли выйти за радиус 2 на прошлом
+// шаге и отброшенный член ряда, пересчитанный через A_n в сдвиг c, меньше
+// ORBIT_CACHE_TOLERANCE пикселя
+static int chooseSkip(const OrbitEntry* entry, double radius, double pixel, int max_iterations)
+{
+    assert(entry != NULL);
+
+    int limit = entry->length;
+    if (limit > entry->max_skip)
+    {
+        limit = entry->max_skip;
+    }
+    if (limit > max_iterations)
+    {
+        limit = max_iterations;
+    }
+
+    int skip = 0;
+    for (int n = 1; n <= limit; n++)
+    {
+        const OrbitStep* previous = &entry->steps[n - 1];
+        const double spread = hypot(previous->a_re, previous->a_im) * radius
+                            + hypot(previous->b_re, previous->b_im) * radius * radius
+                            + hypot(previous->c_re, previous->c_im) * radius * radius * radius;
+        if (hypot(previous->z_re, previous->z_im) + spread > 2.0)
+        {
+            break;
+        }
+
+        const OrbitStep* step = &entry->steps[n];
+        if (hypot(step->c_re, step->c_im) * radius * radius * radius
+          > ORBIT_CACHE_TOLERANCE * pixel * hypot(step->a_re, step->a_im))
+        {
+            break;
+        }
+
+        skip = n;
+    }
+
+    return skip;
+}
+
+
+// из записей с опорной точкой внутри кадра та, что даёт больший пропуск
+static OrbitEntry* findOrbitEntry(OrbitCache* cache, const OrbitFrame* frame,
+                                  const IterationField* field, int* skip)
+{
+    assert(cache != NULL);
+    assert(frame != NULL);
+    assert(field != NULL);
+    assert(skip  != NULL);
+
+    OrbitEntry* best = NULL;
+    *skip = 0;
+
+    for (int i = 0; i < cache->count; i++)
+    {
+        OrbitEntry* entry = &cache->entries[i];
+        if (!frameContains(frame, field, entry->center_x, entry->center_y))
+        {
+            continue;
+        }
+
+        const double radius = frameRadius(frame, field, entry->center_x, entry->center_y);
+        const int entry_skip = chooseSkip(entry, radius, frame->dx, frame->max_iterations);
+        if (entry_skip >= ORBIT_CACHE_MIN_SKIP && entry_skip > *skip)
+        {
+            best  = entry;
+            *skip = entry_skip;
+        }
+    }
+
+    return best;
+}
+
+
+static OrbitEntry* replaceOrbitEntry(OrbitCache* cache)
+{
+    assert(cache != NULL);
+
+    if (cache->count < ORBIT_CACHE_ENTRIES)
+    {
+        return &cache->entries[cache->count++];
+    }
+
+    OrbitEntry* oldest = &cache->entries[0];
+    for (int i = 1; i < cache->count; i++)
+    {
+        if (cache->entries[i].last_used < oldest->last_used)
+        {
+            oldest = &cache->entries[i];
+        }
+    }
+
+    return oldest;
+}
+
+
+// возвращает число итераций, сделанных после skip
+static uint64_t iterateField(IterationField* field, const OrbitFrame* frame,
+                             double reference_x, double reference_y,
+                             const OrbitStep* start, int skip)
+{
+    assert(field != NULL);
+    assert(frame != NULL);
+    assert(start != NULL);
+
+    const __m256d left      = _mm256_set1_pd(frame->left);
+    const __m256d dx        = _mm256_set1_pd(frame->dx);
+    const __m256d reference = _mm256_set1_pd(reference_x);
+    const __m256i skipped   = _mm256_set1_epi64x(skip);
+
+    __m256i iterations_done = _mm256_setzero_si256();
+
+    for (int y = 0; y < field->height; y++)
+    {
+        const double norm_y = (field->height - y) * frame->dy - frame->half_height + frame->center_y;
+        const __m256d y0 = _mm256_set1_pd(norm_y);
+        const __m256d delta_y = _mm256_set1_pd(norm_y - reference_y);
+
+        for (int x = 0; x < field->width; x += 4)
+        {
+            __m256d x_pixels = _mm256_add_pd(_mm256_set1_pd(x), _mm256_set_pd(3.0, 2.0, 1.0, 0.0));
+            __m256d x0 = _mm256_fmadd_pd(x_pixels, dx, left);
+
+            __m256i iterations = iterateFrom(x0, y0, _mm256_sub_pd(x0, reference), delta_y,
+                                             start, skip, frame->max_iterations);
+            iterations_done = _mm256_add_epi64(iterations_done, _mm256_sub_epi64(iterations, skipped));
+
+            fieldStore4(field, x, y, packIterations(iterations));
+        }
+    }
+
+    alignas(32) uint64_t lanes[4] = {};
+    _mm256_store_si256((__m256i*)lanes, iterations_done);
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+
+// пробы с пропуском skip против счёта с нуля, поле не меняется
+static int probeSkip(const IterationField* field, const OrbitFrame* frame,
+                     const OrbitEntry* entry, int skip, int* probes)
+{
+    assert(field  != NULL);
+    assert(frame  != NULL);
+    assert(entry  != NULL);
+    assert(probes != NULL);
+
+    const OrbitStep zero = {};
+    const __m256d zero_delta = _mm256_setzero_pd();
+    const __m256d left = _mm256_set1_pd(frame->left);
+    const __m256d dx   = _mm256_set1_pd(frame->dx);
+    const __m256d reference = _mm256_set1_pd(entry->center_x);
+
+    int mismatches = 0;
+    *probes = 0;
+
+    for (int y = 0; y < field->height; y += ORBIT_CACHE_PROBE_STEP)
+    {
+        const double norm_y = (field->height - y) * frame->dy - frame->half_height + frame->center_y;
+        const __m256d y0 = _mm256_set1_pd(norm_y);
+        const __m256d delta_y = _mm256_set1_pd(norm_y - entry->center_y);
+
+        for (int x = 0; x < field->width; x += 8 * ORBIT_CACHE_PROBE_STEP)
+        {
+            for (int half = 0; half < 8; half += 4)
+            {
+                __m256d x_pixels = _mm256_add_pd(_mm256_set1_pd(x + half), _mm256_set_pd(3.0, 2.0, 1.0, 0.0));
+                __m256d x0 = _mm256_fmadd_pd(x_pixels, dx, left);
+
+                __m256i skipped = iterateFrom(x0, y0, _mm256_sub_pd(x0, reference), delta_y,
+                                              &entry->steps[skip], skip, frame->max_iterations);
+                __m256i exact   = iterateFrom(x0, y0, zero_delta, zero_delta,
+                                              &zero, 0, frame->max_iterations);
+
+                const int equal = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(skipped, exact)));
+                mismatches += 4 - __builtin_popcount(equal);
+                *probes += 4;
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+
+// z_K = Z_K + ((C d + B) d + A) d, дальше как в SIMD ядре
+static inline __m256i iterateFrom(__m256d x0, __m256d y0, __m256d dx, __m256d dy,
+                                  const OrbitStep* start, int skip, int max_iterations)
+{
+    __m256d p_re = _mm256_set1_pd(start->c_re);
+    __m256d p_im = _mm256_set1_pd(start->c_im);
+
+    const double coefficients[][2] = {
+        {start->b_re, start->b_im},
+        {start->a_re, start->a_im},
+        {0.0,         0.0},
+    };
+    for (int i = 0; i < 3; i++)
+    {
+        __m256d re = _mm256_sub_pd(_mm256_mul_pd(p_re, dx), _mm256_mul_pd(p_im, dy));
+        __m256d im = _mm256_add_pd(_mm256_mul_pd(p_re, dy), _mm256_mul_pd(p_im, dx));
+        p_re = _mm256_add_pd(re, _mm256_set1_pd(coefficients[i][0]));
+        p_im = _mm256_add_pd(im, _mm256_set1_pd(coefficients[i][1]));
+    }
+
+    const __m256d z_re = _mm256_add_pd(_mm256_set1_pd(start->z_re), p_re);
+    const __m256d z_im = _mm256_add_pd(_mm256_set1_pd(start->z_im), p_im);
+
+    __m256d x2 = _mm256_mul_pd(z_re, z_re);
+    __m256d y2 = _mm256_mul_pd(z_im, z_im);
+    __m256d w  = _mm256_mul_pd(_mm256_add_pd(z_re, z_im), _mm256_add_pd(z_re, z_im));
+
+    __m256i iterations = _mm256_set1_epi64x(skip);
+    const __m256d max_radius = _mm256_set1_pd(4.0);
+
+    for (int i = skip; i < max_iterations; i++)
+    {
+        __m256d mask = _mm256_cmp_pd(_mm256_add_pd(x2, y2), max_radius, _CMP_LE_OQ);
+
+        if (!_mm256_movemask_pd(mask))
+        {
+            break;
+        }
+
+        __m256d x = _mm256_add_pd(_mm256_sub_pd(x2, y2), x0);
+        __m256d y = _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(w, x2), y2), y0);
+
+        w = _mm256_mul_pd(_mm256_add_pd(x, y), _mm256_add_pd(x, y));
+
+        x2 = _mm256_mul_pd(x, x);
+        y2 = _mm256_mul_pd(y, y);
+
+        iterations = _mm256_sub_epi64(iterations, _mm256_castpd_si256(mask));
+    }
+
+    return iterations;
+}
+
+
+static inline __m128i packIterations(__m256i iterations)
+{
+    __m128i low  = _mm256_castsi256_si128(iterations);
+    __m128i high = _mm256_extracti128_si256(iterations, 1);
+
+    return _mm_setr_epi32(
+        _mm_cvtsi128_si32(low),
+        _mm_extract_epi32(low, 2),
+        _mm_cvtsi128_si32(high),
+        _mm_extract_epi32(high, 2)
+    );
+}
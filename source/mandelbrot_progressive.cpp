@@ -0,0 +1,325 @@
+#include "mandelbrot_progressive.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include <SDL3/SDL.h>
+
+#include "mandelbrot_colorize.h"
+#include "mandelbrot_memory.h"
+#include "mandelbrot_utils.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+static FrameViewport currentViewport(const MandelbrotData* data);
+static bool sameViewport(const FrameViewport* a, const FrameViewport* b);
+static bool sameGeometry(const FrameViewport* a, const FrameViewport* b);
+static void orderTilesFromCenter(ProgressiveFrame* frame, const IterationField* field);
+static void reprojectPreviousFrame(ProgressiveFrame* frame,
+                                   uint32_t* pixels,
+                                   const FrameViewport* from,
+                                   const FrameViewport* to,
+                                   uint32_t background);
+static int  compareKeys(const void* a, const void* b);
+
+
+// public ----------------------------------------------------------------------
+
+
+int createProgressiveFrame(ProgressiveFrame* frame, int pitch, const MandelbrotData* data)
+{
+    assert(frame != NULL);
+    assert(data  != NULL);
+
+    memset(frame, 0, sizeof(*frame));
+
+    frame->pitch           = pitch;
+    frame->pixels_width    = data->field.width;
+    frame->pixels_height   = data->field.height;
+    frame->number_of_tiles = fieldTileCount(&data->field);
+
+    frame->order    = (int*)calloc(frame->number_of_tiles, sizeof(int));
+    frame->previous = (uint32_t*)acquireFrameBuffer(defaultFramePool(), (size_t)pitch * frame->pixels_height);
+
+    if (!frame->order || !frame->previous)
+    {
+        fprintf(stderr, "Error while allocating memory for progressive frame\n");
+        destroyProgressiveFrame(frame);
+        return 1;
+    }
+
+    orderTilesFromCenter(frame, &data->field);
+
+    return 0;
+}
+
+
+void destroyProgressiveFrame(ProgressiveFrame* frame)
+{
+    assert(frame != NULL);
+
+    free(frame->order);
+    releaseFrameBuffer(defaultFramePool(), frame->previous, (size_t)frame->pitch * frame->pixels_height);
+
+    frame->order    = NULL;
+    frame->previous = NULL;
+}
+
+
+bool progressiveFrameDone(const ProgressiveFrame* frame, const MandelbrotData* data)
+{
+    assert(frame != NULL);
+    assert(data  != NULL);
+
+    FrameViewport viewport = currentViewport(data);
+
+    return frame->started
+        && frame->next_tile == frame->number_of_tiles
+        && sameViewport(&frame->viewport, &viewport);
+}
+
+
+void renderProgressiveFrame(ProgressiveFrame* frame,
+                            uint32_t* pixels,
+                            MandelbrotData* data,
+                            IterationRectFunction rect_func,
+                            double budget_ms,
+                            FrameCancelFunction cancel,
+                            void* cancel_context,
+                            ProgressiveStatistics* stats)
+{
+    assert(frame     != NULL);
+    assert(pixels    != NULL);
+    assert(data      != NULL);
+    assert(rect_func != NULL);
+    assert(stats     != NULL);
+    assert(data->field.width  == frame->pixels_width);
+    assert(data->field.height == frame->pixels_height);
+
+    memset(stats, 0, sizeof(*stats));
+
+    const uint64_t start = SDL_GetPerformanceCounter();
+
+    FrameViewport viewport = currentViewport(data);
+    if (!frame->started || !sameViewport(&frame->viewport, &viewport))
+    {
+        // недосчитанный старый кадр бросаем, его плитки заполняет
+        // пересчитанное изображение, которое сейчас на экране
+        if (frame->started && !sameGeometry(&frame->viewport, &viewport))
+        {
+            reprojectPreviousFrame(frame, pixels, &frame->viewport, &viewport, data->colors[0]);
+        }
+
+        frame->viewport   = viewport;
+        frame->started    = true;
+        frame->next_tile  = 0;
+        frame->next_strip = 0;
+        frame->slices     = 0;
+        frame->frame_ms   = 0;
+        stats->restarted  = true;
+    }
+
+    while (frame->next_tile < frame->number_of_tiles)
+    {
+        FieldRect rect = fieldTileRect(&data->field, frame->order[frame->next_tile]);
+
+        rect.y      += frame->next_strip;
+        rect.height -= frame->next_strip;
+        if (rect.height > PROGRESSIVE_STRIP_ROWS)
+        {
+            rect.height = PROGRESSIVE_STRIP_ROWS;
+        }
+
+        rect_func(data, rect);
+        colorizeIterationRect(frame->pitch, pixels, data, rect);
+        stats->strips_rendered++;
+
+        frame->next_strip += rect.height;
+        if (frame->next_strip >= fieldTileRect(&data->field, frame->order[frame->next_tile]).height)
+        {
+            frame->next_tile++;
+            frame->next_strip = 0;
+        }
+
+        if (frame->next_tile == frame->number_of_tiles)
+        {
+            break;
+        }
+        if (cancel && cancel(cancel_context))
+        {
+            stats->cancelled = true;
+            break;
+        }
+        if (budget_ms > 0 && elapsedMs(start) >= budget_ms)
+        {
+            break;
+        }
+    }
+
+    frame->frame_ms += elapsedMs(start);
+
+    stats->tiles_left = frame->number_of_tiles - frame->next_tile;
+    stats->completed  = (stats->tiles_left == 0 && stats->strips_rendered > 0);
+    if (!stats->completed && stats->strips_rendered > 0)
+    {
+        frame->slices++;
+    }
+    stats->slices   = frame->slices + stats->completed;
+    stats->frame_ms = frame->frame_ms;
+}
+
+
+void printProgressiveStatistics(FILE* file, const ProgressiveStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    fprintf(file, "frame: %.2f ms of rendering in %d slices, %d strips in last slice%s\n",
+            stats->frame_ms, stats->slices, stats->strips_rendered,
+            stats->cancelled ? ", cancelled by input" : "");
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static FrameViewport currentViewport(const MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    FrameViewport viewport = {};
+    viewport.center_x       = data->center_x;
+    viewport.center_y       = data->center_y;
+    viewport.width          = data->width;
+    viewport.height         = data->height;
+    viewport.julia_re       = data->julia_re;
+    viewport.julia_im       = data->julia_im;
+    viewport.max_iterations = data->max_iterations;
+    viewport.formula        = data->formula;
+
+    return viewport;
+}
+
+
+static bool sameViewport(const FrameViewport* a, const FrameViewport* b)
+{
+    assert(a != NULL);
+    assert(b != NULL);
+
+    return sameGeometry(a, b)
+        && a->julia_re       == b->julia_re
+        && a->julia_im       == b->julia_im
+        && a->max_iterations == b->max_iterations
+        && a->formula        == b->formula;
+}
+
+
+static bool sameGeometry(const FrameViewport* a, const FrameViewport* b)
+{
+    assert(a != NULL);
+    assert(b != NULL);
+
+    return a->center_x == b->center_x
+        && a->center_y == b->center_y
+        && a->width    == b->width
+        && a->height   == b->height;
+}
+
+
+static void orderTilesFromCenter(ProgressiveFrame* frame, const IterationField* field)
+{
+    assert(frame != NULL);
+    assert(field != NULL);
+
+    const int tiles = frame->number_of_tiles;
+
+    // в старших битах квадрат расстояния до центра, в младших номер плитки
+    uint64_t* keys = (uint64_t*)calloc(tiles, sizeof(uint64_t));
+    assert(keys != NULL);
+
+    for (int slot = 0; slot < tiles; slot++)
+    {
+        FieldRect rect = fieldTileRect(field, slot);
+
+        int64_t dx = 2 * rect.x + rect.width  - field->width;
+        int64_t dy = 2 * rect.y + rect.height - field->height;
+
+        keys[slot] = ((uint64_t)(dx * dx + dy * dy) << 32) | (uint32_t)slot;
+    }
+
+    qsort(keys, tiles, sizeof(uint64_t), compareKeys);
+
+    for (int i = 0; i < tiles; i++)
+    {
+        frame->order[i] = (int)(keys[i] & 0xFFFFFFFF);
+    }
+
+    free(keys);
+}
+
+
+// пиксель x нового кадра смотрит в пиксель a * x + b старого, то же по y;
+// ближайший сосед, без сглаживания: картинка видна меньше одного кадра
+static void reprojectPreviousFrame(ProgressiveFrame* frame,
+                                   uint32_t* pixels,
+                                   const FrameViewport* from,
+                                   const FrameViewport* to,
+                                   uint32_t background)
+{
+    assert(frame  != NULL);
+    assert(pixels != NULL);
+    assert(from   != NULL);
+    assert(to     != NULL);
+
+    const int width     = frame->pixels_width;
+    const int height    = frame->pixels_height;
+    const int pitch_u32 = frame->pitch / sizeof(uint32_t);
+
+    memcpy(frame->previous, pixels, (size_t)frame->pitch * height);
+
+    const double scale_x = to->width  / from->width;
+    const double scale_y = to->height / from->height;
+
+    const double offset_x = ((to->center_x - to->width / 2) - (from->center_x - from->width / 2))
+                          * width / from->width;
+    const double offset_y = height
+                          - ((to->center_y - to->height / 2) - (from->center_y - from->height / 2))
+                          * height / from->height
+                          - height * scale_y;
+
+    for (int y = 0; y < height; y++)
+    {
+        uint32_t* row = pixels + (size_t)y * pitch_u32;
+
+        const int old_y = (int)floor(scale_y * y + offset_y);
+        if (old_y < 0 || old_y >= height)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                row[x] = background;
+            }
+            continue;
+        }
+
+        const uint32_t* old_row = frame->previous + (size_t)old_y * pitch_u32;
+        for (int x = 0; x < width; x++)
+        {
+            const int old_x = (int)floor(scale_x * x + offset_x);
+            row[x] = (old_x >= 0 && old_x < width) ? old_row[old_x] : background;
+        }
+    }
+}
+
+
+static int compareKeys(const void* a, const void* b)
+{
+    uint64_t lhs = *(const uint64_t*)a;
+    uint64_t rhs = *(const uint64_t*)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
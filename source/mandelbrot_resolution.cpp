@@ -0,0 +1,196 @@
+#include "mandelbrot_resolution.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+
+// static ----------------------------------------------------------------------
+
+
+// даже при дорогом выводе на расчёт остаётся хотя бы эта доля кадра
+const double RESOLUTION_MIN_BUDGET_SHARE = 0.25;
+
+static int predictWidth(const ResolutionController* controller);
+
+
+// public ----------------------------------------------------------------------
+
+
+void initResolutionController(ResolutionController* controller,
+                              int full_width,
+                              int full_height,
+                              double target_ms)
+{
+    assert(controller != NULL);
+    assert(full_width > 0 && full_width % 16 == 0);
+    assert(full_height > 0);
+    assert(target_ms > 0);
+
+    memset(controller, 0, sizeof(*controller));
+
+    controller->target_ms   = target_ms;
+    controller->full_width  = full_width;
+    controller->full_height = full_height;
+    controller->width       = full_width;
+    controller->height      = full_height;
+}
+
+
+void noteResolutionInput(ResolutionController* controller, uint64_t now_ns)
+{
+    assert(controller != NULL);
+
+    controller->view_changed  = true;
+    controller->last_input_ns = now_ns;
+}
+
+
+bool chooseFrameResolution(ResolutionController* controller, uint64_t now_ns)
+{
+    assert(controller != NULL);
+
+    const bool idle = (now_ns - controller->last_input_ns >= (uint64_t)RESOLUTION_IDLE_MS * 1000000);
+
+    if (controller->view_changed && !idle)
+    {
+        controller->width = predictWidth(controller);
+        controller->full_frame_shown = false;
+    }
+    else if (idle && !controller->full_frame_shown)
+    {
+        controller->width = controller->full_width;
+        controller->full_frame_shown = true;
+    }
+    else
+    {
+        return false;
+    }
+
+    controller->view_changed = false;
+    controller->height = controller->width * controller->full_height / controller->full_width;
+    if (controller->height < 1)
+    {
+        controller->height = 1;
+    }
+
+    return true;
+}
+
+
+void recordFrameCost(ResolutionController* controller,
+                     double render_ms,
+                     double frame_ms,
+                     ResolutionStatistics* stats)
+{
+    assert(controller != NULL);
+    assert(stats      != NULL);
+
+    const int slot = controller->next_sample;
+    const double pixels = (double)controller->width * controller->height;
+
+    controller->ms_per_pixel[slot] = render_ms / pixels;
+    controller->overhead_ms[slot]  = (frame_ms > render_ms) ? frame_ms - render_ms : 0;
+    controller->next_sample = (slot + 1) % RESOLUTION_HISTORY;
+    if (controller->samples < RESOLUTION_HISTORY)
+    {
+        controller->samples++;
+    }
+
+    // кадр после остановки ввода не обязан укладываться в цель
+    if (controller->full_frame_shown)
+    {
+        stats->full_frames++;
+        stats->full_ms = frame_ms;
+        return;
+    }
+
+    if (stats->motion_frames == 0 || controller->width < stats->min_width)
+    {
+        stats->min_width = controller->width;
+    }
+    if (frame_ms > stats->worst_ms)
+    {
+        stats->worst_ms = frame_ms;
+    }
+    stats->frames_over_target += (frame_ms > controller->target_ms);
+    stats->motion_ms += frame_ms;
+    stats->motion_frames++;
+}
+
+
+void printResolutionStatistics(FILE* file,
+                               const ResolutionController* controller,
+                               const ResolutionStatistics* stats)
+{
+    assert(file       != NULL);
+    assert(controller != NULL);
+    assert(stats      != NULL);
+
+    fprintf(file, "dynamic resolution: %d frames in motion, %.2f ms mean, %.2f ms worst, "
+                  "%d over %.1f ms target, width down to %d of %d; full frame %.2f ms\n",
+            stats->motion_frames,
+            stats->motion_frames ? stats->motion_ms / stats->motion_frames : 0.0,
+            stats->worst_ms, stats->frames_over_target, controller->target_ms,
+            stats->min_width, controller->full_width, stats->full_ms);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+// ширина, при которой средний из последних кадров уложился бы в цель;
+// растёт только на два шага и больше, чтобы не прыгать каждый кадр
+static int predictWidth(const ResolutionController* controller)
+{
+    assert(controller != NULL);
+
+    if (controller->samples == 0)
+    {
+        return controller->full_width;
+    }
+
+    double ms_per_pixel = 0;
+    double overhead_ms  = 0;
+    for (int i = 0; i < controller->samples; i++)
+    {
+        ms_per_pixel += controller->ms_per_pixel[i];
+        overhead_ms  += controller->overhead_ms[i];
+    }
+    ms_per_pixel /= controller->samples;
+    overhead_ms  /= controller->samples;
+
+    double budget_ms = controller->target_ms - overhead_ms;
+    if (budget_ms < controller->target_ms * RESOLUTION_MIN_BUDGET_SHARE)
+    {
+        budget_ms = controller->target_ms * RESOLUTION_MIN_BUDGET_SHARE;
+    }
+
+    int width = controller->full_width;
+    if (ms_per_pixel > 0)
+    {
+        const double pixels = budget_ms / ms_per_pixel;
+        const double exact  = sqrt(pixels * controller->full_width / controller->full_height);
+
+        if (exact < width)
+        {
+            width = (int)exact / RESOLUTION_WIDTH_STEP * RESOLUTION_WIDTH_STEP;
+        }
+    }
+
+    if (width < RESOLUTION_MIN_WIDTH)
+    {
+        width = RESOLUTION_MIN_WIDTH;
+    }
+    if (width > controller->full_width)
+    {
+        width = controller->full_width;
+    }
+    if (width > controller->width && width < controller->width + 2 * RESOLUTION_WIDTH_STEP)
+    {
+        width = controller->width;
+    }
+
+    return width;
+}
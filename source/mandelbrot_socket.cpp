@@ -0,0 +1,245 @@
+#include "mandelbrot_socket.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+
+// static ----------------------------------------------------------------------
+
+
+static int splitTcpAddress(const char* address, char* host, size_t host_size, const char** port);
+
+
+// public ----------------------------------------------------------------------
+
+
+int createListener(const char* address, char* socket_path)
+{
+    assert(address     != NULL);
+    assert(socket_path != NULL);
+
+    socket_path[0] = '\0';
+
+    if (!strncmp(address, "unix:", 5))
+    {
+        struct sockaddr_un local = {};
+        local.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(local.sun_path))
+        {
+            fprintf(stderr, "Socket path is too long: %s\n", address + 5);
+            return -1;
+        }
+        strcpy(local.sun_path, address + 5);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            perror("socket");
+            return -1;
+        }
+
+        unlink(local.sun_path);
+        if (bind(fd, (struct sockaddr*)&local, sizeof(local)) || listen(fd, SOCKET_LISTEN_BACKLOG))
+        {
+            perror("bind");
+            close(fd);
+            return -1;
+        }
+
+        strcpy(socket_path, local.sun_path);
+        return fd;
+    }
+
+    char host[256] = "";
+    const char* port = NULL;
+    if (splitTcpAddress(address, host, sizeof(host), &port))
+    {
+        return -1;
+    }
+
+    struct addrinfo hints = {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE;
+
+    struct addrinfo* info = NULL;
+    if (getaddrinfo(host, port, &hints, &info))
+    {
+        fprintf(stderr, "Could not resolve %s\n", address);
+        return -1;
+    }
+
+    int fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    int reuse = 1;
+    if (fd < 0
+     || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse))
+     || bind(fd, info->ai_addr, info->ai_addrlen)
+     || listen(fd, SOCKET_LISTEN_BACKLOG))
+    {
+        perror("bind");
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        freeaddrinfo(info);
+        return -1;
+    }
+
+    freeaddrinfo(info);
+    return fd;
+}
+
+
+int connectToAddress(const char* address)
+{
+    assert(address != NULL);
+
+    if (!strncmp(address, "unix:", 5))
+    {
+        struct sockaddr_un remote = {};
+        remote.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(remote.sun_path))
+        {
+            fprintf(stderr, "Socket path is too long: %s\n", address + 5);
+            return -1;
+        }
+        strcpy(remote.sun_path, address + 5);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr*)&remote, sizeof(remote)))
+        {
+            perror("connect");
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            return -1;
+        }
+
+        return fd;
+    }
+
+    char host[256] = "";
+    const char* port = NULL;
+    if (splitTcpAddress(address, host, sizeof(host), &port))
+    {
+        return -1;
+    }
+
+    struct addrinfo hints = {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* info = NULL;
+    if (getaddrinfo(host, port, &hints, &info))
+    {
+        fprintf(stderr, "Could not resolve %s\n", address);
+        return -1;
+    }
+
+    int fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (fd < 0 || connect(fd, info->ai_addr, info->ai_addrlen))
+    {
+        perror("connect");
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        freeaddrinfo(info);
+        return -1;
+    }
+
+    // плитки маленькие, ждать склейки пакетов незачем
+    int no_delay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    freeaddrinfo(info);
+    return fd;
+}
+
+
+int readFull(int fd, void* buffer, size_t size)
+{
+    char* current = (char*)buffer;
+
+    while (size > 0)
+    {
+        ssize_t received = recv(fd, current, size, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return 1;
+        }
+
+        current += received;
+        size    -= received;
+    }
+
+    return 0;
+}
+
+
+int writeFull(int fd, const void* buffer, size_t size)
+{
+    const char* current = (const char*)buffer;
+
+    while (size > 0)
+    {
+        ssize_t sent = send(fd, current, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return 1;
+        }
+
+        current += sent;
+        size    -= sent;
+    }
+
+    return 0;
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static int splitTcpAddress(const char* address, char* host, size_t host_size, const char** port)
+{
+    assert(address != NULL);
+    assert(host    != NULL);
+    assert(port    != NULL);
+
+    const char* colon = strrchr(address, ':');
+    if (strncmp(address, "tcp:", 4) || colon == NULL || colon < address + 4)
+    {
+        fprintf(stderr, "Unknown address %s, expected unix:/path or tcp:host:port\n", address);
+        return 1;
+    }
+
+    size_t length = colon - (address + 4);
+    if (length >= host_size)
+    {
+        fprintf(stderr, "Host name is too long: %s\n", address);
+        return 1;
+    }
+
+    memcpy(host, address + 4, length);
+    host[length] = '\0';
+    *port = colon + 1;
+
+    return 0;
+}
@@ -10,6 +10,16 @@
 #include "mandelbrot_logic_basic.h"
 #include "mandelbrot_logic_intrinsics.h"
 #include "mandelbrot_logic_array.h"
+#include "mandelbrot_logic_formula.h"
+#include "mandelbrot_colorize.h"
+#include "mandelbrot_adaptive.h"
+#include "mandelbrot_antialias.h"
+#include "mandelbrot_progressive.h"
+#include "mandelbrot_resolution.h"
+#include "mandelbrot_buddhabrot.h"
+#include "mandelbrot_thread_pool.h"
+#include "mandelbrot_orbit_cache.h"
+#include "mandelbrot_memory.h"
 
 
 // static ----------------------------------------------------------------------
@@ -17,7 +27,66 @@
 
 typedef void (*MandelbrotFunction)(int pitch, uint32_t* pixels, MandelbrotData* data);
 
-static void handleInput(SDL_Event* event, MandelbrotData* data);
+typedef enum MandelbrotBackend
+{
+    BACKEND_BASIC = 0,
+    BACKEND_ARRAY,
+    BACKEND_SIMD,
+    BACKEND_COUNT
+} MandelbrotBackend;
+
+// для z^2 + c остаются написанные вручную ядра, остальные формулы идут
+// через шаблонный движок
+static const MandelbrotFunction MANDELBROT_FUNCTIONS[BACKEND_COUNT] = {
+    calculateMandelbrotSeparated,
+    calculateMandelbrotArraySeparated,
+    calculateMandelbrotIntrinsicsSeparated,
+};
+
+static const MandelbrotFunction FORMULA_FUNCTIONS[BACKEND_COUNT] = {
+    calculateFormulaSeparated,
+    calculateFormulaArraySeparated,
+    calculateFormulaIntrinsicsSeparated,
+};
+
+static const IterationFieldFunction FORMULA_FIELD_FUNCTIONS[BACKEND_COUNT] = {
+    calculateFormulaIterationField,
+    calculateFormulaIterationFieldArray,
+    calculateFormulaIterationFieldIntrinsics,
+};
+
+static const IterationRectFunction MANDELBROT_RECT_FUNCTIONS[BACKEND_COUNT] = {
+    calculateIterationRect,
+    calculateIterationRectArray,
+    calculateIterationsRectIntrinsics,
+};
+
+static const IterationRectFunction FORMULA_RECT_FUNCTIONS[BACKEND_COUNT] = {
+    calculateFormulaIterationRect,
+    calculateFormulaIterationRectArray,
+    calculateFormulaIterationRectIntrinsics,
+};
+
+static void handleInput(SDL_Event* event, MandelbrotData* data, int window_width, int window_height);
+static bool hasPendingInput(void* context);
+static bool changesView(const SDL_Event* event);
+static int  resizeFrame(SDL_Renderer* renderer,
+                        SDL_Texture** texture,
+                        uint32_t** pixels,
+                        int* pitch,
+                        int* width,
+                        int* height,
+                        int new_width,
+                        int new_height);
+static void colorizeFrame(int pitch, uint32_t* pixels, MandelbrotData* data, ColorHistogram* histogram);
+static void renderPlainFrame(int pitch,
+                             uint32_t* pixels,
+                             MandelbrotData* data,
+                             MandelbrotFunction mandelbrot_func,
+                             IterationFieldFunction field_func,
+                             ColorHistogram* histogram);
+static void setBuddhabrotView(BuddhabrotConfig* config, const MandelbrotData* data);
+static bool sameBuddhabrotView(const BuddhabrotConfig* a, const BuddhabrotConfig* b);
 
 
 // public ---------------------------------------------------------------------
@@ -25,25 +94,119 @@ static void handleInput(SDL_Event* event, MandelbrotData* data);
 
 int startMandelbrot(int argc, char* argv[],
                     SDL_Renderer* renderer, 
-                    SDL_Texture*  texture)
+                    SDL_Texture** texture)
 {
     assert(renderer != NULL);
-    assert(texture  != NULL);
-
-    MandelbrotFunction mandelbrot_func = calculateMandelbrotIntrinsicsSeparated;
-    if (argc == 2)
+    assert(texture  != NULL && *texture != NULL);
+
+    MandelbrotBackend backend = BACKEND_SIMD;
+    FormulaType formula = FORMULA_MANDELBROT;
+    bool adaptive = false;
+    bool antialias = false;
+    FieldFormat field_format = FIELD_FORMAT_I32;
+    FieldLayout field_layout = FIELD_LAYOUT_ROWS;
+    bool progressive = false;
+    double budget_ms = 0;
+    bool buddhabrot = false;
+    bool importance = false;
+    BuddhabrotMode buddhabrot_mode = BUDDHABROT_ESCAPING;
+    bool dynamic_resolution = false;
+    double target_ms = RESOLUTION_TARGET_MS;
+    bool equalize = false;
+    bool orbit_reuse = false;
+    for (int i = 1; i < argc; i++)
     {
-        if (!strcmp(argv[1], "--basic"))
+        if (!strcmp(argv[i], "--basic"))
+        {
+            backend = BACKEND_BASIC; 
+        }
+        else if (!strcmp(argv[i], "--array"))
+        {
+            backend = BACKEND_ARRAY;
+        }
+        else if (!strcmp(argv[i], "--simd"))
+        {
+            backend = BACKEND_SIMD; 
+        }
+        else if (!strcmp(argv[i], "--julia"))
+        {
+            formula = FORMULA_JULIA;
+        }
+        else if (!strcmp(argv[i], "--burning-ship"))
+        {
+            formula = FORMULA_BURNING_SHIP;
+        }
+        else if (!strcmp(argv[i], "--multibrot3"))
+        {
+            formula = FORMULA_MULTIBROT_3;
+        }
+        else if (!strcmp(argv[i], "--multibrot4"))
+        {
+            formula = FORMULA_MULTIBROT_4;
+        }
+        else if (!strcmp(argv[i], "--multibrot5"))
+        {
+            formula = FORMULA_MULTIBROT_5;
+        }
+        else if (!strcmp(argv[i], "--adaptive"))
+        {
+            adaptive = true;
+        }
+        else if (!strcmp(argv[i], "--antialias"))
+        {
+            antialias = true;
+        }
+        else if (!strcmp(argv[i], "--field-u16"))
+        {
+            field_format = FIELD_FORMAT_U16;
+        }
+        else if (!strcmp(argv[i], "--field-tiled"))
+        {
+            field_layout = FIELD_LAYOUT_TILED;
+        }
+        else if (!strcmp(argv[i], "--field-morton"))
+        {
+            field_layout = FIELD_LAYOUT_MORTON;
+        }
+        else if (!strcmp(argv[i], "--cancellable"))
+        {
+            progressive = true;
+        }
+        else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+        {
+            progressive = true;
+            budget_ms = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--buddhabrot"))
+        {
+            buddhabrot = true;
+            buddhabrot_mode = BUDDHABROT_ESCAPING;
+        }
+        else if (!strcmp(argv[i], "--anti-buddhabrot"))
         {
-            mandelbrot_func = calculateMandelbrotSeparated; 
+            buddhabrot = true;
+            buddhabrot_mode = BUDDHABROT_ANTI;
         }
-        else if (!strcmp(argv[1], "--array"))
+        else if (!strcmp(argv[i], "--importance"))
         {
-            mandelbrot_func = calculateMandelbrotArraySeparated;
+            importance = true;
         }
-        else if (!strcmp(argv[1], "--simd"))
+        else if (!strcmp(argv[i], "--dynamic-resolution"))
         {
-            mandelbrot_func = calculateMandelbrotIntrinsicsSeparated; 
+            dynamic_resolution = true;
+        }
+        else if (!strcmp(argv[i], "--target-ms") && i + 1 < argc)
+        {
+            dynamic_resolution = true;
+            target_ms = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--equalize"))
+        {
+            equalize = true;
+        }
+        else if (!strcmp(argv[i], "--orbit-cache"))
+        {
+            orbit_reuse = true;
         }
         else
         {
@@ -51,13 +214,137 @@ int startMandelbrot(int argc, char* argv[],
         }
     }
 
-    uint32_t* pixels = (uint32_t*)SDL_aligned_alloc(32, SCREEN_WIDTH * SCREEN_HEIGHT * 4);
-    int pitch = SCREEN_WIDTH * sizeof(uint32_t);
+    MandelbrotFunction mandelbrot_func = (formula == FORMULA_MANDELBROT) 
+                                       ? MANDELBROT_FUNCTIONS[backend]
+                                       : FORMULA_FUNCTIONS[backend];
+
+    // кадр в пикселях окна, ширина кратна 16; окно можно растягивать,
+    // буферы старого размера возвращаются в пул кадров
+    int screen_width  = SCREEN_WIDTH;
+    int screen_height = SCREEN_HEIGHT;
+    int window_width  = SCREEN_WIDTH;
+    int window_height = SCREEN_HEIGHT;
+    int resize_width  = 0;
+    int resize_height = 0;
+
+    int pitch = screen_width * sizeof(uint32_t);
+    uint32_t* pixels = (uint32_t*)acquireFrameBuffer(defaultFramePool(), (size_t)pitch * screen_height);
+    if (!pixels)
+    {
+        return 1;
+    }
 
     MandelbrotData mandelbrot_data = {};
     setDefaultMandelbrot(&mandelbrot_data);
+    setMandelbrotFormula(&mandelbrot_data, formula);
+    if (setMandelbrotField(&mandelbrot_data, 
+                           screen_width, screen_height, 
+                           field_format, field_layout))
+    {
+        return 1;
+    }
+
+    // сглаживанию нужна оценка расстояния, а её считает только SIMD ядро
+    IterationFieldFunction field_func = FORMULA_FIELD_FUNCTIONS[backend];
+    if (antialias)
+    {
+        if (enableDistanceEstimation(&mandelbrot_data))
+        {
+            return 1;
+        }
+        field_func = calculateFormulaIterationFieldDistance;
+    }
+
+    // кадр по плиткам, прерываемый вводом; адаптивному числу итераций и
+    // сглаживанию нужно всё поле сразу, поэтому с ними он не сочетается
+    IterationRectFunction rect_func = (formula == FORMULA_MANDELBROT)
+                                    ? MANDELBROT_RECT_FUNCTIONS[backend]
+                                    : FORMULA_RECT_FUNCTIONS[backend];
+    ProgressiveFrame progressive_frame = {};
+    if (progressive && (adaptive || antialias))
+    {
+        printf("--budget и --cancellable не работают вместе с --adaptive и --antialias\n");
+        progressive = false;
+    }
+    if (progressive && createProgressiveFrame(&progressive_frame, pitch, &mandelbrot_data))
+    {
+        return 1;
+    }
+
+    // разрешение меняется только у обычного кадра: остальным режимам
+    // нужно поле полного размера
+    ResolutionController resolution = {};
+    ResolutionStatistics resolution_stats = {};
+    if (dynamic_resolution && (progressive || adaptive || antialias || buddhabrot))
+    {
+        printf("--dynamic-resolution и --target-ms работают только с обычным кадром\n");
+        dynamic_resolution = false;
+    }
+    if (dynamic_resolution)
+    {
+        if (target_ms <= 0)
+        {
+            target_ms = RESOLUTION_TARGET_MS;
+        }
+        initResolutionController(&resolution, screen_width, screen_height, target_ms);
+        SDL_SetTextureScaleMode(*texture, SDL_SCALEMODE_LINEAR);
+    }
+
+    // выравниванию гистограммы нужно всё поле, прогрессивный кадр красит плитки,
+    // а сглаживание перекрашивает границу обычной палитрой
+    if (equalize && (progressive || antialias || buddhabrot))
+    {
+        printf("--equalize не работает вместе с --budget, --cancellable, --antialias и --buddhabrot\n");
+        equalize = false;
+    }
+
+    // опорные орбиты считаются только для z^2 + c и полного поля
+    OrbitCache orbit_cache = {};
+    if (orbit_reuse && (formula != FORMULA_MANDELBROT || progressive || adaptive
+                     || antialias || buddhabrot || dynamic_resolution))
+    {
+        printf("--orbit-cache работает только с обычным кадром множества Мандельброта\n");
+        orbit_reuse = false;
+    }
+    if (orbit_reuse)
+    {
+        initOrbitCache(&orbit_cache);
+    }
+
+    // плотность орбит считается заново только при смене вида
+    ThreadPool* pool = NULL;
+    Buddhabrot buddhabrot_image = {};
+    BuddhabrotConfig buddhabrot_config = {};
+    BuddhabrotConfig rendered_config = {};
+    bool buddhabrot_rendered = false;
+    if (buddhabrot)
+    {
+        pool = createThreadPool(defaultThreadCount());
+        setDefaultBuddhabrotConfig(&buddhabrot_config, buddhabrot_mode);
+        buddhabrot_config.importance_sampling = importance;
+        if (createBuddhabrot(&buddhabrot_image, screen_width, screen_height, threadPoolSize(pool)))
+        {
+            destroyThreadPool(pool);
+            return 1;
+        }
+    }
+
+    ColorHistogram color_histogram = {};
+    if (equalize)
+    {
+        pool = createThreadPool(defaultThreadCount());
+        if (createColorHistogram(&color_histogram, pool))
+        {
+            destroyThreadPool(pool);
+            return 1;
+        }
+    }
+
+    // статистику кадра печатаем только после смены вида, а не на каждом проходе
+    bool view_changed = true;
 
     bool done = false;
+    int return_code = 0;
     //uint64_t start_time = 0;
     //double fps = 0;
     //uint64_t frame_time = 0;
@@ -72,36 +359,234 @@ int startMandelbrot(int argc, char* argv[],
             {
                 done = true; 
             }
-            handleInput(&event, &mandelbrot_data);
+            if (event.type == SDL_EVENT_WINDOW_RESIZED)
+            {
+                window_width  = event.window.data1;
+                window_height = event.window.data2;
+            }
+            if (event.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED)
+            {
+                resize_width  = event.window.data1;
+                resize_height = event.window.data2;
+                view_changed  = true;
+            }
+            if (dynamic_resolution && changesView(&event))
+            {
+                noteResolutionInput(&resolution, SDL_GetTicksNS());
+            }
+            view_changed |= changesView(&event);
+            handleInput(&event, &mandelbrot_data, window_width, window_height);
+        }
+
+        // вид по ширине сохраняется, по высоте подстраивается под окно
+        if (resize_width > 0)
+        {
+            if (resizeFrame(renderer, texture, &pixels, &pitch,
+                            &screen_width, &screen_height, resize_width, resize_height)
+             || setMandelbrotField(&mandelbrot_data, screen_width, screen_height,
+                                   field_format, field_layout))
+            {
+                return_code = 1;
+                break;
+            }
+            resize_width = 0;
+
+            if (dynamic_resolution)
+            {
+                initResolutionController(&resolution, screen_width, screen_height, target_ms);
+                SDL_SetTextureScaleMode(*texture, SDL_SCALEMODE_LINEAR);
+            }
+            if (progressive)
+            {
+                destroyProgressiveFrame(&progressive_frame);
+                if (createProgressiveFrame(&progressive_frame, pitch, &mandelbrot_data))
+                {
+                    return_code = 1;
+                    break;
+                }
+            }
+            if (buddhabrot)
+            {
+                destroyBuddhabrot(&buddhabrot_image);
+                if (createBuddhabrot(&buddhabrot_image, screen_width, screen_height, threadPoolSize(pool)))
+                {
+                    return_code = 1;
+                    break;
+                }
+                buddhabrot_rendered = false;
+            }
         }
 
         //start_time = SDL_GetTicks();
+        const uint64_t frame_start = SDL_GetPerformanceCounter();
+        SDL_Rect frame_rect = {0, 0, screen_width, screen_height};
+        double render_ms = 0;
 
-        mandelbrot_func(pitch, pixels, &mandelbrot_data);
-        if (!SDL_UpdateTexture(texture, NULL, pixels, pitch)) 
+        if (buddhabrot)
+        {
+            setBuddhabrotView(&buddhabrot_config, &mandelbrot_data);
+            if (buddhabrot_rendered && sameBuddhabrotView(&buddhabrot_config, &rendered_config))
+            {
+                SDL_WaitEventTimeout(NULL, IDLE_WAIT_MS);
+                continue;
+            }
+
+            BuddhabrotStatistics buddhabrot_stats = {};
+            renderBuddhabrot(&buddhabrot_image, &buddhabrot_config, pool, &buddhabrot_stats);
+            colorizeBuddhabrot(pitch, pixels, &buddhabrot_image);
+            printBuddhabrotStatistics(stdout, &buddhabrot_stats);
+
+            rendered_config     = buddhabrot_config;
+            buddhabrot_rendered = true;
+        }
+        else if (progressive)
+        {
+            // вид не менялся и кадр досчитан: ждём ввода, а не крутим цикл
+            if (progressiveFrameDone(&progressive_frame, &mandelbrot_data))
+            {
+                SDL_WaitEventTimeout(NULL, IDLE_WAIT_MS);
+                continue;
+            }
+
+            ProgressiveStatistics progressive_stats = {};
+            renderProgressiveFrame(&progressive_frame, pixels, &mandelbrot_data, rect_func,
+                                   budget_ms, hasPendingInput, NULL, &progressive_stats);
+            if (progressive_stats.completed)
+            {
+                printProgressiveStatistics(stdout, &progressive_stats);
+            }
+        }
+        else if (adaptive || antialias)
+        {
+            AdaptiveFrameStatistics stats = {};
+            if (adaptive)
+            {
+                calculateAdaptiveIterationField(&mandelbrot_data, field_func, &stats);
+            }
+            else
+            {
+                field_func(&mandelbrot_data);
+            }
+            colorizeFrame(pitch, pixels, &mandelbrot_data, equalize ? &color_histogram : NULL);
+
+            if (antialias)
+            {
+                AntialiasStatistics antialias_stats = {};
+                antialiasIterationField(pitch, pixels, &mandelbrot_data, 
+                                        ANTIALIAS_BOUNDARY, &antialias_stats);
+                if (view_changed)
+                {
+                    printAntialiasStatistics(stdout, &antialias_stats);
+                }
+            }
+
+            if (adaptive && view_changed)
+            {
+                collectFieldStatistics(&mandelbrot_data, true, &stats);
+                printAdaptiveFrameStatistics(stdout, &stats);
+            }
+            view_changed = false;
+        }
+        else if (orbit_reuse)
+        {
+            OrbitCacheStatistics orbit_stats = {};
+            if (calculateOrbitCachedField(&orbit_cache, &mandelbrot_data, &orbit_stats))
+            {
+                return_code = 1;
+                break;
+            }
+            colorizeFrame(pitch, pixels, &mandelbrot_data, equalize ? &color_histogram : NULL);
+
+            // вид стоит - кадр тот же, печатать нечего
+            if (view_changed)
+            {
+                printOrbitCacheStatistics(stdout, &orbit_stats);
+                view_changed = false;
+            }
+        }
+        else if (dynamic_resolution)
+        {
+            if (!chooseFrameResolution(&resolution, SDL_GetTicksNS()))
+            {
+                SDL_WaitEventTimeout(NULL, IDLE_WAIT_MS);
+                continue;
+            }
+
+            // вид в комплексной плоскости тот же, меньше только поле;
+            // кадр занимает левый верхний угол pixels
+            if (resolution.width != mandelbrot_data.field.width
+             && setMandelbrotField(&mandelbrot_data,
+                                   resolution.width, resolution.height,
+                                   field_format, field_layout))
+            {
+                return_code = 1;
+                break;
+            }
+            renderPlainFrame(pitch, pixels, &mandelbrot_data, mandelbrot_func, field_func,
+                             equalize ? &color_histogram : NULL);
+
+            render_ms = elapsedMs(frame_start);
+            frame_rect.w = resolution.width;
+            frame_rect.h = resolution.height;
+        }
+        else
+        {
+            renderPlainFrame(pitch, pixels, &mandelbrot_data, mandelbrot_func, field_func,
+                             equalize ? &color_histogram : NULL);
+        }
+        if (!SDL_UpdateTexture(*texture, &frame_rect, pixels, pitch)) 
         {
             printf("Texture update failed: %s\n", SDL_GetError());
         }
 
-        SDL_RenderTexture(renderer, texture, NULL, NULL);
+        const SDL_FRect source_rect = {0, 0, (float)frame_rect.w, (float)frame_rect.h};
+        SDL_RenderTexture(renderer, *texture, &source_rect, NULL);
         SDL_RenderPresent(renderer);
 
+        if (dynamic_resolution)
+        {
+            const double frame_ms = elapsedMs(frame_start);
+            recordFrameCost(&resolution, render_ms, frame_ms, &resolution_stats);
+            if (resolution.full_frame_shown && resolution_stats.motion_frames > 0)
+            {
+                printResolutionStatistics(stdout, &resolution, &resolution_stats);
+                resolution_stats = {};
+            }
+        }
+
         //frame_time = SDL_GetTicks() - start_time;
         //fps = (frame_time > 0) ? 1000.0f / frame_time : 0.0f;
         //printf("%.1f\n", fps);
     }
 
-    free(mandelbrot_data.iterations_per_pixel);
-    SDL_aligned_free(pixels);
+    if (progressive)
+    {
+        destroyProgressiveFrame(&progressive_frame);
+    }
+    if (buddhabrot)
+    {
+        destroyBuddhabrot(&buddhabrot_image);
+    }
+    if (equalize)
+    {
+        destroyColorHistogram(&color_histogram);
+    }
+    if (orbit_reuse)
+    {
+        destroyOrbitCache(&orbit_cache);
+    }
+    destroyThreadPool(pool);
+    freeMandelbrot(&mandelbrot_data);
+    releaseFrameBuffer(defaultFramePool(), pixels, (size_t)pitch * screen_height);
 
-    return 0;
+    return return_code;
 }
 
 
 // static ----------------------------------------------------------------------
 
 
-static void handleInput(SDL_Event* event, MandelbrotData* data)
+static void handleInput(SDL_Event* event, MandelbrotData* data, int window_width, int window_height)
 {
     assert(event != NULL);
     assert(data  != NULL);
@@ -136,6 +621,23 @@ static void handleInput(SDL_Event* event, MandelbrotData* data)
                 data->center_y += data->height * MOVE_SPEED;
                 break;
 
+            // параметр c множества Жюлиа
+            case SDLK_L:
+                data->julia_re += JULIA_STEP;
+                break;
+
+            case SDLK_J:
+                data->julia_re -= JULIA_STEP;
+                break;
+
+            case SDLK_I:
+                data->julia_im += JULIA_STEP;
+                break;
+
+            case SDLK_K:
+                data->julia_im -= JULIA_STEP;
+                break;
+
             default:
                 break;
         }
@@ -148,8 +650,8 @@ static void handleInput(SDL_Event* event, MandelbrotData* data)
             float mouse_y; 
             SDL_GetMouseState(&mouse_x, &mouse_y);
 
-            double norm_x = (mouse_x / (double)SCREEN_WIDTH) * data->width;
-            double norm_y = ((SCREEN_HEIGHT - mouse_y) / (double)SCREEN_HEIGHT) * data->height;
+            double norm_x = (mouse_x / (double)window_width) * data->width;
+            double norm_y = ((window_height - mouse_y) / (double)window_height) * data->height;
 
             data->center_x = data->center_x + (norm_x - data->width / 2);
             data->center_y = data->center_y + (norm_y - data->height / 2);                
@@ -157,3 +659,140 @@ static void handleInput(SDL_Event* event, MandelbrotData* data)
     }
 }
 
+
+// новое нажатие или клик означают, что текущий кадр, скорее всего, уже
+// не нужен; события остаются в очереди и разбираются в основном цикле
+static bool hasPendingInput(void*)
+{
+    SDL_PumpEvents();
+
+    return SDL_HasEvent(SDL_EVENT_KEY_DOWN)
+        || SDL_HasEvent(SDL_EVENT_MOUSE_BUTTON_DOWN)
+        || SDL_HasEvent(SDL_EVENT_QUIT);
+}
+
+
+static bool changesView(const SDL_Event* event)
+{
+    assert(event != NULL);
+
+    return event->type == SDL_EVENT_KEY_DOWN
+        || (event->type == SDL_EVENT_MOUSE_BUTTON_DOWN && event->button.button == SDL_BUTTON_LEFT);
+}
+
+
+// кадр и текстура пересоздаются под новый размер окна в пикселях
+static int resizeFrame(SDL_Renderer* renderer,
+                       SDL_Texture** texture,
+                       uint32_t** pixels,
+                       int* pitch,
+                       int* width,
+                       int* height,
+                       int new_width,
+                       int new_height)
+{
+    assert(renderer != NULL);
+    assert(texture  != NULL);
+    assert(pixels   != NULL);
+    assert(pitch    != NULL);
+    assert(width    != NULL);
+    assert(height   != NULL);
+
+    new_width  = (new_width >= 16) ? new_width / 16 * 16 : 16;
+    new_height = (new_height >= 1) ? new_height : 1;
+
+    const int new_pitch = new_width * sizeof(uint32_t);
+    uint32_t* new_pixels = (uint32_t*)acquireFrameBuffer(defaultFramePool(), (size_t)new_pitch * new_height);
+    if (!new_pixels)
+    {
+        return 1;
+    }
+
+    SDL_Texture* new_texture = SDL_CreateTexture(renderer,
+                                                 SDL_PIXELFORMAT_RGBA32,
+                                                 SDL_TEXTUREACCESS_STREAMING,
+                                                 new_width,
+                                                 new_height);
+    if (!new_texture)
+    {
+        fprintf(stderr, "Could not create texture: %s\n", SDL_GetError());
+        releaseFrameBuffer(defaultFramePool(), new_pixels, (size_t)new_pitch * new_height);
+        return 1;
+    }
+
+    releaseFrameBuffer(defaultFramePool(), *pixels, (size_t)*pitch * *height);
+    SDL_DestroyTexture(*texture);
+
+    *pixels  = new_pixels;
+    *texture = new_texture;
+    *pitch   = new_pitch;
+    *width   = new_width;
+    *height  = new_height;
+
+    return 0;
+}
+
+
+// histogram == NULL - обычная палитра
+static void colorizeFrame(int pitch, uint32_t* pixels, MandelbrotData* data, ColorHistogram* histogram)
+{
+    assert(pixels != NULL);
+    assert(data   != NULL);
+
+    if (!histogram)
+    {
+        colorizeIterationField(pitch, pixels, data);
+    }
+    else if (colorizeEqualizedIterationField(pitch, pixels, data, histogram))
+    {
+        // без памяти под бины кадр хотя бы раскрашен палитрой
+        colorizeIterationField(pitch, pixels, data);
+    }
+}
+
+
+static void renderPlainFrame(int pitch,
+                             uint32_t* pixels,
+                             MandelbrotData* data,
+                             MandelbrotFunction mandelbrot_func,
+                             IterationFieldFunction field_func,
+                             ColorHistogram* histogram)
+{
+    assert(pixels          != NULL);
+    assert(data            != NULL);
+    assert(mandelbrot_func != NULL);
+    assert(field_func      != NULL);
+
+    if (!histogram)
+    {
+        mandelbrot_func(pitch, pixels, data);
+        return;
+    }
+
+    field_func(data);
+    colorizeFrame(pitch, pixels, data, histogram);
+}
+
+
+static void setBuddhabrotView(BuddhabrotConfig* config, const MandelbrotData* data)
+{
+    assert(config != NULL);
+    assert(data   != NULL);
+
+    config->center_x    = data->center_x;
+    config->center_y    = data->center_y;
+    config->view_width  = data->width;
+    config->view_height = data->height;
+}
+
+
+static bool sameBuddhabrotView(const BuddhabrotConfig* a, const BuddhabrotConfig* b)
+{
+    assert(a != NULL);
+    assert(b != NULL);
+
+    return a->center_x    == b->center_x
+        && a->center_y    == b->center_y
+        && a->view_width  == b->view_width
+        && a->view_height == b->view_height;
+}
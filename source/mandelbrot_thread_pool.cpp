@@ -0,0 +1,333 @@
+#include "mandelbrot_thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+
+typedef struct ParallelBatch ParallelBatch;
+
+typedef struct PoolTask
+{
+    ThreadTask       task;
+    void*            context;
+    int              index;
+    ParallelBatch*   batch;        // не NULL - помощник runParallel
+    struct PoolTask* next;
+} PoolTask;
+
+struct ParallelBatch
+{
+    ThreadTask       task;
+    void*            context;
+    int              count;
+    std::atomic<int> next_index;
+    int              helpers_running;
+};
+
+struct ThreadPool
+{
+    int                     threads;
+    std::thread*            workers;
+
+    std::mutex              lock;
+    std::condition_variable has_work;
+    std::condition_variable batch_done;
+    PoolTask*               head;
+    PoolTask*               tail;
+    bool                    stopping;
+};
+
+
+// static ----------------------------------------------------------------------
+
+
+static void runPoolWorker(ThreadPool* pool);
+static void runBatch(ParallelBatch* batch);
+static void pushTask(ThreadPool* pool, PoolTask* task);
+static void removeTask(ThreadPool* pool, PoolTask* task);
+
+
+// public ----------------------------------------------------------------------
+
+
+ThreadPool* createThreadPool(int threads)
+{
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+
+    ThreadPool* pool = new ThreadPool();
+    pool->threads = threads;
+    pool->workers = new std::thread[threads - 1];
+
+    for (int i = 0; i < threads - 1; i++)
+    {
+        pool->workers[i] = std::thread(runPoolWorker, pool);
+    }
+
+    return pool;
+}
+
+
+void destroyThreadPool(ThreadPool* pool)
+{
+    if (!pool)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pool->stopping = true;
+    }
+    pool->has_work.notify_all();
+
+    for (int i = 0; i < pool->threads - 1; i++)
+    {
+        pool->workers[i].join();
+    }
+
+    // оставшиеся задачи submitTask уже никто не выполнит
+    while (pool->head)
+    {
+        PoolTask* task = pool->head;
+        pool->head = task->next;
+        free(task);
+    }
+
+    delete[] pool->workers;
+    delete pool;
+}
+
+
+int threadPoolSize(const ThreadPool* pool)
+{
+    return pool ? pool->threads : 1;
+}
+
+
+int defaultThreadCount()
+{
+    int threads = (int)std::thread::hardware_concurrency();
+
+    return threads > 0 ? threads : 1;
+}
+
+
+void runParallel(ThreadPool* pool, int count, ThreadTask task, void* context)
+{
+    assert(task != NULL);
+
+    if (count <= 0)
+    {
+        return;
+    }
+
+    ParallelBatch batch;
+    batch.task            = task;
+    batch.context         = context;
+    batch.count           = count;
+    batch.next_index      = 0;
+    batch.helpers_running = 0;
+
+    int helpers = pool ? pool->threads - 1 : 0;
+    if (helpers > count - 1)
+    {
+        helpers = count - 1;
+    }
+
+    PoolTask* helper_tasks = NULL;
+    if (helpers > 0)
+    {
+        helper_tasks = (PoolTask*)calloc(helpers, sizeof(PoolTask));
+        if (!helper_tasks)
+        {
+            helpers = 0;
+        }
+    }
+
+    if (helpers > 0)
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        for (int i = 0; i < helpers; i++)
+        {
+            helper_tasks[i].batch = &batch;
+            pushTask(pool, &helper_tasks[i]);
+        }
+    }
+    if (helpers > 0)
+    {
+        pool->has_work.notify_all();
+    }
+
+    runBatch(&batch);
+
+    if (helpers > 0)
+    {
+        // помощники, которые так и не начали, уже не нужны: задачи кончились
+        std::unique_lock<std::mutex> guard(pool->lock);
+        for (int i = 0; i < helpers; i++)
+        {
+            removeTask(pool, &helper_tasks[i]);
+        }
+        pool->batch_done.wait(guard, [&batch] { return batch.helpers_running == 0; });
+    }
+
+    free(helper_tasks);
+}
+
+
+int submitTask(ThreadPool* pool, ThreadTask task, void* context, int index)
+{
+    assert(task != NULL);
+
+    if (!pool || pool->threads == 1)
+    {
+        task(context, index);
+        return 0;
+    }
+
+    PoolTask* pool_task = (PoolTask*)calloc(1, sizeof(PoolTask));
+    if (!pool_task)
+    {
+        fprintf(stderr, "Error while allocating memory for pool task\n");
+        return 1;
+    }
+
+    pool_task->task    = task;
+    pool_task->context = context;
+    pool_task->index   = index;
+
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pushTask(pool, pool_task);
+    }
+    pool->has_work.notify_one();
+
+    return 0;
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static void runPoolWorker(ThreadPool* pool)
+{
+    assert(pool != NULL);
+
+    std::unique_lock<std::mutex> guard(pool->lock);
+
+    while (true)
+    {
+        pool->has_work.wait(guard, [pool] { return pool->stopping || pool->head != NULL; });
+        if (pool->stopping)
+        {
+            return;
+        }
+
+        PoolTask* task = pool->head;
+        removeTask(pool, task);
+
+        ParallelBatch* batch = task->batch;
+        if (batch)
+        {
+            batch->helpers_running++;
+        }
+
+        guard.unlock();
+
+        if (batch)
+        {
+            runBatch(batch);
+        }
+        else
+        {
+            task->task(task->context, task->index);
+            free(task);
+        }
+
+        guard.lock();
+
+        if (batch)
+        {
+            batch->helpers_running--;
+            pool->batch_done.notify_all();
+        }
+    }
+}
+
+
+static void runBatch(ParallelBatch* batch)
+{
+    assert(batch != NULL);
+
+    while (true)
+    {
+        int index = batch->next_index.fetch_add(1, std::memory_order_relaxed);
+        if (index >= batch->count)
+        {
+            return;
+        }
+
+        batch->task(batch->context, index);
+    }
+}
+
+
+// вызывается под pool->lock
+static void pushTask(ThreadPool* pool, PoolTask* task)
+{
+    assert(pool != NULL);
+    assert(task != NULL);
+
+    task->next = NULL;
+    if (pool->tail)
+    {
+        pool->tail->next = task;
+    }
+    else
+    {
+        pool->head = task;
+    }
+    pool->tail = task;
+}
+
+
+// вызывается под pool->lock, задачи может уже не быть в очереди
+static void removeTask(ThreadPool* pool, PoolTask* task)
+{
+    assert(pool != NULL);
+    assert(task != NULL);
+
+    PoolTask* previous = NULL;
+    for (PoolTask* current = pool->head; current; current = current->next)
+    {
+        if (current != task)
+        {
+            previous = current;
+            continue;
+        }
+
+        if (previous)
+        {
+            previous->next = current->next;
+        }
+        else
+        {
+            pool->head = current->next;
+        }
+        if (pool->tail == current)
+        {
+            pool->tail = previous;
+        }
+        current->next = NULL;
+        return;
+    }
+}
@@ -0,0 +1,392 @@
+#include "mandelbrot_thumbnails.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <immintrin.h>
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+
+#include "mandelbrot_utils.h"
+
+
+// static ----------------------------------------------------------------------
+
+
+typedef struct ThumbnailContext
+{
+    ThumbnailBatch*       batch;
+    uint64_t              total_pixels;
+    std::atomic<uint64_t> iterations;
+    std::atomic<uint64_t> lane_steps;
+} ThumbnailContext;
+
+// позиция в общей очереди пикселей пакета
+typedef struct PixelCursor
+{
+    uint64_t next;
+    uint64_t end;
+    int      thumbnail;
+    int      x;
+    int      y;
+} PixelCursor;
+
+static void renderChunk(void* context, int chunk);
+static bool nextPixel(const ThumbnailBatch* batch,
+                      PixelCursor* cursor,
+                      uint64_t* pixel,
+                      double* cx,
+                      double* cy,
+                      int* max_iterations);
+
+
+// public ----------------------------------------------------------------------
+
+
+int createThumbnailBatch(ThumbnailBatch* batch,
+                         int width,
+                         int height,
+                         int capacity,
+                         const uint32_t* palette)
+{
+    assert(batch != NULL);
+    assert(width > 0 && height > 0);
+    assert(capacity > 0);
+
+    memset(batch, 0, sizeof(*batch));
+
+    batch->width    = width;
+    batch->height   = height;
+    batch->capacity = capacity;
+    batch->bytes    = (size_t)capacity * width * height * sizeof(uint32_t);
+
+    batch->views  = (ThumbnailView*)calloc(capacity, sizeof(ThumbnailView));
+    batch->pixels = (uint32_t*)aligned_alloc(32, (batch->bytes + 31) / 32 * 32);
+
+    if (!batch->views || !batch->pixels)
+    {
+        fprintf(stderr, "Error while allocating memory for thumbnail batch\n");
+        destroyThumbnailBatch(batch);
+        return 1;
+    }
+
+    if (palette)
+    {
+        memcpy(batch->colors, palette, sizeof(batch->colors));
+    }
+    else
+    {
+        MandelbrotData palette_data = {};
+        setMandelbrotPalette(&palette_data);
+        memcpy(batch->colors, palette_data.colors, sizeof(batch->colors));
+    }
+
+    return 0;
+}
+
+
+void destroyThumbnailBatch(ThumbnailBatch* batch)
+{
+    assert(batch != NULL);
+
+    free(batch->views);
+    free(batch->pixels);
+
+    batch->views  = NULL;
+    batch->pixels = NULL;
+    batch->count  = 0;
+}
+
+
+int addThumbnail(ThumbnailBatch* batch, const RenderViewport* viewport)
+{
+    assert(batch    != NULL);
+    assert(viewport != NULL);
+
+    if (batch->count == batch->capacity)
+    {
+        fprintf(stderr, "Thumbnail batch is full (%d thumbnails)\n", batch->capacity);
+        return 1;
+    }
+    if (viewport->width != batch->width || viewport->height != batch->height)
+    {
+        fprintf(stderr, "Thumbnail is %dx%d, batch is %dx%d\n",
+                viewport->width, viewport->height, batch->width, batch->height);
+        return 1;
+    }
+    if (viewport->formula != FORMULA_MANDELBROT)
+    {
+        fprintf(stderr, "Thumbnail batches render only z^2 + c\n");
+        return 1;
+    }
+
+    // как в MandelbrotData после updateDimension
+    const double view_width  = viewport->view_width;
+    const double view_height = view_width * batch->height / batch->width;
+
+    ThumbnailView* view = &batch->views[batch->count];
+    view->left           = viewport->center_x - view_width / 2;
+    view->dx             = view_width / batch->width;
+    view->dy             = view_height / batch->height;
+    view->half_height    = view_height / 2;
+    view->center_y       = viewport->center_y;
+    view->max_iterations = viewport->max_iterations;
+
+    batch->count++;
+
+    return 0;
+}
+
+
+void clearThumbnailBatch(ThumbnailBatch* batch)
+{
+    assert(batch != NULL);
+
+    batch->count = 0;
+}
+
+
+const uint32_t* thumbnailPixels(const ThumbnailBatch* batch, int index)
+{
+    assert(batch != NULL);
+    assert(index >= 0 && index < batch->count);
+
+    return batch->pixels + (size_t)index * batch->width * batch->height;
+}
+
+
+void renderThumbnailBatch(ThumbnailBatch* batch, ThreadPool* pool, ThumbnailStatistics* stats)
+{
+    assert(batch != NULL);
+    assert(stats != NULL);
+
+    memset(stats, 0, sizeof(*stats));
+
+    const uint64_t start = SDL_GetPerformanceCounter();
+
+    ThumbnailContext context;
+    context.batch        = batch;
+    context.total_pixels = (uint64_t)batch->count * batch->width * batch->height;
+    context.iterations   = 0;
+    context.lane_steps   = 0;
+
+    const int chunks = (int)((context.total_pixels + THUMBNAIL_CHUNK_PIXELS - 1) / THUMBNAIL_CHUNK_PIXELS);
+    runParallel(pool, chunks, renderChunk, &context);
+
+    stats->thumbnails = batch->count;
+    stats->chunks     = chunks;
+    stats->pixels     = context.total_pixels;
+    stats->iterations = context.iterations;
+    stats->lane_steps = context.lane_steps;
+    stats->ms         = elapsedMs(start);
+}
+
+
+void printThumbnailStatistics(FILE* file, const ThumbnailStatistics* stats)
+{
+    assert(file  != NULL);
+    assert(stats != NULL);
+
+    const double lanes = (double)stats->lane_steps * THUMBNAIL_LANES;
+
+    fprintf(file, "%d thumbnails in %.2f ms (%.0f thumbnails/s), %d chunks, "
+                  "%.1f iterations per pixel, %.1f%% lanes busy\n",
+            stats->thumbnails, stats->ms,
+            stats->ms > 0 ? stats->thumbnails * 1000.0 / stats->ms : 0.0,
+            stats->chunks,
+            stats->pixels ? (double)stats->iterations / stats->pixels : 0.0,
+            lanes > 0 ? 100.0 * stats->iterations / lanes : 0.0);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+// та же арифметика, что у calculateIterationsFromPositionIntrinsics,
+// только дорожка, закончившая пиксель, сразу берёт следующий из куска
+static void renderChunk(void* context, int chunk)
+{
+    assert(context != NULL);
+
+    ThumbnailContext* thumbnails = (ThumbnailContext*)context;
+    const ThumbnailBatch* batch = thumbnails->batch;
+    const int pixels_per_thumbnail = batch->width * batch->height;
+
+    PixelCursor cursor = {};
+    cursor.next = (uint64_t)chunk * THUMBNAIL_CHUNK_PIXELS;
+    cursor.end  = cursor.next + THUMBNAIL_CHUNK_PIXELS;
+    if (cursor.end > thumbnails->total_pixels)
+    {
+        cursor.end = thumbnails->total_pixels;
+    }
+    cursor.thumbnail = (int)(cursor.next / pixels_per_thumbnail);
+    cursor.y         = (int)(cursor.next % pixels_per_thumbnail) / batch->width;
+    cursor.x         = (int)(cursor.next % pixels_per_thumbnail) % batch->width;
+
+    alignas(32) double   lane_cx[THUMBNAIL_LANES]     = {};
+    alignas(32) double   lane_cy[THUMBNAIL_LANES]     = {};
+    alignas(32) double   lane_x2[THUMBNAIL_LANES]     = {};
+    alignas(32) double   lane_y2[THUMBNAIL_LANES]     = {};
+    alignas(32) double   lane_w[THUMBNAIL_LANES]      = {};
+    alignas(32) double   lane_n[THUMBNAIL_LANES]      = {};
+    alignas(32) double   lane_max[THUMBNAIL_LANES]    = {};
+    alignas(32) double   lane_active[THUMBNAIL_LANES] = {};
+    uint64_t             lane_pixel[THUMBNAIL_LANES]  = {};
+    int                  lane_limit[THUMBNAIL_LANES]  = {};
+
+    int active = 0;
+    for (int lane = 0; lane < THUMBNAIL_LANES; lane++)
+    {
+        if (nextPixel(batch, &cursor, &lane_pixel[lane], &lane_cx[lane], &lane_cy[lane], &lane_limit[lane]))
+        {
+            lane_max[lane]    = lane_limit[lane];
+            lane_active[lane] = 1;
+            active++;
+        }
+    }
+
+    const __m256d radius2 = _mm256_set1_pd(4.0);
+    const __m256d one     = _mm256_set1_pd(1.0);
+
+    uint64_t iterations = 0;
+    uint64_t lane_steps = 0;
+
+    while (active > 0)
+    {
+        // две независимые четвёрки: пока одна ждёт умножения, считает другая
+        const __m256d cx_lo       = _mm256_load_pd(lane_cx);
+        const __m256d cx_hi       = _mm256_load_pd(lane_cx + 4);
+        const __m256d cy_lo       = _mm256_load_pd(lane_cy);
+        const __m256d cy_hi       = _mm256_load_pd(lane_cy + 4);
+        const __m256d max_iter_lo = _mm256_load_pd(lane_max);
+        const __m256d max_iter_hi = _mm256_load_pd(lane_max + 4);
+        const __m256d active_lo   = _mm256_cmp_pd(_mm256_load_pd(lane_active),     one, _CMP_EQ_OQ);
+        const __m256d active_hi   = _mm256_cmp_pd(_mm256_load_pd(lane_active + 4), one, _CMP_EQ_OQ);
+
+        __m256d x2_lo = _mm256_load_pd(lane_x2);
+        __m256d x2_hi = _mm256_load_pd(lane_x2 + 4);
+        __m256d y2_lo = _mm256_load_pd(lane_y2);
+        __m256d y2_hi = _mm256_load_pd(lane_y2 + 4);
+        __m256d w_lo  = _mm256_load_pd(lane_w);
+        __m256d w_hi  = _mm256_load_pd(lane_w + 4);
+        __m256d n_lo  = _mm256_load_pd(lane_n);
+        __m256d n_hi  = _mm256_load_pd(lane_n + 4);
+
+        // пустые дорожки стоят в c = 0 и никогда не заканчиваются
+        int finished = 0;
+        while (true)
+        {
+            __m256d outside_lo = _mm256_cmp_pd(_mm256_add_pd(x2_lo, y2_lo), radius2, _CMP_NLE_UQ);
+            __m256d outside_hi = _mm256_cmp_pd(_mm256_add_pd(x2_hi, y2_hi), radius2, _CMP_NLE_UQ);
+            __m256d done_lo    = _mm256_and_pd(active_lo,
+                                               _mm256_or_pd(outside_lo, _mm256_cmp_pd(n_lo, max_iter_lo, _CMP_GE_OQ)));
+            __m256d done_hi    = _mm256_and_pd(active_hi,
+                                               _mm256_or_pd(outside_hi, _mm256_cmp_pd(n_hi, max_iter_hi, _CMP_GE_OQ)));
+
+            finished = _mm256_movemask_pd(done_lo) | (_mm256_movemask_pd(done_hi) << 4);
+            if (finished)
+            {
+                break;
+            }
+
+            __m256d x_lo = _mm256_add_pd(_mm256_sub_pd(x2_lo, y2_lo), cx_lo);
+            __m256d x_hi = _mm256_add_pd(_mm256_sub_pd(x2_hi, y2_hi), cx_hi);
+            __m256d y_lo = _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(w_lo, x2_lo), y2_lo), cy_lo);
+            __m256d y_hi = _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(w_hi, x2_hi), y2_hi), cy_hi);
+
+            w_lo  = _mm256_mul_pd(_mm256_add_pd(x_lo, y_lo), _mm256_add_pd(x_lo, y_lo));
+            w_hi  = _mm256_mul_pd(_mm256_add_pd(x_hi, y_hi), _mm256_add_pd(x_hi, y_hi));
+            x2_lo = _mm256_mul_pd(x_lo, x_lo);
+            x2_hi = _mm256_mul_pd(x_hi, x_hi);
+            y2_lo = _mm256_mul_pd(y_lo, y_lo);
+            y2_hi = _mm256_mul_pd(y_hi, y_hi);
+            n_lo  = _mm256_add_pd(n_lo, one);
+            n_hi  = _mm256_add_pd(n_hi, one);
+
+            lane_steps++;
+        }
+
+        _mm256_store_pd(lane_x2,     x2_lo);
+        _mm256_store_pd(lane_x2 + 4, x2_hi);
+        _mm256_store_pd(lane_y2,     y2_lo);
+        _mm256_store_pd(lane_y2 + 4, y2_hi);
+        _mm256_store_pd(lane_w,      w_lo);
+        _mm256_store_pd(lane_w + 4,  w_hi);
+        _mm256_store_pd(lane_n,      n_lo);
+        _mm256_store_pd(lane_n + 4,  n_hi);
+
+        for (int lane = 0; lane < THUMBNAIL_LANES; lane++)
+        {
+            if (!(finished & (1 << lane)))
+            {
+                continue;
+            }
+
+            const int count = (int)lane_n[lane];
+            batch->pixels[lane_pixel[lane]] = (count == lane_limit[lane])
+                                            ? batch->colors[0]
+                                            : batch->colors[count & (MAX_ITERATIONS - 1)];
+            iterations += count;
+
+            lane_x2[lane] = 0;
+            lane_y2[lane] = 0;
+            lane_w[lane]  = 0;
+            lane_n[lane]  = 0;
+            if (nextPixel(batch, &cursor, &lane_pixel[lane], &lane_cx[lane], &lane_cy[lane], &lane_limit[lane]))
+            {
+                lane_max[lane] = lane_limit[lane];
+            }
+            else
+            {
+                lane_cx[lane]     = 0;
+                lane_cy[lane]     = 0;
+                lane_active[lane] = 0;
+                active--;
+            }
+        }
+    }
+
+    thumbnails->iterations += iterations;
+    thumbnails->lane_steps += lane_steps;
+}
+
+
+static bool nextPixel(const ThumbnailBatch* batch,
+                      PixelCursor* cursor,
+                      uint64_t* pixel,
+                      double* cx,
+                      double* cy,
+                      int* max_iterations)
+{
+    assert(batch  != NULL);
+    assert(cursor != NULL);
+
+    if (cursor->next == cursor->end)
+    {
+        return false;
+    }
+
+    const ThumbnailView* view = &batch->views[cursor->thumbnail];
+
+    *pixel          = cursor->next;
+    *cx             = fma((double)cursor->x, view->dx, view->left);
+    *cy             = (batch->height - cursor->y) * view->dy - view->half_height + view->center_y;
+    *max_iterations = view->max_iterations;
+
+    cursor->next++;
+    if (++cursor->x == batch->width)
+    {
+        cursor->x = 0;
+        if (++cursor->y == batch->height)
+        {
+            cursor->y = 0;
+            cursor->thumbnail++;
+        }
+    }
+
+    return true;
+}
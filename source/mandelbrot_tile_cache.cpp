@@ -0,0 +1,262 @@
+#include "mandelbrot_tile_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+// static ----------------------------------------------------------------------
+
+
+static int  findEntry(const TileCache* cache, const TileKey* key);
+static void unlinkEntry(TileCache* cache, int entry);
+static void linkNewest(TileCache* cache, int entry);
+static void removeFromChain(TileCache* cache, int entry);
+static int  bucketOf(const TileCache* cache, const TileKey* key);
+
+
+// public ----------------------------------------------------------------------
+
+
+int createTileCache(TileCache* cache, int capacity, size_t entry_bytes)
+{
+    assert(cache != NULL);
+    assert(capacity > 0);
+    assert(entry_bytes > 0);
+
+    memset(cache, 0, sizeof(*cache));
+
+    cache->capacity    = capacity;
+    cache->entry_bytes = (entry_bytes + 31) / 32 * 32;
+    cache->newest      = -1;
+    cache->oldest      = -1;
+
+    // вдвое больше корзин, чем плиток, чтобы цепочки оставались короткими
+    cache->number_of_buckets = 1;
+    while (cache->number_of_buckets < 2 * capacity)
+    {
+        cache->number_of_buckets *= 2;
+    }
+
+    cache->arena   = (uint8_t*)aligned_alloc(32, (size_t)capacity * cache->entry_bytes);
+    cache->keys    = (TileKey*)calloc(capacity, sizeof(TileKey));
+    cache->newer   = (int*)calloc(capacity, sizeof(int));
+    cache->older   = (int*)calloc(capacity, sizeof(int));
+    cache->chain   = (int*)calloc(capacity, sizeof(int));
+    cache->buckets = (int*)calloc(cache->number_of_buckets, sizeof(int));
+
+    if (!cache->arena || !cache->keys || !cache->newer
+     || !cache->older || !cache->chain || !cache->buckets)
+    {
+        fprintf(stderr, "Error while allocating memory for tile cache\n");
+        destroyTileCache(cache);
+        return 1;
+    }
+
+    for (int bucket = 0; bucket < cache->number_of_buckets; bucket++)
+    {
+        cache->buckets[bucket] = -1;
+    }
+
+    return 0;
+}
+
+
+void destroyTileCache(TileCache* cache)
+{
+    assert(cache != NULL);
+
+    free(cache->arena);
+    free(cache->keys);
+    free(cache->newer);
+    free(cache->older);
+    free(cache->chain);
+    free(cache->buckets);
+
+    memset(cache, 0, sizeof(*cache));
+}
+
+
+const void* findCachedTile(TileCache* cache, const TileKey* key)
+{
+    assert(cache != NULL);
+    assert(key   != NULL);
+
+    int entry = findEntry(cache, key);
+    if (entry < 0)
+    {
+        return NULL;
+    }
+
+    unlinkEntry(cache, entry);
+    linkNewest(cache, entry);
+
+    return cache->arena + (size_t)entry * cache->entry_bytes;
+}
+
+
+void* insertCachedTile(TileCache* cache, const TileKey* key)
+{
+    assert(cache != NULL);
+    assert(key   != NULL);
+
+    int entry = findEntry(cache, key);
+    if (entry >= 0)
+    {
+        unlinkEntry(cache, entry);
+        linkNewest(cache, entry);
+
+        return cache->arena + (size_t)entry * cache->entry_bytes;
+    }
+
+    if (cache->count < cache->capacity)
+    {
+        entry = cache->count++;
+    }
+    else
+    {
+        entry = cache->oldest;
+        unlinkEntry(cache, entry);
+        removeFromChain(cache, entry);
+    }
+
+    const int bucket = bucketOf(cache, key);
+    cache->keys[entry]     = *key;
+    cache->chain[entry]    = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+
+    linkNewest(cache, entry);
+
+    return cache->arena + (size_t)entry * cache->entry_bytes;
+}
+
+
+bool sameTileKey(const TileKey* a, const TileKey* b)
+{
+    assert(a != NULL);
+    assert(b != NULL);
+
+    return a->formula        == b->formula
+        && a->max_iterations == b->max_iterations
+        && a->level          == b->level
+        && a->tile_x         == b->tile_x
+        && a->tile_y         == b->tile_y
+        && a->julia_re       == b->julia_re
+        && a->julia_im       == b->julia_im;
+}
+
+
+uint64_t hashTileKey(const TileKey* key)
+{
+    assert(key != NULL);
+
+    uint64_t julia_re = 0;
+    uint64_t julia_im = 0;
+    memcpy(&julia_re, &key->julia_re, sizeof(julia_re));
+    memcpy(&julia_im, &key->julia_im, sizeof(julia_im));
+
+    const uint64_t parts[] = {
+        (uint64_t)(uint32_t)key->formula, (uint64_t)(uint32_t)key->max_iterations,
+        (uint64_t)(uint32_t)key->level,   (uint64_t)(uint32_t)key->tile_x,
+        (uint64_t)(uint32_t)key->tile_y,  julia_re, julia_im
+    };
+
+    // FNV-1a по словам
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++)
+    {
+        hash ^= parts[i];
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash ^ (hash >> 29);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+static int findEntry(const TileCache* cache, const TileKey* key)
+{
+    assert(cache != NULL);
+    assert(key   != NULL);
+
+    for (int entry = cache->buckets[bucketOf(cache, key)]; entry >= 0; entry = cache->chain[entry])
+    {
+        if (sameTileKey(&cache->keys[entry], key))
+        {
+            return entry;
+        }
+    }
+
+    return -1;
+}
+
+
+static void unlinkEntry(TileCache* cache, int entry)
+{
+    assert(cache != NULL);
+
+    int newer = cache->newer[entry];
+    int older = cache->older[entry];
+
+    if (newer >= 0)
+    {
+        cache->older[newer] = older;
+    }
+    else
+    {
+        cache->newest = older;
+    }
+
+    if (older >= 0)
+    {
+        cache->newer[older] = newer;
+    }
+    else
+    {
+        cache->oldest = newer;
+    }
+}
+
+
+static void linkNewest(TileCache* cache, int entry)
+{
+    assert(cache != NULL);
+
+    cache->newer[entry] = -1;
+    cache->older[entry] = cache->newest;
+
+    if (cache->newest >= 0)
+    {
+        cache->newer[cache->newest] = entry;
+    }
+    else
+    {
+        cache->oldest = entry;
+    }
+
+    cache->newest = entry;
+}
+
+
+static void removeFromChain(TileCache* cache, int entry)
+{
+    assert(cache != NULL);
+
+    int* link = &cache->buckets[bucketOf(cache, &cache->keys[entry])];
+    while (*link != entry)
+    {
+        assert(*link >= 0);
+        link = &cache->chain[*link];
+    }
+
+    *link = cache->chain[entry];
+}
+
+
+static int bucketOf(const TileCache* cache, const TileKey* key)
+{
+    return (int)(hashTileKey(key) & (cache->number_of_buckets - 1));
+}
@@ -5,14 +5,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <assert.h>
 #include <math.h>
 
+#include "mandelbrot_memory.h"
+
 
 // static ----------------------------------------------------------------------
 
 
-void setMandelbrotPalette(MandelbrotData* data);
+static size_t distanceFieldBytes(const IterationField* field);
+static void   freeDistanceField(MandelbrotData* data);
 
 
 // public ----------------------------------------------------------------------
@@ -23,6 +27,7 @@ int setDefaultMandelbrot(MandelbrotData* data)
     assert(data != NULL);
 
     data->zoom = DEFAULT_ZOOM;
+    data->max_iterations = MAX_ITERATIONS;
 
     const double width = DEFAULT_WIDTH / DEFAULT_ZOOM;
     const double height = width / SCREEN_RATIO;
@@ -32,11 +37,16 @@ int setDefaultMandelbrot(MandelbrotData* data)
     data->center_x = DEFAULT_CENTER_X;
     data->center_y = DEFAULT_CENTER_Y;
 
-    data->iterations_per_pixel = (int*)aligned_alloc(32, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
-    
-    if (!data->iterations_per_pixel)
+    data->formula  = FORMULA_MANDELBROT;
+    data->julia_re = DEFAULT_JULIA_RE;
+    data->julia_im = DEFAULT_JULIA_IM;
+
+    data->distance_per_pixel = NULL;
+
+    if (createIterationField(&data->field, 
+                             SCREEN_WIDTH, SCREEN_HEIGHT, 
+                             FIELD_FORMAT_I32, FIELD_LAYOUT_ROWS))
     {
-        fprintf(stderr, "Error while allocating memory for iterations field");
         return 1;
     }
 
@@ -46,15 +56,97 @@ int setDefaultMandelbrot(MandelbrotData* data)
 }
 
 
+int enableDistanceEstimation(MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    if (data->distance_per_pixel)
+    {
+        return 0;
+    }
+
+    data->distance_per_pixel = (float*)acquireFrameBuffer(defaultFramePool(), distanceFieldBytes(&data->field));
+
+    if (!data->distance_per_pixel)
+    {
+        fprintf(stderr, "Error while allocating memory for distance field");
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int setMandelbrotField(MandelbrotData* data, 
+                       int width, 
+                       int height,
+                       FieldFormat format, 
+                       FieldLayout layout)
+{
+    assert(data != NULL);
+
+    const bool distance_enabled = (data->distance_per_pixel != NULL);
+
+    freeDistanceField(data);
+    destroyIterationField(&data->field);
+
+    if (createIterationField(&data->field, width, height, format, layout))
+    {
+        return 1;
+    }
+
+    updateDimension(data);
+
+    return distance_enabled ? enableDistanceEstimation(data) : 0;
+}
+
+
+void freeMandelbrot(MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    freeDistanceField(data);
+    destroyIterationField(&data->field);
+}
+
+
 void updateDimension(MandelbrotData* data)
 {
     const double width = DEFAULT_WIDTH / data->zoom;
-    const double height = width / SCREEN_RATIO;
+    const double height = width * data->field.height / data->field.width;
     data->width = width;
     data->height = height;
 }
 
 
+void setMandelbrotFormula(MandelbrotData* data, FormulaType formula)
+{
+    assert(data != NULL);
+    assert(formula >= 0 && formula < FORMULA_COUNT);
+
+    data->formula = formula;
+
+    // центры, на которых каждая формула целиком помещается в экран
+    switch (formula)
+    {
+        case FORMULA_MANDELBROT:
+            data->center_x = DEFAULT_CENTER_X;
+            data->center_y = DEFAULT_CENTER_Y;
+            break;
+
+        case FORMULA_BURNING_SHIP:
+            data->center_x = -0.4;
+            data->center_y = -0.5;
+            break;
+
+        default:
+            data->center_x = 0.0;
+            data->center_y = 0.0;
+            break;
+    }
+}
+
+
 // public ----------------------------------------------------------------------
 
 
@@ -76,3 +168,67 @@ void setMandelbrotPalette(MandelbrotData* data)
 }
 
 
+FILE* openReportFile(const char* file_path)
+{
+    assert(file_path != NULL);
+
+    FILE* file = fopen(file_path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Error while opening file %s\n", file_path);
+    }
+
+    return file;
+}
+
+
+void printReport(FILE* file, const char* format, ...)
+{
+    assert(file   != NULL);
+    assert(format != NULL);
+
+    va_list args;
+    va_start(args, format);
+
+    va_list file_args;
+    va_copy(file_args, args);
+
+    vfprintf(stdout, format, args);
+    vfprintf(file, format, file_args);
+
+    va_end(file_args);
+    va_end(args);
+}
+
+
+double ticksToMs(uint64_t ticks)
+{
+    return (double)ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+
+double elapsedMs(uint64_t start)
+{
+    return ticksToMs(SDL_GetPerformanceCounter() - start);
+}
+
+
+// static ----------------------------------------------------------------------
+
+
+// размер зависит от поля, поэтому буфер возвращается до смены поля
+static size_t distanceFieldBytes(const IterationField* field)
+{
+    assert(field != NULL);
+
+    return (size_t)field->width * field->height * sizeof(float);
+}
+
+
+static void freeDistanceField(MandelbrotData* data)
+{
+    assert(data != NULL);
+
+    releaseFrameBuffer(defaultFramePool(), data->distance_per_pixel, distanceFieldBytes(&data->field));
+    data->distance_per_pixel = NULL;
+}